@@ -0,0 +1,273 @@
+#include "batchtransform.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "constants.h"
+#include "simd.h"
+
+// everything below is inlined into the kernel copies of every SimdLevel
+// (see the end of the file), the loops are vectorized for that level
+#define PF_KERNEL inline __attribute__((always_inline))
+
+namespace {
+
+// the row loops vectorize as long as the pointers can not alias
+PF_KERNEL void transformRow(float px, float py, float c, float s,
+                            const float *__restrict pointX, const float *__restrict pointY,
+                            size_t n, float *__restrict rcsX, float *__restrict rcsY) {
+    for (size_t j = 0; j < n; ++j) {
+        const float dx = pointX[j] - px;
+        const float dy = pointY[j] - py;
+        // rotation by -theta
+        rcsX[j] = dx * c + dy * s;
+        rcsY[j] = dy * c - dx * s;
+    }
+}
+
+PF_KERNEL void distRow(const float *__restrict rcsX, const float *__restrict rcsY, size_t n,
+                       float *__restrict dist) {
+    for (size_t j = 0; j < n; ++j) {
+        dist[j] = std::sqrt(rcsX[j] * rcsX[j] + rcsY[j] * rcsY[j]);
+    }
+}
+
+// atan2 without calls or branches so that the bearing loop vectorizes too.
+// octant reduction to [0, 1], then [0, tan(pi/8)] and the cephes atanf
+// polynomial, max. error below 5e-7 rad against atan2f
+PF_KERNEL float atan2Branchless(float y, float x) {
+    const float ax = std::fabs(x);
+    const float ay = std::fabs(y);
+    const float mx = std::max(ax, ay);
+    const float mn = std::min(ax, ay);
+    // every value is computed unconditionally, only selects remain
+    // (nothing is speculated, that is also fine with -ftrapping-math)
+    const float a = mn / std::max(mx, std::numeric_limits<float>::min());
+    const float reduced = (a - 1.0f) / (a + 1.0f);
+    const bool upper = a > 0.41421356f;
+    const float t = upper ? reduced : a;
+    const float z = t * t;
+    const float p = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z
+                     - 3.33329491539e-1f) * z * t + t;
+    const float r = p + (upper ? 0.25f * M_PI_F : 0.0f);
+    const float swapped = 0.5f * M_PI_F - r;
+    const float r2 = ay > ax ? swapped : r;
+    const float mirrored = M_PI_F - r2;
+    const float r3 = x < 0.0f ? mirrored : r2;
+    return std::copysign(r3, y);
+}
+
+PF_KERNEL void bearingRow(const float *__restrict rcsX, const float *__restrict rcsY,
+                          size_t n, float *__restrict bearing) {
+    for (size_t j = 0; j < n; ++j) {
+        bearing[j] = atan2Branchless(rcsY[j], rcsX[j]);
+    }
+}
+
+// closest points of the segments [j0, j0 + n) to one pose in wcs
+template<bool CLAMP>
+PF_KERNEL void closestRow(float px, float py, const SegmentBatch &seg, size_t j0, size_t n,
+                          float *__restrict qx, float *__restrict qy) {
+    const float *__restrict sx = seg.startX.data() + j0;
+    const float *__restrict sy = seg.startY.data() + j0;
+    const float *__restrict a = seg.a.data() + j0;
+    const float *__restrict b = seg.b.data() + j0;
+    const float *__restrict c = seg.c.data() + j0;
+    const float *__restrict ux = seg.dirX.data() + j0;
+    const float *__restrict uy = seg.dirY.data() + j0;
+    const float *__restrict len = seg.length.data() + j0;
+    for (size_t j = 0; j < n; ++j) {
+        const float signedDist = a[j] * px + b[j] * py + c[j];
+        float footX = px - signedDist * a[j];
+        float footY = py - signedDist * b[j];
+        if (CLAMP) {
+            const float t = (px - sx[j]) * ux[j] + (py - sy[j]) * uy[j];
+            const float back = std::min(std::max(t, 0.0f), len[j]) - t;
+            footX += back * ux[j];
+            footY += back * uy[j];
+        }
+        qx[j] = len[j] > 0.0f ? footX : sx[j];
+        qy[j] = len[j] > 0.0f ? footY : sy[j];
+    }
+}
+
+// output buffer of a requested field, grown to n floats, nullptr if not requested
+float *prepareField(std::vector<float> &v, size_t n, int requested) {
+    if (!requested) {
+        return nullptr;
+    }
+    if (v.size() < n) {
+        v.resize(n);
+    }
+    return v.data();
+}
+
+PF_KERNEL void orientationRow(const float *__restrict direction, float theta, size_t n,
+                              float *__restrict orientation) {
+    for (size_t j = 0; j < n; ++j) {
+        orientation[j] = direction[j] - theta;
+    }
+}
+
+PF_KERNEL void transformToRCSBody(const float *poseX, const float *poseY, const float *poseCos,
+                                  const float *poseSin, size_t numPoses, const float *pointX,
+                                  const float *pointY, size_t numPoints, float *rcsX,
+                                  float *rcsY, float *dist, float *bearing) {
+    // without x/y outputs a row sized scratch buffer is enough
+    const size_t SCRATCH = 64;
+    float scratchX[SCRATCH], scratchY[SCRATCH];
+
+    for (size_t i = 0; i < numPoses; ++i) {
+        const float c = poseCos[i];
+        const float s = poseSin[i];
+        const size_t row = i * numPoints;
+        for (size_t j0 = 0; j0 < numPoints; j0 += SCRATCH) {
+            const size_t n = std::min(SCRATCH, numPoints - j0);
+            float *outX = rcsX ? rcsX + row + j0 : scratchX;
+            float *outY = rcsY ? rcsY + row + j0 : scratchY;
+            transformRow(poseX[i], poseY[i], c, s, pointX + j0, pointY + j0, n, outX, outY);
+            if (dist) {
+                distRow(outX, outY, n, dist + row + j0);
+            }
+            if (bearing) {
+                bearingRow(outX, outY, n, bearing + row + j0);
+            }
+        }
+    }
+}
+
+PF_KERNEL void segmentsToRCSBody(const float *poseX, const float *poseY, const float *poseTheta,
+                                 const float *poseCos, const float *poseSin, size_t numPoses,
+                                 const SegmentBatch &segments, SegmentMode mode, float *rcsX,
+                                 float *rcsY, float *dist, float *bearing, float *orientation) {
+    // the closest points change with every pose, they go through one row of
+    // scratch (field lines fit easily)
+    const size_t SCRATCH = 64;
+    float closestX[SCRATCH], closestY[SCRATCH];
+    float scratchX[SCRATCH], scratchY[SCRATCH];
+    const size_t numSegments = segments.size();
+
+    for (size_t i = 0; i < numPoses; ++i) {
+        const float c = poseCos[i];
+        const float s = poseSin[i];
+        const size_t row = i * numSegments;
+        for (size_t j0 = 0; j0 < numSegments; j0 += SCRATCH) {
+            const size_t n = std::min(SCRATCH, numSegments - j0);
+            if (mode == SegmentMode::CLAMPED) {
+                closestRow<true>(poseX[i], poseY[i], segments, j0, n, closestX, closestY);
+            } else {
+                closestRow<false>(poseX[i], poseY[i], segments, j0, n, closestX, closestY);
+            }
+            float *outX = rcsX ? rcsX + row + j0 : scratchX;
+            float *outY = rcsY ? rcsY + row + j0 : scratchY;
+            transformRow(poseX[i], poseY[i], c, s, closestX, closestY, n, outX, outY);
+            if (dist) {
+                distRow(outX, outY, n, dist + row + j0);
+            }
+            if (bearing) {
+                bearingRow(outX, outY, n, bearing + row + j0);
+            }
+            if (orientation) {
+                orientationRow(segments.direction.data() + j0, poseTheta[i], n,
+                               orientation + row + j0);
+            }
+        }
+    }
+}
+
+typedef void (*TransformKernel)(const float *, const float *, const float *, const float *,
+                                size_t, const float *, const float *, size_t, float *, float *,
+                                float *, float *);
+typedef void (*SegmentKernel)(const float *, const float *, const float *, const float *,
+                              const float *, size_t, const SegmentBatch &, SegmentMode, float *,
+                              float *, float *, float *, float *);
+
+// one copy of both kernels per level, the rounding is the same on every
+// level (no fma contraction), only the vector width differs
+#define PF_DEFINE_KERNELS(SUFFIX, TARGET) \
+    TARGET void transformToRCS##SUFFIX(const float *poseX, const float *poseY, \
+            const float *poseCos, const float *poseSin, size_t numPoses, const float *pointX, \
+            const float *pointY, size_t numPoints, float *rcsX, float *rcsY, float *dist, \
+            float *bearing) { \
+        transformToRCSBody(poseX, poseY, poseCos, poseSin, numPoses, pointX, pointY, \
+                           numPoints, rcsX, rcsY, dist, bearing); \
+    } \
+    TARGET void segmentsToRCS##SUFFIX(const float *poseX, const float *poseY, \
+            const float *poseTheta, const float *poseCos, const float *poseSin, \
+            size_t numPoses, const SegmentBatch &segments, SegmentMode mode, float *rcsX, \
+            float *rcsY, float *dist, float *bearing, float *orientation) { \
+        segmentsToRCSBody(poseX, poseY, poseTheta, poseCos, poseSin, numPoses, segments, \
+                          mode, rcsX, rcsY, dist, bearing, orientation); \
+    }
+
+PF_DEFINE_KERNELS(Generic, )
+#ifdef PF_SIMD_X86
+PF_DEFINE_KERNELS(Sse4, PF_TARGET_SSE4)
+PF_DEFINE_KERNELS(Avx2, PF_TARGET_AVX2)
+PF_DEFINE_KERNELS(Avx512, PF_TARGET_AVX512)
+#endif
+
+// indexed by SimdLevel
+const TransformKernel TRANSFORM_KERNELS[] = {
+    transformToRCSGeneric,
+#ifdef PF_SIMD_X86
+    transformToRCSSse4, transformToRCSAvx2, transformToRCSAvx512
+#endif
+};
+
+const SegmentKernel SEGMENT_KERNELS[] = {
+    segmentsToRCSGeneric,
+#ifdef PF_SIMD_X86
+    segmentsToRCSSse4, segmentsToRCSAvx2, segmentsToRCSAvx512
+#endif
+};
+
+}
+
+void transformToRCS(const float *poseX, const float *poseY, const float *poseCos,
+                    const float *poseSin, size_t numPoses, const float *pointX,
+                    const float *pointY, size_t numPoints, float *rcsX, float *rcsY,
+                    float *dist, float *bearing) {
+    simdSelect(TRANSFORM_KERNELS)(poseX, poseY, poseCos, poseSin, numPoses, pointX, pointY,
+                                  numPoints, rcsX, rcsY, dist, bearing);
+}
+
+void segmentsToRCS(const float *poseX, const float *poseY, const float *poseTheta,
+                   const float *poseCos, const float *poseSin, size_t numPoses,
+                   const SegmentBatch &segments, SegmentMode mode, float *rcsX, float *rcsY,
+                   float *dist, float *bearing, float *orientation) {
+    simdSelect(SEGMENT_KERNELS)(poseX, poseY, poseTheta, poseCos, poseSin, numPoses, segments,
+                                mode, rcsX, rcsY, dist, bearing, orientation);
+}
+
+void transformToRCS(const PoseBatch &poses, const PointBatch &points, RcsBatch &out,
+                    int fields) {
+    const size_t n = poses.size() * points.size();
+    out.poses = poses.size();
+    out.points = points.size();
+    float *rcsX = prepareField(out.x, n, fields & RcsBatch::XY);
+    float *rcsY = prepareField(out.y, n, fields & RcsBatch::XY);
+    float *dist = prepareField(out.dist, n, fields & RcsBatch::DIST);
+    float *bearing = prepareField(out.bearing, n, fields & RcsBatch::BEARING);
+    transformToRCS(poses.x.data(), poses.y.data(), poses.cosTheta.data(), poses.sinTheta.data(),
+                   poses.size(), points.x.data(), points.y.data(), points.size(), rcsX, rcsY,
+                   dist, bearing);
+}
+
+void segmentsToRCS(const PoseBatch &poses, const SegmentBatch &segments, RcsBatch &out,
+                   SegmentMode mode, int fields) {
+    const size_t n = poses.size() * segments.size();
+    out.poses = poses.size();
+    out.points = segments.size();
+    float *rcsX = prepareField(out.x, n, fields & RcsBatch::XY);
+    float *rcsY = prepareField(out.y, n, fields & RcsBatch::XY);
+    float *dist = prepareField(out.dist, n, fields & RcsBatch::DIST);
+    float *bearing = prepareField(out.bearing, n, fields & RcsBatch::BEARING);
+    float *orientation = prepareField(out.orientation, n, fields & RcsBatch::ORIENTATION);
+    segmentsToRCS(poses.x.data(), poses.y.data(), poses.theta.data(), poses.cosTheta.data(),
+                  poses.sinTheta.data(), poses.size(), segments, mode, rcsX, rcsY, dist,
+                  bearing, orientation);
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,190 @@
+/**
+ * batched WCS -> RCS transform of many points into the frames of many poses
+ *
+ * poses and points are kept as structure of arrays, the results are
+ * row major matrices [pose][point]. the kernels take cos/sin of the pose
+ * headings (cached in the particles, see Particle), the inner loop over
+ * the points has no calls and vectorizes.
+ *
+ *   PoseBatch poses;
+ *   poses.assign(particles);
+ *   transformToRCS(poses, landmarks, rcs, RcsBatch::DIST | RcsBatch::BEARING);
+ *   float d = rcs.dist[i * rcs.points + j]; // particle i, landmark j
+ *
+ * same results as DirectedCoord::toRCS, Coord::dist and Coord::direction
+ * (up to rounding: dist uses sqrt instead of hypot).
+ *
+ * segmentsToRCS does the same for the closest points of line segments
+ * (field lines), see SegmentBatch.
+ */
+#pragma once
+
+#include "coords.h"
+#include "mathtoolbox.h"
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// poses in SoA form, the heading in rad and as cos/sin
+struct PoseBatch {
+    std::vector<float> x, y, theta, cosTheta, sinTheta;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+        theta.clear();
+        cosTheta.clear();
+        sinTheta.clear();
+    }
+
+    // c, s: cos/sin of pose.angle.rad
+    void push_back(const DirectedCoord &pose, float c, float s) {
+        x.push_back(pose.coord.x);
+        y.push_back(pose.coord.y);
+        theta.push_back(pose.angle.rad);
+        cosTheta.push_back(c);
+        sinTheta.push_back(s);
+    }
+
+    void push_back(const DirectedCoord &pose) {
+        push_back(pose, std::cos(pose.angle.rad), std::sin(pose.angle.rad));
+    }
+
+    // anything with a 'pose' and the cached 'cosTheta'/'sinTheta', e.g. particles
+    template<typename T>
+    void assign(const std::vector<T> &items) {
+        clear();
+        for (const auto &item: items) {
+            push_back(item.pose, item.cosTheta, item.sinTheta);
+        }
+    }
+};
+
+// points in SoA form
+struct PointBatch {
+    std::vector<float> x, y;
+
+    size_t size() const {
+        return x.size();
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+    }
+
+    void push_back(const Coord &c) {
+        x.push_back(c.x);
+        y.push_back(c.y);
+    }
+};
+
+// line segments in SoA form with their hesse normal form
+struct SegmentBatch {
+    std::vector<float> startX, startY; // wcs
+    std::vector<float> a, b, c; // hesse normal form of a*x+b*y+c=0
+    std::vector<float> dirX, dirY; // unit vector start -> end, zero for point-like segments
+    std::vector<float> length;
+    std::vector<float> direction; // wcs orientation of start -> end, rad
+
+    size_t size() const {
+        return startX.size();
+    }
+
+    void clear() {
+        for (auto *v: {&startX, &startY, &a, &b, &c, &dirX, &dirY, &length, &direction}) {
+            v->clear();
+        }
+    }
+
+    // hnf as stored in LandmarkLine::equation / FieldLineDef::equation
+    void push_back(const Coord &start, const Coord &end, const Line2f &hnf) {
+        const Coord d = end - start;
+        const float len = d.dist();
+        startX.push_back(start.x);
+        startY.push_back(start.y);
+        a.push_back(hnf[0]);
+        b.push_back(hnf[1]);
+        c.push_back(hnf[2]);
+        dirX.push_back(len > 0.0f ? d.x / len : 0.0f);
+        dirY.push_back(len > 0.0f ? d.y / len : 0.0f);
+        length.push_back(len);
+        direction.push_back(d.direction());
+    }
+
+    void push_back(const Coord &start, const Coord &end) {
+        push_back(start, end, Line2f::through(Vec3f::point(start.x, start.y),
+                                              Vec3f::point(end.x, end.y)).hesseNormalForm());
+    }
+};
+
+enum class SegmentMode {
+    CLAMPED,      ///< closest point on the segment
+    INFINITE_LINE ///< foot of the perpendicular (Coord::closestPointOnLine default)
+};
+
+// results of transformToRCS / segmentsToRCS, poses x points (segments), row major
+struct RcsBatch {
+    enum Field {
+        XY = 1,          ///< rcs x/y (of the closest point for segments)
+        DIST = 2,        ///< distance from the pose
+        BEARING = 4,     ///< direction in the pose frame [-pi ... pi]
+        ORIENTATION = 8, ///< segments only: direction - pose heading, not normalized
+        ALL = XY | DIST | BEARING | ORIENTATION
+    };
+
+    size_t poses = 0, points = 0;
+    std::vector<float> x, y, dist, bearing, orientation;
+
+    const float *distRow(size_t pose) const {
+        return dist.data() + pose * points;
+    }
+
+    const float *bearingRow(size_t pose) const {
+        return bearing.data() + pose * points;
+    }
+
+    const float *orientationRow(size_t pose) const {
+        return orientation.data() + pose * points;
+    }
+};
+
+/**
+ * core kernel on caller provided buffers (no allocation). poseCos/poseSin
+ * are cos/sin of the pose headings. every output holds numPoses *
+ * numPoints floats, outputs which are not needed may be nullptr.
+ */
+void transformToRCS(const float *poseX, const float *poseY, const float *poseCos,
+                    const float *poseSin, size_t numPoses, const float *pointX,
+                    const float *pointY, size_t numPoints, float *rcsX, float *rcsY,
+                    float *dist, float *bearing);
+
+/**
+ * transforms all points into all poses, only the requested fields
+ * (RcsBatch::Field) are written. the buffers of 'out' are reused, they
+ * only grow.
+ */
+void transformToRCS(const PoseBatch &poses, const PointBatch &points, RcsBatch &out,
+                    int fields = RcsBatch::ALL);
+
+/**
+ * closest point of every segment to every pose, in the pose frame. uses
+ * the hesse normal form (foot point = pose - signed dist * normal), the
+ * clamped mode moves it along the segment back onto its end points.
+ * point-like segments (length 0) always give their start point.
+ * outputs as in transformToRCS, orientation included.
+ */
+void segmentsToRCS(const float *poseX, const float *poseY, const float *poseTheta,
+                   const float *poseCos, const float *poseSin, size_t numPoses,
+                   const SegmentBatch &segments, SegmentMode mode, float *rcsX, float *rcsY,
+                   float *dist, float *bearing, float *orientation);
+
+void segmentsToRCS(const PoseBatch &poses, const SegmentBatch &segments, RcsBatch &out,
+                   SegmentMode mode = SegmentMode::CLAMPED, int fields = RcsBatch::ALL);
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
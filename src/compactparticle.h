@@ -0,0 +1,132 @@
+/**
+ * compact (quantized) particle storage
+ *
+ * one particle takes 8 byte instead of the 20 byte of a float Particle:
+ *  - x/y in millimetre (int16, +-32.7m)
+ *  - heading in 1/65536 turns (uint16)
+ *  - log(weight) as IEEE half precision float
+ * encoding and decoding is header only so it can be inlined into the
+ * per particle loops of the filter.
+ */
+#pragma once
+
+#include <coords.h>
+#include <constants.h>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+struct CompactParticle {
+    int16_t x_mm;
+    int16_t y_mm;
+    uint16_t heading; // 1/65536 turns, 0 == 0 rad
+    uint16_t logWeight; // half float
+};
+
+static_assert(sizeof(CompactParticle) == 8, "CompactParticle must stay 8 byte");
+
+namespace compact {
+
+constexpr float MM_PER_M = 1000.0f;
+constexpr float TURN_PER_RAD = 65536.0f / (2.0f * M_PI_F);
+constexpr float RAD_PER_TURN = (2.0f * M_PI_F) / 65536.0f;
+
+// float --> IEEE 754 half precision, round to nearest even
+inline uint16_t floatToHalf(const float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000u;
+    const uint32_t absx = x & 0x7fffffffu;
+
+    if (absx >= 0x7f800000u) { // inf, nan
+        return sign | 0x7c00u | ((absx > 0x7f800000u) ? 0x200u : 0u);
+    }
+    if (absx >= 0x477ff000u) { // rounds to >= 65520 --> inf
+        return sign | 0x7c00u;
+    }
+    if (absx < 0x38800000u) { // below 2^-14: half subnormal or zero
+        if (absx < 0x33000000u) {
+            return sign;
+        }
+        const uint32_t mant = (absx & 0x7fffffu) | 0x800000u;
+        const uint32_t shift = 126u - (absx >> 23);
+        uint32_t h = mant >> shift;
+        const uint32_t rem = mant & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if ((rem > halfway) || ((rem == halfway) && (h & 1u))) {
+            ++h;
+        }
+        return sign | h;
+    }
+    // rebias exponent (127 -> 15), carry of rounding goes into the exponent
+    uint32_t h = (absx - 0x38000000u) >> 13;
+    const uint32_t rem = absx & 0x1fffu;
+    if ((rem > 0x1000u) || ((rem == 0x1000u) && (h & 1u))) {
+        ++h;
+    }
+    return sign | h;
+}
+
+// IEEE 754 half precision --> float
+inline float halfToFloat(const uint16_t h) {
+    const uint32_t sign = (h & 0x8000u) << 16;
+    const uint32_t e = (h >> 10) & 0x1fu;
+    const uint32_t m = h & 0x3ffu;
+    if (e == 0) {
+        const float f = static_cast<float>(m) * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+    uint32_t x;
+    if (e == 31) {
+        x = sign | 0x7f800000u | (m << 13);
+    } else {
+        x = sign | ((e + 112u) << 23) | (m << 13);
+    }
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+inline int16_t metreToMm(const float m) {
+    const float mm = std::round(m * MM_PER_M);
+    if (mm > 32767.0f) {
+        return 32767;
+    }
+    if (mm < -32768.0f) {
+        return -32768;
+    }
+    return static_cast<int16_t>(mm);
+}
+
+inline float mmToMetre(const int16_t mm) {
+    return static_cast<float>(mm) * (1.0f / MM_PER_M);
+}
+
+inline uint16_t radToTurn(const float rad) {
+    // wrap via integer overflow, no need to normalize first
+    const long t = std::lround(static_cast<double>(rad) * TURN_PER_RAD);
+    return static_cast<uint16_t>(static_cast<unsigned long>(t) & 0xffffu);
+}
+
+inline float turnToRad(const uint16_t turn) {
+    // int16 reinterpretation maps to [-pi ... pi)
+    return static_cast<float>(static_cast<int16_t>(turn)) * RAD_PER_TURN;
+}
+
+inline CompactParticle encode(const DirectedCoord &pose, const float weight) {
+    return {metreToMm(pose.coord.x), metreToMm(pose.coord.y),
+            radToTurn(pose.angle.rad), floatToHalf(std::log(weight))};
+}
+
+inline DirectedCoord decodePose(const CompactParticle &p) {
+    return DirectedCoord(mmToMetre(p.x_mm), mmToMetre(p.y_mm),
+                         turnToRad(p.heading));
+}
+
+inline float decodeWeight(const CompactParticle &p) {
+    return std::exp(halfToFloat(p.logWeight));
+}
+
+} // namespace compact
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
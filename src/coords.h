@@ -1,8 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <iosfwd>
 #include <vector>
 #include <cmath>
+#include <type_traits>
+
+#include "fastangle.h"
 
 inline bool floatEQ(const float x, const float y) {
     return fabsf(x - y) < 0.00001;
@@ -16,7 +20,7 @@ inline bool floatEQ(const float x, const float y) {
  **/
 class Angle {
 public:
-    Angle();
+    constexpr Angle() : deg(0), rad(0.0f) {}
     Angle(float rad);
     Angle(int deg);
 
@@ -82,14 +86,17 @@ public:
 class DirectedCoord;
 class Coord {
 public:
-    Coord();
-    Coord(const float &x, const float &y);
-    Coord(const int &x, const int &y);
+    constexpr Coord() : x(0.0f), y(0.0f) {}
+    constexpr Coord(const float &x, const float &y) : x(x), y(y) {}
+    constexpr Coord(const int &x, const int &y)
+        : x(static_cast<float>(x)), y(static_cast<float>(y)) {}
     Coord(const std::vector<float> &xy);
 
     Coord(const Angle &); // create unit vector for this angle
  
-    float norm2() const;
+    float norm2() const {
+        return std::sqrt(x * x + y * y);
+    }
     // parse from string, should match operator<<
     //static Coord fromString(const std::string& s);
 
@@ -97,33 +104,55 @@ public:
 
     Coord clamp(float maxVal) const;
 
-    float direction() const;
+    float direction() const {
+        return atan2f(y, x);
+    }
 
 
     // get distance from 'target' to this coord
-    float dist(const Coord &target) const;
+    float dist(const Coord &target) const {
+        return hypotf(target.x - x, target.y - y);
+    }
 
     // get distance from Coord(0,0) (coords origin) to this coord
-    float dist() const;
+    float dist() const {
+        return hypotf(x, y);
+    }
 
     // get angle for this coordinate (from Coord(0,0))
     Angle angle() const;
 
-    float dot(const Coord &other) const;
+    constexpr float dot(const Coord &other) const {
+        return x * other.x + y * other.y;
+    }
 
     // get angle from 'target' arbitrary coordinate to this Coord TODO!!!!
     // Angle angle(const Coord& target) const;
 
     // add 'other' to this coordinate
-    Coord &add(const Coord &other);
+    Coord &add(const Coord &other) {
+        x += other.x;
+        y += other.y;
+        return *this;
+    }
     // substract 'other' from this coordinate
-    Coord &sub(const Coord &other);
+    Coord &sub(const Coord &other) {
+        x -= other.x;
+        y -= other.y;
+        return *this;
+    }
 
     Coord rotate(const Angle &) const;
 
-    Coord operator-(const Coord &other) const;
-    Coord operator+(const Coord &other) const;
-    Coord operator*(const Coord &other) const;
+    constexpr Coord operator-(const Coord &other) const {
+        return {x - other.x, y - other.y};
+    }
+    constexpr Coord operator+(const Coord &other) const {
+        return {x + other.x, y + other.y};
+    }
+    constexpr Coord operator*(const Coord &other) const {
+        return {x * other.x, y * other.y};
+    }
 
     inline Coord& operator-=(const Coord &other) {
         return *this = *this - other;
@@ -134,21 +163,53 @@ public:
     }
 
 
-    friend Coord operator*(float scalar, const Coord &other);
-    friend Coord operator*(const Coord &other, float scalar);
-    friend Coord operator/(float scalar, const Coord &other);
-    friend Coord operator/(const Coord &other, float scalar);
+    friend constexpr Coord operator*(float scalar, const Coord &other) {
+        return {scalar * other.x, scalar * other.y};
+    }
+    friend constexpr Coord operator*(const Coord &other, float scalar) {
+        return {other.x * scalar, other.y * scalar};
+    }
+    friend constexpr Coord operator/(float scalar, const Coord &other) {
+        return {scalar / other.x, scalar / other.y};
+    }
+    friend constexpr Coord operator/(const Coord &other, float scalar) {
+        return {other.x / scalar, other.y / scalar};
+    }
 
     bool operator==(const Coord &other);
     bool operator!=(const Coord &other);
 
-    Coord &operator/=(float scalar);
+    Coord &operator/=(float scalar) {
+        x /= scalar;
+        y /= scalar;
+        return *this;
+    }
 
     // add 'dist' towards 'dir' to coordinate
     Coord &add(const Angle &dir, const float &dist);
 
     // get distance from coord to line with startpoint start and endpoint end
-    Coord closestPointOnLine(Coord start, Coord end, bool onLine = false) const;
+    Coord closestPointOnLine(Coord start, Coord end, bool onLine = false) const {
+        //berrechne Faktor der Geraden, mit der der Punkt auf der Geraden bestimmt werden kann, der die kürzeste Entfernung zu this hat
+        //skalarprodukt: (gerade -Punkt) * (end-start) =0
+        if (((end.x - start.x) + (end.y - start.y)) == 0) {
+            return Coord(start.x, start.y);
+        }
+
+        float dxSquared = end.x - start.x;
+        dxSquared *= dxSquared;
+
+        float dySquared = end.y - start.y;
+        dySquared *= dySquared;
+        float scale = -(((start.x - x) * (end.x - start.x)) + ((start.y - y) *
+                        (end.y - start.y)))
+                      / (dxSquared + dySquared);
+        if (onLine) {
+            scale = std::max(0.0f, std::min(1.f, scale));//point shoudl be on line
+        }
+        return Coord((start.x + scale * (end.x - start.x)),
+                     start.y + scale * (end.y - start.y));
+    }
 
 
     DirectedCoord lookAt(const Coord &other);
@@ -160,9 +221,7 @@ public:
 // what belongs together->belongs together ;D
 class DirectedCoord {
 public:
-    DirectedCoord();
-
-    DirectedCoord(const DirectedCoord &other);
+    constexpr DirectedCoord() : angle(), coord() {}
 
     // parse from string, should match operator<<
     //static DirectedCoord fromString(const std::string& s);
@@ -171,8 +230,8 @@ public:
     // as long as it still exists in the framework, we need this:
     DirectedCoord(const std::vector<float> &vals);
 
-    DirectedCoord(const Angle &a, const Coord &c);
-    DirectedCoord(const Coord &c, const Angle &a);  // hrhr take them' all ;D
+    constexpr DirectedCoord(const Angle &a, const Coord &c) : angle(a), coord(c) {}
+    constexpr DirectedCoord(const Coord &c, const Angle &a) : angle(a), coord(c) {}  // hrhr take them' all ;D
 
     DirectedCoord(const float &x, const float &y, const float &rad);
     // DirectedCoord(const float& x, const float& y, const int& deg);
@@ -198,19 +257,78 @@ public:
     DirectedCoord toRCS(const DirectedCoord &origin) const;
     DirectedCoord toWCS(const DirectedCoord &origin) const;
 
-    DirectedCoord operator=(const DirectedCoord &other);
     DirectedCoord &operator+=(const DirectedCoord &other);
 
     DirectedCoord operator-(const DirectedCoord &other) const;
     DirectedCoord operator+(const DirectedCoord &other) const;
     DirectedCoord operator*(const DirectedCoord &other) const;
 
-    bool isNull() const;
+    bool isNull() const {
+        return coord.x == 0 && coord.y == 0 && angle.rad == 0;
+    }
 
     Angle angle;
     Coord coord;
 };
 
+// copied per particle and per feature, has to stay a plain value
+static_assert(std::is_trivially_copyable<Angle>::value, "Angle must be trivially copyable");
+static_assert(std::is_trivially_copyable<Coord>::value, "Coord must be trivially copyable");
+static_assert(std::is_trivially_copyable<DirectedCoord>::value,
+              "DirectedCoord must be trivially copyable");
+
+
+inline FastAngle::FastAngle(const Angle &a) : rad(a.rad) {}
+
+inline Angle FastAngle::toAngle() const {
+    Angle a;
+    a.rad = rad;
+    a.deg = static_cast<int>(roundNearest(rad * RAD_TO_DEG));
+    return a;
+}
+
+inline Coord Coord::rotate(const Angle &angle) const {
+    float cosalpha = cosf(angle.rad);
+    float sinalpha = sinf(angle.rad);
+    return {x * cosalpha - y * sinalpha, x * sinalpha + y * cosalpha};
+}
+
+/**
+ * DirectedCoord::walk for the hot paths: turns by 'turn' and then walks
+ * (dx, dy) in the new direction, sin/cos are calculated once.
+ */
+inline DirectedCoord fastWalk(const DirectedCoord &from, float dx, float dy, FastAngle turn) {
+    FastAngle heading = FastAngle(from.angle) + turn;
+    float c = std::cos(heading.rad);
+    float s = std::sin(heading.rad);
+    return DirectedCoord(Coord(from.coord.x + c * dx - s * dy, from.coord.y + s * dx + c * dy),
+                         heading.toAngle());
+}
+
+inline DirectedCoord DirectedCoord::walk(const DirectedCoord &delta) const {
+    // The same as toRCS() but fixed
+    // Didn't touch the other one because of backwards compatibility fear
+    return fastWalk(*this, delta.coord.x, delta.coord.y, delta.angle);
+}
+
+inline DirectedCoord DirectedCoord::toRCS(const DirectedCoord &mypos) const {
+    // transform from wcs to rcs, the angle is kept
+    // 1) add translation, 2) rotate local coordinates according to -alpha
+    float cosalpha = cosf(-mypos.angle.rad);
+    float sinalpha = sinf(-mypos.angle.rad);
+    float dx = coord.x - mypos.coord.x;
+    float dy = coord.y - mypos.coord.y;
+    return {angle, Coord(dx * cosalpha - dy * sinalpha, dx * sinalpha + dy * cosalpha)};
+}
+
+inline DirectedCoord DirectedCoord::toWCS(const DirectedCoord &mypos) const {
+    // 1) de-rotate local coordinates according to alpha, 2) add translation
+    float cosalpha = cosf(mypos.angle.rad);
+    float sinalpha = sinf(mypos.angle.rad);
+    return {angle, Coord(coord.x * cosalpha - coord.y * sinalpha + mypos.coord.x,
+                         coord.x * sinalpha + coord.y * cosalpha + mypos.coord.y)};
+}
+
 
 std::ostream &operator<<(std::ostream &s, const Angle &obj);
 std::ostream &operator<<(std::ostream &s, const Coord &obj);
@@ -56,43 +56,36 @@ void Robot::setUnknownPose() {
 }
 
 bool Robot::setFromString(const std::string &data) {
-    int pos1, pos2;
-
-    pos1 = data.find("id=");
-    id = atoi(data.substr(pos1+3, 1).c_str());
-
-    pos1 = data.find("t=")+2;
-    pos2 = data.find(" c=");
-    timestamp = atoi(data.substr(pos1, pos2-pos1).c_str());
-
-    pos1 = data.find(" c=")+3;
-    pos2 = data.find(" @ ");
-    confidence = atof(data.substr(pos1, pos2-pos1).c_str());
-
-    pos1 = data.find(" @ ")+3;
-    pos2 = data.find("rad ");
-    std::string p = data.substr(pos1, pos2-pos1);
-    pos1 = p.find(", ");
-    pos.coord.x = atof(p.substr(0, pos1).c_str());
-    pos2 = p.find(", ", pos1+2);
-    pos.coord.y = atof(p.substr(pos1+2, pos2-pos1-2).c_str());
-    pos.angle = static_cast<float>(atof(p.substr(pos2+2,
-                                        p.size()-pos2-2).c_str()));
-
-    pos1 = data.find("RUTH: ")+6;
-    pos2 = data.find(",Conf");
-    std::string gt = data.substr(pos1, pos2-pos1);
-    pos1 = gt.find(",");
-    pos2 = gt.find(",", pos1+1);
-    GTpos.coord.x = atof(gt.substr(0, pos1).c_str());
-    GTpos.coord.y = atof(gt.substr(pos1+1, pos2-pos1-1).c_str());
-    GTpos.angle = static_cast<float>(atof(gt.substr(pos2+1,
-                                          p.size()-pos2-1).c_str()));
-
-    pos1 = data.find("Conf: ")+6;
-    GTconfidence = atof(data.substr(pos1, data.size() - pos1).c_str());
+    return static_cast<bool>(parse(data, *this));
+}
 
-    return true;
+ParseResult Robot::parse(std::string_view data, Robot &r) {
+    float angle = r.pos.angle.rad;
+    float gtAngle = r.GTpos.angle.rad;
+    textparse::Scanner in(data);
+    in.after("id=", "id").read("id", r.id)
+      .after("t=", "t").read("t", r.timestamp)
+      .after(" c=", "c").read("c", r.confidence)
+      .after(" @ ", "pos").read("pos.x", r.pos.coord.x)
+      .expect(", ", "pos.y").read("pos.y", r.pos.coord.y)
+      .expect(", ", "pos.angle").read("pos.angle", angle)
+      .after("GROUNDTRUTH: ", "GTpos").read("GTpos.x", r.GTpos.coord.x)
+      .expect(",", "GTpos.y").read("GTpos.y", r.GTpos.coord.y)
+      .expect(",", "GTpos.angle").read("GTpos.angle", gtAngle)
+      .after("Conf: ", "GTconfidence").read("GTconfidence", r.GTconfidence);
+    r.pos.angle = angle;
+    r.GTpos.angle = gtAngle;
+    if (!in.ok()) {
+        return in.result();
+    }
+    // optional, missing in older logs
+    int active = 0;
+    if (in.after(", act=", "active").read("active", active).ok()) {
+        r.active = (active != 0);
+    } else if (in.result().code == ParseResult::INVALID_NUMBER) {
+        return in.result();
+    }
+    return ParseResult();
 }
 
 Message::Message() :
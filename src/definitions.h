@@ -1,9 +1,12 @@
 #pragma once
 
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include <coords.h>
 #include <platform.h>
+#include <textparse.h>
 
 /**
  * basis class of all objects sent around between modules, contains messageType, sender id, timestamp.
@@ -31,9 +34,15 @@ public:
 
     void setUnknownPose(); ///< sets all confidence and pose data to initial values
 
-    // set robot from string
+    // set robot from string, returns false if the string could not be parsed
     bool setFromString(const std::string &data);
 
+    /**
+     * parse the string written by operator<<, fields are stored until
+     * the first error, which is returned.
+     */
+    static ParseResult parse(std::string_view data, Robot &r);
+
     int id; ///< id of the robot that has this pose (0..2 for our bots, else unknown)
     RobotRole role; ///< instance of robot role
     int fallen; ///< how long is the robot fallen down in seconds, -1 if not fallen.
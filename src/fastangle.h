@@ -0,0 +1,71 @@
+#pragma once
+
+#include "constants.h"
+
+#include <cmath>
+
+class Angle;
+
+/** FastAngle (radians only angle for the per particle hot paths)
+ *  - wraps into [-pi ... pi] without remainder() or any other libm call
+ *  - degrees are only calculated when asked for
+ *  - converts from/to Angle where it is handed to other modules
+ *    (particle poses, feature tables stay Angle/DirectedCoord)
+ *  - DO _NOT_ WRITE ::rad directly, same as for Angle
+ *  - the Angle conversions are defined in coords.h, include that one
+ **/
+class FastAngle {
+public:
+    constexpr FastAngle() : rad(0.0f) {}
+    explicit FastAngle(float r) : rad(wrap(r)) {}
+    // Angle::rad is normalized already
+    FastAngle(const Angle &a);
+
+    // round to nearest integer without a branch or a call: adding 1.5 * 2^23
+    // pushes the fraction out of the mantissa. valid for |v| < 2^22.
+    static float roundNearest(float v) {
+        const float magic = 12582912.0f;
+        return (v + magic) - magic;
+    }
+
+    // radians --> [-pi ... pi], same result as Angle::normalize
+    static float wrap(float r) {
+        return r - (2.0f * M_PI_F) * roundNearest(r * (0.5f / M_PI_F));
+    }
+
+    Angle toAngle() const;
+
+    float deg() const {
+        return rad * RAD_TO_DEG;
+    }
+
+    FastAngle operator+(const FastAngle &other) const {
+        return FastAngle(rad + other.rad);
+    }
+
+    FastAngle operator-(const FastAngle &other) const {
+        return FastAngle(rad - other.rad);
+    }
+
+    FastAngle operator-() const {
+        // -pi and pi are the same direction, no wrap needed
+        FastAngle out;
+        out.rad = -rad;
+        return out;
+    }
+
+    // shortest turn from 'other' to this, same as Angle::dist
+    FastAngle dist(const FastAngle &other) const {
+        return *this - other;
+    }
+
+    // absolute shortest turn in [0 ... pi]
+    float absDist(const FastAngle &other) const {
+        return std::fabs(dist(other).rad);
+    }
+
+    // [-pi .. pi] (counter-clock wise)
+    float rad;
+};
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
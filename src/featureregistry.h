@@ -0,0 +1,169 @@
+/**
+ * compile time registry of the feature types the filter matches.
+ *
+ * a feature type maps a VisionClass to its landmark table:
+ *
+ *   struct MyFeatures {
+ *       static constexpr VisionClass type = JSVISION_...;
+ *       // the observation of a vision result of this type, false: ignore it
+ *       static bool observe(const ParticleFilterBase &pf, const VisionResult &vr, Feature &seen);
+ *       // once per update if seen, batched work over pf.particlePoses
+ *       static void prepare(ParticleFilterBase &pf);
+ *       // landmarks of the table as expected from particle i
+ *       static void expected(const ParticleFilterBase &pf, size_t i, std::vector<Feature> &out);
+ *   };
+ *
+ * the types are listed in a FeatureList which is the third template
+ * parameter of BasicParticleFilter. measurementModel expands the list at
+ * compile time: one pass over the vision results, one pass over the
+ * particles for all types. scoring is done by the observation model.
+ */
+#pragma once
+
+#include <particlefilterbase.h>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+template<class T>
+struct FeatureTag {
+    typedef T type;
+};
+
+template<class... Types>
+struct FeatureList {
+    static constexpr size_t size = sizeof...(Types);
+
+    // position of a VisionClass in the list, -1 if not registered
+    static constexpr int indexOf(int visionClass) {
+        const int types[] = {Types::type..., -1};
+        for (size_t i = 0; i < size; ++i) {
+            if (types[i] == visionClass) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // f(std::integral_constant<size_t, index>, FeatureTag<Type>) for every type in order
+    template<class F>
+    static void forEach(F &&f) {
+        forEach(f, std::index_sequence_for<Types...>());
+    }
+
+private:
+    template<class F, size_t... I>
+    static void forEach(F &f, std::index_sequence<I...>) {
+        (f(std::integral_constant<size_t, I>(), FeatureTag<Types>()), ...);
+    }
+};
+
+
+namespace features {
+
+// field lines, closest point of the infinite line
+struct Lines {
+    static constexpr VisionClass type = JSVISION_LINE;
+
+    static bool observe(const ParticleFilterBase &pf, const VisionResult &vr, Feature &seen) {
+        Coord lineStart(vr.rcs_x1, vr.rcs_y1);
+        Coord lineEnd(vr.rcs_x2, vr.rcs_y2);
+        if (lineStart.dist(lineEnd) <= pf.conf.pf->_penaltyLength + 0.1f) { //discard short lines
+            return false;
+        }
+        // foot of the perpendicular from the robot with the hesse normal form
+        const Line2f hnf = Line2f::through(Vec3f::point(lineStart.x, lineStart.y),
+                                           Vec3f::point(lineEnd.x, lineEnd.y)).hesseNormalForm();
+        const Coord closest(-hnf[2] * hnf[0], -hnf[2] * hnf[1]);
+        seen = Feature(type, closest.dist(), closest.direction(), (lineEnd - lineStart).direction());
+        return true;
+    }
+
+    static void prepare(ParticleFilterBase &pf) {
+        segmentsToRCS(pf.particlePoses, pf.lineTable.segments, pf.lineTable.rcs,
+                      SegmentMode::INFINITE_LINE,
+                      RcsBatch::DIST | RcsBatch::BEARING | RcsBatch::ORIENTATION);
+    }
+
+    static void expected(const ParticleFilterBase &pf, size_t i, std::vector<Feature> &out) {
+        const RcsBatch &rcs = pf.lineTable.rcs;
+        pf.lineFeatures(rcs.distRow(i), rcs.bearingRow(i), rcs.orientationRow(i), out);
+    }
+};
+
+// point landmarks with a batched table (see ParticleFilterBase::PointTable)
+template<VisionClass TYPE>
+struct Points {
+    static constexpr VisionClass type = TYPE;
+
+    static_assert(TYPE == JSVISION_LCROSS || TYPE == JSVISION_TCROSS || TYPE == JSVISION_XCROSS ||
+                  TYPE == JSVISION_PENALTY || TYPE == JSVISION_GOAL, "no point table for this type");
+
+    template<class Filter>
+    static auto &table(Filter &pf) {
+        if constexpr (TYPE == JSVISION_LCROSS) {
+            return pf.crossTables[0];
+        } else if constexpr (TYPE == JSVISION_TCROSS) {
+            return pf.crossTables[1];
+        } else if constexpr (TYPE == JSVISION_XCROSS) {
+            return pf.crossTables[2];
+        } else if constexpr (TYPE == JSVISION_PENALTY) {
+            return pf.penaltyTable;
+        } else {
+            return pf.goalTable;
+        }
+    }
+
+    static bool observe(const ParticleFilterBase &pf, const VisionResult &vr, Feature &seen) {
+        const float orientation = table(pf).oriented ? vr.extra_float : 0.0f;
+        seen = Feature(type, vr.rcs_distance, vr.rcs_alpha, orientation);
+        return true;
+    }
+
+    static void prepare(ParticleFilterBase &pf) {
+        auto &t = table(pf);
+        transformToRCS(pf.particlePoses, t.points, t.rcs, RcsBatch::DIST | RcsBatch::BEARING);
+    }
+
+    static void expected(const ParticleFilterBase &pf, size_t i, std::vector<Feature> &out) {
+        const auto &t = table(pf);
+        pf.pointFeatures(t, t.rcs.distRow(i), t.rcs.bearingRow(i),
+                         pf.particles[i].pose.angle.rad, out);
+    }
+};
+
+typedef Points<JSVISION_LCROSS> LCrosses;
+typedef Points<JSVISION_TCROSS> TCrosses;
+typedef Points<JSVISION_XCROSS> XCrosses;
+// penalty marks and goal poles are not in the default list, the filter
+// never matched them before (and seen poles can not be told apart)
+typedef Points<JSVISION_PENALTY> PenaltyMarks;
+typedef Points<JSVISION_GOAL> GoalPoles;
+
+// the center circle, seen as its center point
+struct Circle {
+    static constexpr VisionClass type = JSVISION_CIRCLE;
+
+    static bool observe(const ParticleFilterBase &, const VisionResult &vr, Feature &seen) {
+        seen = Feature(type, vr.rcs_distance, vr.rcs_alpha);
+        return true;
+    }
+
+    static void prepare(ParticleFilterBase &) {}
+
+    static void expected(const ParticleFilterBase &pf, size_t i, std::vector<Feature> &out) {
+        out = pf.createCircleFeature(pf.particles[i]);
+    }
+};
+
+} // namespace features
+
+
+// the matching order is the order of the list
+typedef FeatureList<features::Lines, features::LCrosses, features::TCrosses,
+                    features::XCrosses, features::Circle> DefaultFeatures;
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,443 @@
+/*
+ * fieldmodel.h
+ * @author Bembelbots Frankfurt
+ *
+ * compile time description of the playingfield landmarks.
+ * all built-in FieldSize presets are generated by the compiler into
+ * constexpr tables (read-only memory, no startup cost), custom field
+ * measurements use the very same generator at runtime.
+ */
+
+#pragma once
+
+#include <types.h>
+#include <constants.h>
+#include <mathtoolbox.h>
+#include <array>
+#include <cstddef>
+
+
+/* This enums are used in jslinematching, so do not change them, if do not know what you do! */
+enum class Line {
+    LEFT,
+    RIGHT,
+    TOP,
+    BOTTOM,
+    MIDDLE,
+    OPP_PENALTY,
+    OPP_PENALTY_LEFT,
+    OPP_PENALTY_RIGHT,
+    OPP_PENALTY_SHOOTMARK,
+    OWN_PENALTY,
+    OWN_PENALTY_LEFT,
+    OWN_PENALTY_RIGHT,
+    OWN_PENALTY_SHOOTMARK,
+    OPP_GOALBOX_BACK,
+    OPP_GOALBOX_LEFT,
+    OPP_GOALBOX_RIGHT,
+    OWN_GOALBOX_BACK,
+    OWN_GOALBOX_LEFT,
+    OWN_GOALBOX_RIGHT,
+    CENTER_CIRCLE,
+    UNKNOWN
+};
+static const size_t LineMAX = static_cast<size_t>(Line::CENTER_CIRCLE);
+
+
+/* This are the Crose names, do not change, theire are used in jslinemathing */
+/* TODO: take names that are intuitive ... like it has been done with the lines */
+/* The Crosses are seen from the center point of the field, facing the enemy goal*/
+/*
+ *      -x    Left        x
+ * |------------------------|
+ * |           |            | y
+ * |--         |          --|
+ * |  |        |         |  |
+ * |  |        x-->      |  | Top
+ * |  |        |         |  |
+ * |--         |          --| -y
+ * |           |            |
+ * |------------------------|
+ *  own half  Right   opposite
+ */
+
+
+enum class Cross {
+    L_OPP_LEFT,
+    T_LEFT,
+    L_OWN_LEFT,
+    L_OPP_RIGHT,
+    T_RIGHT,
+    L_OWN_RIGHT,
+    X_LEFT,
+    X_RIGHT,
+    T_OPP_GOAL_LEFT,
+    T_OPP_GOAL_RIGHT,
+    L_OPP_GOAL_LEFT,
+    L_OPP_GOAL_RIGHT,
+    L_OPP_GOALBOX_LEFT,
+    L_OPP_GOALBOX_RIGHT,
+    T_OPP_GOALBOX_LEFT,
+    T_OPP_GOALBOX_RIGHT,
+    L_OWN_GOAL_LEFT,
+    L_OWN_GOAL_RIGHT,
+    L_OWN_GOALBOX_LEFT,
+    L_OWN_GOALBOX_RIGHT,
+    T_OWN_GOAL_LEFT,
+    T_OWN_GOAL_RIGHT,
+    T_OWN_GOALBOX_LEFT,
+    T_OWN_GOALBOX_RIGHT
+};
+static const size_t CrossMAX = static_cast<size_t>(Cross::T_OWN_GOALBOX_RIGHT) +
+                               1;
+
+
+/* also used in linemathing */
+enum class Pole {
+    OPP_LEFT,
+    OPP_RIGHT,
+    OWN_LEFT,
+    OWN_RIGHT
+};
+static const size_t PoleMAX = static_cast<size_t>(Pole::OWN_RIGHT) + 1;
+
+
+
+/** struct for field measurements used by makeFieldModel()
+ * all dimensions are in meter, default values correspond
+ * to current SPL rules
+ */
+struct FieldMeasurements {
+    float fieldLength{9.f};
+    float fieldWidth{6.f};
+    float centerCircleDiameter{1.5f};
+    float penaltyCrossDistance{1.3f};
+    float penaltyAreaLength{0.6f};
+    float penaltyAreaWidth{2.2f};
+    float goalWidth{1.5f};
+    float goalPostDiameter{0.1f};
+    float goalboxDepth{0.5f};
+    float goalPostHeight{0.8f};
+    float borderStripWidth{0.7f};
+    float penaltyCrossSize{0.1f};
+    float lineWidth{0.05f};
+};
+
+// plain (trivially copyable) landmark records, see LandmarkLine/-Cross/-Pole
+struct FieldLineDef {
+    Line name;
+    float start_x; // startpoint in wcs, m
+    float start_y;
+    float end_x; // endpoint
+    float end_y;
+    Line2f equation; // (a,b,c) of a*x+b*y+c=0 in hnf, zero for point-like lines
+    Line2f equationNormal; // (a,b,c) of a*x+b*y+c=0
+};
+
+struct FieldCrossDef {
+    Cross name;
+    float wcs_x; // wcs pose in m
+    float wcs_y;
+    float wcs_alpha; // wcs angle in rad
+    int degree; // 2=L,3=T,4=X
+};
+
+struct FieldPoleDef {
+    Pole name;
+    float wcs_x; // m, wcs position
+    float wcs_y;
+    float wcs_width; // m
+    float wcs_height;
+    int color;
+};
+
+struct FieldModel {
+    FieldMeasurements measurements;
+
+    float length; // incl. border strips
+    float width;
+    float lengthInsideBounds;
+    float widthInsideBounds;
+    float penaltyWidth;
+    float penaltyLength;
+    float goalWidth; // distance between center of goal posts
+    float lineWidth;
+    float outerDiagonal;
+    float innerDiagonal;
+    float penaltyCrossDistance;
+    float penaltyCrossSize;
+    float circleRadius;
+
+    // see PlayingField::centerpointGoaliDefenderCircle
+    float goaliDefenderCircle_x;
+    float goaliDefenderCircle_y;
+    float goaliDefenderCircleRadius;
+
+    std::array<FieldLineDef, LineMAX> lines;
+    std::array<FieldCrossDef, CrossMAX> crosses;
+    std::array<FieldPoleDef, PoleMAX> poles;
+};
+
+
+namespace fieldmodel {
+
+constexpr FieldLineDef makeLine(const Line name, const float startX,
+        const float startY, const float endX, const float endY) {
+    const Line2f normal = Line2f::through(Vec3f::point(startX, startY),
+                                          Vec3f::point(endX, endY));
+    return {name, startX, startY, endX, endY, normal.hesseNormalForm(), normal};
+}
+
+constexpr FieldCrossDef makeCross(const Cross name, const float x,
+        const float y, const float alpha, const int degree) {
+    return {name, x, y, alpha, degree};
+}
+
+constexpr FieldPoleDef makePole(const Pole name, const float x, const float y,
+        const float height, const float width, const int color) {
+    return {name, x, y, width, height, color};
+}
+
+} // namespace fieldmodel
+
+
+/**
+ * create playingfield lines, crosses, poles etc. from field measurements.
+ * evaluated by the compiler for the built-in presets, usable at runtime
+ * for custom measurements.
+ */
+constexpr FieldModel makeFieldModel(const FieldMeasurements &fm) {
+    using namespace fieldmodel;
+    FieldModel m{};
+    m.measurements = fm;
+
+    // total size of field (playing area + border strips)
+    m.length = fm.fieldLength + 2 * fm.borderStripWidth;
+    m.width = fm.fieldWidth + 2 * fm.borderStripWidth;
+
+    // set length and width (of area inside the lines) in meters
+    m.lengthInsideBounds = fm.fieldLength;
+    m.widthInsideBounds = fm.fieldWidth;
+    m.lineWidth = fm.lineWidth;
+
+    // set Goal width (distance between center of goal posts)
+    m.goalWidth = fm.goalWidth + fm.goalPostDiameter;
+
+    m.penaltyLength = fm.penaltyAreaLength;
+    m.penaltyWidth = fm.penaltyAreaWidth;
+    m.penaltyCrossDistance = fm.penaltyCrossDistance;
+    m.penaltyCrossSize = fm.penaltyCrossSize;
+    m.circleRadius = fm.centerCircleDiameter / 2.f;
+
+    const float x = fm.fieldLength / 2.f;
+    const float y = fm.fieldWidth / 2.f;
+
+    auto setLine = [&m](const Line name, const float sx, const float sy,
+                        const float ex, const float ey) {
+        m.lines[static_cast<size_t>(name)] = makeLine(name, sx, sy, ex, ey);
+    };
+
+    // outer borders
+    setLine(Line::LEFT,      x,     y,    -x,     y);
+    setLine(Line::RIGHT,     x,    -y,    -x,    -y);
+    setLine(Line::TOP,       x,     y,     x,    -y);
+    setLine(Line::BOTTOM,   -x,     y,    -x,    -y);
+
+    // center line
+    setLine(Line::MIDDLE, 0.0f,     y,  0.0f,    -y);
+
+    const float px = x - fm.penaltyAreaLength;
+    const float py = fm.penaltyAreaWidth / 2.f;
+    const float mx = x - fm.penaltyCrossDistance;
+
+    // opponent's penalty area
+    setLine(Line::OPP_PENALTY,            px,    py,  px,  -py);
+    setLine(Line::OPP_PENALTY_LEFT,        x,    py,  px,   py);
+    setLine(Line::OPP_PENALTY_RIGHT,       x,   -py,  px,  -py);
+    setLine(Line::OPP_PENALTY_SHOOTMARK,  mx,  0.0f,  mx, 0.0f);
+
+    // our penalty area
+    setLine(Line::OWN_PENALTY,           -px,    py, -px,  -py);
+    setLine(Line::OWN_PENALTY_LEFT,       -x,    py, -px,   py);
+    setLine(Line::OWN_PENALTY_RIGHT,      -x,   -py, -px,  -py);
+    setLine(Line::OWN_PENALTY_SHOOTMARK, -mx,  0.0f, -mx, 0.0f);
+
+    // goalbox
+    const float gbCorner_y = fm.goalWidth/2 + fm.goalPostDiameter/2;
+    const float frontCorner_x = fm.fieldLength/2;
+    const float gbBackCorner_x = frontCorner_x + fm.goalboxDepth;
+
+    setLine(Line::OPP_GOALBOX_BACK,   gbBackCorner_x,  gbCorner_y,  gbBackCorner_x, -gbCorner_y);
+    setLine(Line::OPP_GOALBOX_LEFT,    frontCorner_x,  gbCorner_y,  gbBackCorner_x,  gbCorner_y);
+    setLine(Line::OPP_GOALBOX_RIGHT,   frontCorner_x, -gbCorner_y,  gbBackCorner_x, -gbCorner_y);
+    setLine(Line::OWN_GOALBOX_BACK,  -gbBackCorner_x,  gbCorner_y, -gbBackCorner_x, -gbCorner_y);
+    setLine(Line::OWN_GOALBOX_LEFT,   -frontCorner_x,  gbCorner_y, -gbBackCorner_x,  gbCorner_y);
+    setLine(Line::OWN_GOALBOX_RIGHT,  -frontCorner_x, -gbCorner_y, -gbBackCorner_x, -gbCorner_y);
+
+    const float c = fm.centerCircleDiameter / 2.0f;
+
+    auto setCross = [&m](const Cross name, const float cx, const float cy,
+                         const float alpha, const int degree) {
+        m.crosses[static_cast<size_t>(name)] = makeCross(name, cx, cy, alpha, degree);
+    };
+
+    // these are the cross definitions
+    setCross(Cross::L_OPP_LEFT,             x,    y, 1.0f * M_PI_F, 2);
+    setCross(Cross::T_LEFT,              0.0f,    y, 1.5f * M_PI_F, 3);
+    setCross(Cross::L_OWN_LEFT,            -x,    y, 1.5f * M_PI_F, 2);
+    setCross(Cross::L_OPP_RIGHT,            x,   -y, 0.5f * M_PI_F, 2);
+    setCross(Cross::T_RIGHT,             0.0f,   -y, 0.5f * M_PI_F, 3);
+    setCross(Cross::L_OWN_RIGHT,           -x,   -y, 0.0f * M_PI_F, 2);
+    setCross(Cross::X_LEFT,              0.0f,    c, 0.5f * M_PI_F, 4);
+    setCross(Cross::X_RIGHT,             0.0f,   -c, 0.5f * M_PI_F, 4);
+    setCross(Cross::T_OPP_GOAL_LEFT,        x,   py, 1.0f * M_PI_F, 3);
+    setCross(Cross::T_OPP_GOAL_RIGHT,       x,  -py, 1.0f * M_PI_F, 3);
+    setCross(Cross::L_OPP_GOAL_LEFT,       px,   py, 1.5f * M_PI_F, 2);
+    setCross(Cross::L_OPP_GOAL_RIGHT,      px,  -py, 0.0f * M_PI_F, 2);
+
+    setCross(Cross::L_OPP_GOALBOX_LEFT,   gbBackCorner_x,  gbCorner_y, M_PI_F, 2);
+    setCross(Cross::L_OPP_GOALBOX_RIGHT,  gbBackCorner_x, -gbCorner_y, 0.5f * M_PI_F, 2);
+    setCross(Cross::T_OPP_GOALBOX_LEFT,                x,  gbCorner_y, 0.0f * M_PI_F, 3);
+    setCross(Cross::T_OPP_GOALBOX_RIGHT,               x, -gbCorner_y, 0.0f * M_PI_F, 3);
+
+    setCross(Cross::L_OWN_GOAL_LEFT,      -px,   py, 1.0f * M_PI_F, 2);
+    setCross(Cross::L_OWN_GOAL_RIGHT,     -px,  -py, 0.5f * M_PI_F, 2);
+
+    setCross(Cross::L_OWN_GOALBOX_LEFT,  -gbBackCorner_x,  gbCorner_y, 1.5f * M_PI_F, 2);
+    setCross(Cross::L_OWN_GOALBOX_RIGHT, -gbBackCorner_x, -gbCorner_y, 0.0f, 2);
+
+    setCross(Cross::T_OWN_GOAL_LEFT,       -x,   py, 0.0f * M_PI_F, 3);
+    setCross(Cross::T_OWN_GOAL_RIGHT,      -x,  -py, 0.0f * M_PI_F, 3);
+
+    setCross(Cross::T_OWN_GOALBOX_LEFT,    -x,  gbCorner_y, 1.0f * M_PI_F, 3);
+    setCross(Cross::T_OWN_GOALBOX_RIGHT,   -x, -gbCorner_y, 1.0f * M_PI_F, 3);
+
+    // poles
+    const float g = (fm.goalWidth + fm.goalPostDiameter) / 2;
+    m.poles[static_cast<size_t>(Pole::OPP_LEFT)] =
+        makePole(Pole::OPP_LEFT,   x,  g, fm.goalPostHeight, fm.goalPostDiameter, 0);
+    m.poles[static_cast<size_t>(Pole::OPP_RIGHT)] =
+        makePole(Pole::OPP_RIGHT,  x, -g, fm.goalPostHeight, fm.goalPostDiameter, 0);
+    m.poles[static_cast<size_t>(Pole::OWN_LEFT)] =
+        makePole(Pole::OWN_LEFT,  -x,  g, fm.goalPostHeight, fm.goalPostDiameter, 0);
+    m.poles[static_cast<size_t>(Pole::OWN_RIGHT)] =
+        makePole(Pole::OWN_RIGHT, -x, -g, fm.goalPostHeight, fm.goalPostDiameter, 0);
+
+    m.outerDiagonal = static_cast<float>(constSqrt(
+                static_cast<double>(m.length) * m.length +
+                static_cast<double>(m.width) * m.width));
+    m.innerDiagonal = static_cast<float>(constSqrt(
+                static_cast<double>(m.lengthInsideBounds) * m.lengthInsideBounds +
+                static_cast<double>(m.widthInsideBounds) * m.widthInsideBounds));
+
+    // according to Tim's transformation:
+    // folgt aus den Verhältnis, dass der Kreis durch die Torpfosten
+    // und den mittelpunkt des Strafraums gehen soll
+    const float xdiff = (m.penaltyWidth/2.0f)*(m.penaltyWidth/2.0f)/(m.penaltyLength)
+                        -((m.penaltyLength)/4);
+    m.goaliDefenderCircle_x = -(m.lengthInsideBounds/2+xdiff);
+    m.goaliDefenderCircle_y = 0.0f;
+    m.goaliDefenderCircleRadius = (m.penaltyLength/2.0f) + xdiff;
+
+    return m;
+}
+
+
+// measurements of the built-in field presets
+namespace fieldpreset {
+
+// This the JRL's permanent playingfield (defined accordning to pre 2012 SPL rules)
+constexpr FieldMeasurements JRL{
+    .fieldLength = 5.95f,
+    .fieldWidth = 3.95f,
+    .centerCircleDiameter = 1.15f,
+    .penaltyCrossDistance = 1.35f
+};
+
+// field for HTWK Leipzig event, May 2014
+constexpr FieldMeasurements HTWK{
+    .fieldLength = 7.5f,
+    .fieldWidth = 5.f
+};
+
+// tiny 4x1.8m field for exhibitions
+constexpr FieldMeasurements TINY{
+    .fieldLength = 4.f,
+    .fieldWidth = 1.75f,
+    .centerCircleDiameter = 0.8f,
+    .penaltyCrossDistance = 1.1f,
+    .penaltyAreaLength = 0.55f,
+    .penaltyAreaWidth = 1.f,
+    .goalWidth = 0.56f,
+    .goalPostDiameter = 0.1f,
+    .goalboxDepth = 0.3f,
+};
+
+// SPL field since 2020 (larger penalty area)
+constexpr FieldMeasurements SPL2020{
+    .fieldLength = 9.f,
+    .fieldWidth = 6.f,
+    .centerCircleDiameter = 1.5f,
+    .penaltyCrossDistance = 1.4f,
+    .penaltyAreaLength = 1.65f,
+    .penaltyAreaWidth = 4.f
+};
+
+// use defaults for current SPL field,
+// according to the Rules 2013 Draft, published on November 8th 2012
+constexpr FieldMeasurements SPL{};
+
+inline constexpr FieldModel JRLModel = makeFieldModel(JRL);
+inline constexpr FieldModel HTWKModel = makeFieldModel(HTWK);
+inline constexpr FieldModel TINYModel = makeFieldModel(TINY);
+inline constexpr FieldModel SPL2020Model = makeFieldModel(SPL2020);
+inline constexpr FieldModel SPLModel = makeFieldModel(SPL);
+
+} // namespace fieldpreset
+
+// the generated table for a built-in field size
+constexpr const FieldModel &getFieldModel(const FieldSize size) {
+    switch (size) {
+    case FieldSize::JRL:
+        return fieldpreset::JRLModel;
+    case FieldSize::HTWK:
+        return fieldpreset::HTWKModel;
+    case FieldSize::TINY:
+        return fieldpreset::TINYModel;
+    case FieldSize::SPL2020:
+        return fieldpreset::SPL2020Model;
+    case FieldSize::SPL:
+    default:
+        return fieldpreset::SPLModel;
+    }
+}
+
+
+// the topology (names, degrees) is the same for every field size,
+// so the number of landmarks per type is a compile time constant.
+constexpr size_t countCrosses(const int degree) {
+    size_t n = 0;
+    for (const auto &c : fieldpreset::SPLModel.crosses) {
+        n += (c.degree == degree) ? 1 : 0;
+    }
+    return n;
+}
+
+static constexpr size_t LCrossCount = countCrosses(2);
+static constexpr size_t TCrossCount = countCrosses(3);
+static constexpr size_t XCrossCount = countCrosses(4);
+
+// indices (enum Cross) of all crosses with the given degree, in enum order
+template <int degree>
+constexpr std::array<size_t, countCrosses(degree)> crossIndices() {
+    std::array<size_t, countCrosses(degree)> ids{};
+    size_t n = 0;
+    for (size_t i = 0; i < CrossMAX; ++i) {
+        if (fieldpreset::SPLModel.crosses[i].degree == degree) {
+            ids[n++] = i;
+        }
+    }
+    return ids;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
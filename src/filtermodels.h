@@ -0,0 +1,123 @@
+/**
+ * observation and motion models of the particle filter, plugged into
+ * BasicParticleFilter as template parameters (no virtual calls in the
+ * per particle loops).
+ *
+ * an observation model has
+ *   explicit Model(const ParticleFilterBase::Settings &conf);
+ *   float likelihood(const Feature &seen, const Feature &expected) const;
+ *   // upper bound of likelihood(seen, ...) for any expected feature
+ *   float maxLikelihood(const Feature &seen) const;
+ * a motion model has
+ *   explicit Model(const ParticleFilterBase::Settings &conf);
+ *   void move(std::vector<Particle> &particles, const DirectedCoord &odometry,
+ *             std::default_random_engine &generator) const;
+ *
+ * the defaults below are the filter as it always was.
+ */
+#pragma once
+
+#include <particlefilterbase.h>
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+/**
+ * product of independent gaussians for the distance, bearing and
+ * orientation error of a feature, noise per feature type (VisionClass).
+ * line orientations have no direction, the smaller of both errors counts.
+ */
+class GaussianObservationModel {
+public:
+    // noise of every feature type from conf.featureNoise / conf.probDeviation
+    explicit GaussianObservationModel(const ParticleFilterBase::Settings &conf) {
+        for (size_t type = 0; type < FeatureTypeMAX; ++type) {
+            noise[type] = conf.noiseOf(static_cast<VisionClass>(type));
+        }
+    }
+
+    float likelihood(const Feature &seen, const Feature &expected) const {
+        const FeatureNoise &n = noise[seen.type];
+        float distance = seen.dist - expected.dist;
+
+        float angle;
+        if ((expected.dist > 0.1f) and (seen.dist > 0.1f)) {
+            angle = fabsf(seen.angle - expected.angle);
+            angle = std::min(angle, 2.0f * M_PI_F - angle);
+        } else {
+            // if there is no distance between robot and landmark, the angle calculation
+            // will not work.
+            angle = 0.0f;
+        }
+
+        // beside the angle from the robot to landmark, the landmark has an orientation.
+        // e.g the orientation of a TCross is the direction of the line that crosses the other line centric
+        // see in BembelbotsTeamResearchReport for Robocup 2019
+        float orientationdist;
+        if (JSVISION_LINE == seen.type) {
+            orientationdist = FastAngle(seen.orientation).dist(FastAngle(expected.orientation)).rad;
+            orientationdist = std::min(fabsf(orientationdist),
+                                       fabsf(FastAngle::wrap(orientationdist - M_PI_F)));
+        } else {
+            orientationdist = FastAngle(seen.orientation).absDist(FastAngle(expected.orientation));
+        }
+
+        return gauss(distance, n.dist) * gauss(angle, n.angle)
+               * gauss(orientationdist, n.orientation);
+    }
+
+    // all errors zero
+    float maxLikelihood(const Feature &seen) const {
+        const FeatureNoise &n = noise[seen.type];
+        return gauss(0.0f, n.dist) * gauss(0.0f, n.angle) * gauss(0.0f, n.orientation);
+    }
+
+    // normal distribution density with mean 0
+    static float gauss(float x, float deviation) {
+        return 1.0f / (deviation * std::sqrt(2 * M_PI_F))
+               * std::exp(-0.5f * powf(x / deviation, 2));
+    }
+
+    std::array<FeatureNoise, FeatureTypeMAX> noise; // indexed by VisionClass
+};
+
+
+/**
+ * odometry (rcs) plus normal distributed noise per particle,
+ * components which did not change get no noise.
+ */
+class OdometryMotionModel {
+public:
+    explicit OdometryMotionModel(const ParticleFilterBase::Settings &conf) :
+        stdev(conf.odoStdev) {}
+
+    void move(std::vector<Particle> &particles, const DirectedCoord &odometry,
+              std::default_random_engine &generator) const {
+        //assume error of odometry is normal distributed
+        // (the mapping of the stdev components is historical and kept for compatibility)
+        std::normal_distribution<double> erroralpha(0.0f, stdev.coord.x);
+        std::normal_distribution<double> errorx(0.0f, stdev.coord.y);
+        std::normal_distribution<double> errory(0.0f, stdev.angle.rad);
+
+        //if robot has moved, move particles
+        if ((odometry.coord.x != 0.0f) or (odometry.coord.y != 0.0f)
+                or (std::abs(odometry.angle.rad) > 0.0001f)) {
+            for (auto &particle: particles) {
+                // the odometry is only zero, if we are'nt moving, then the error is also zero
+                float x = (odometry.coord.x != 0.0f) ? (odometry.coord.x + errorx(generator)) : 0.0f;
+                float y = (odometry.coord.y != 0.0f) ? (odometry.coord.y + errory(generator)) : 0.0f;
+                float angle = (std::abs(odometry.angle.rad) > 0.0001f)
+                              ? (odometry.angle.rad + erroralpha(generator)) : 0.0f;
+                // move particle accoring to the calculatet odometry+error
+                particle.walk(x, y, FastAngle(angle));
+            }
+        }
+    }
+
+    DirectedCoord stdev; // see Settings::odoStdev
+};
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,264 @@
+#include "logsink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// writes are delayed until this much output is buffered, the ring is
+// idle for MAX_DELAY or a flush is requested
+const size_t WRITE_SIZE = 64 * 1024;
+const std::chrono::milliseconds MAX_DELAY(50);
+
+LogLevel levelFromEnv(LogLevel fallback) {
+    const char *env = getenv("PF_LOG_LEVEL");
+    if (!env) {
+        return fallback;
+    }
+    std::string_view s(env);
+    if (s == "error") {
+        return LogLevel::ERROR;
+    } else if (s == "warning") {
+        return LogLevel::WARNING;
+    } else if (s == "info") {
+        return LogLevel::INFO;
+    } else if (s == "debug") {
+        return LogLevel::DEBUG;
+    }
+    return fallback;
+}
+
+}
+
+LogSink::LogSink(int fd, Overflow overflow, size_t slots) :
+    _fd(fd), _ownsFd(false), _overflow(overflow) {
+    init(slots);
+}
+
+LogSink::LogSink(const std::string &filename, Overflow overflow, size_t slots) :
+    _fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+    _ownsFd(true), _overflow(overflow) {
+    init(slots);
+}
+
+void LogSink::init(size_t slots) {
+    // power of two, at least 2
+    size_t n = 2;
+    while (n < slots) {
+        n <<= 1;
+    }
+    _level.store(LogLevel::INFO);
+    _error.store(false);
+    _dropped.store(0);
+    _slots.reset(new Slot[n]);
+    _mask = n - 1;
+    for (size_t i = 0; i < n; ++i) {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    _head.store(0);
+    _written.store(0);
+    _tail = 0;
+    _buffer.reserve(2 * WRITE_SIZE);
+    _stop.store(false);
+    _sleeping.store(false);
+    _flushTarget.store(0);
+    _thread = std::thread(&LogSink::run, this);
+}
+
+LogSink::~LogSink() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop.store(true);
+        _wakeup.notify_one();
+    }
+    _thread.join();
+    if (_ownsFd && _fd >= 0) {
+        close(_fd);
+    }
+}
+
+bool LogSink::write(std::string_view msg) {
+    return write(msg, _overflow);
+}
+
+bool LogSink::write(std::string_view msg, Overflow overflow) {
+    const size_t ringPayload = (_mask + 1) * SLOT_PAYLOAD;
+    if (msg.size() > ringPayload && overflow == DROP) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    while (!msg.empty()) {
+        size_t n = std::min(msg.size(), ringPayload);
+        if (!push(msg.data(), n, overflow)) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        msg.remove_prefix(n);
+    }
+    return true;
+}
+
+// bounded mpmc queue (D. Vyukov), only the writer thread consumes.
+// all slots of the message are reserved with one step of _head
+bool LogSink::push(const char *data, size_t length, Overflow overflow) {
+    const uint64_t count = (length + SLOT_PAYLOAD - 1) / SLOT_PAYLOAD;
+    uint64_t pos = _head.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t seq = _slots[pos & _mask].seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            // slots are freed in order, the last one free means all are
+            const uint64_t last = pos + count - 1;
+            seq = _slots[last & _mask].seq.load(std::memory_order_acquire);
+            diff = static_cast<int64_t>(seq) - static_cast<int64_t>(last);
+            if (diff >= 0) {
+                if (_head.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+                    break;
+                }
+                continue;
+            }
+        }
+        if (diff < 0) {
+            // full
+            if (overflow == DROP) {
+                return false;
+            }
+            notifyWriter();
+            std::this_thread::yield();
+        }
+        pos = _head.load(std::memory_order_relaxed);
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+        Slot &slot = _slots[(pos + i) & _mask];
+        const size_t n = std::min(length - i * SLOT_PAYLOAD, SLOT_PAYLOAD);
+        memcpy(slot.data, data + i * SLOT_PAYLOAD, n);
+        slot.length = static_cast<uint32_t>(n);
+        slot.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    notifyWriter();
+    return true;
+}
+
+// wakes the writer if it sleeps on the empty ring, the fences pair with
+// the ones in run(): either the writer sees the new slots before it goes
+// to sleep or the producer sees it sleeping
+void LogSink::notifyWriter() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wakeup.notify_one();
+    }
+}
+
+// writer thread only: the next slot is filled
+bool LogSink::available() const {
+    return _slots[_tail & _mask].seq.load(std::memory_order_acquire) == _tail + 1;
+}
+
+bool LogSink::pop() {
+    if (!available()) {
+        return false;
+    }
+    Slot &slot = _slots[_tail & _mask];
+    _buffer.append(slot.data, slot.length);
+    slot.seq.store(_tail + _mask + 1, std::memory_order_release);
+    ++_tail;
+    return true;
+}
+
+void LogSink::writeBuffer() {
+    const char *p = _buffer.data();
+    size_t left = _buffer.size();
+    while (left > 0 && _fd >= 0) {
+        ssize_t n = ::write(_fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            _error.store(true);
+            break;
+        }
+        p += n;
+        left -= static_cast<size_t>(n);
+    }
+    _buffer.clear();
+}
+
+void LogSink::run() {
+    auto lastWrite = std::chrono::steady_clock::now();
+    for (;;) {
+        bool got = false;
+        while (pop()) {
+            got = true;
+            if (_buffer.size() >= WRITE_SIZE) {
+                writeBuffer();
+                lastWrite = std::chrono::steady_clock::now();
+            }
+        }
+        bool stop = _stop.load();
+        bool flushing = _flushTarget.load() > _written.load();
+        auto now = std::chrono::steady_clock::now();
+        if (!_buffer.empty() && (stop || flushing || now - lastWrite >= MAX_DELAY)) {
+            writeBuffer();
+            lastWrite = now;
+        }
+        if (_buffer.empty()) {
+            // everything popped so far is on the device
+            uint64_t before = _written.exchange(_tail);
+            if (_flushTarget.load() > before) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _flushed.notify_all();
+            }
+        }
+        if (stop && !got && _buffer.empty()) {
+            break;
+        }
+        if (!got) {
+            // until something is queued, stop or flush is requested, or the
+            // buffered output is due
+            std::unique_lock<std::mutex> lock(_mutex);
+            _sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto ready = [this]() {
+                return available() || _stop.load() || _flushTarget.load() > _written.load();
+            };
+            if (_buffer.empty()) {
+                _wakeup.wait(lock, ready);
+            } else {
+                _wakeup.wait_until(lock, lastWrite + MAX_DELAY, ready);
+            }
+            _sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+}
+
+void LogSink::flush() {
+    uint64_t target = _head.load();
+    uint64_t current = _flushTarget.load();
+    while (current < target && !_flushTarget.compare_exchange_weak(current, target)) {
+    }
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wakeup.notify_one();
+    _flushed.wait(lock, [this, target]() {
+        return _written.load() >= target;
+    });
+}
+
+LogSink &consoleLog() {
+    static LogSink sink(STDOUT_FILENO, LogSink::DROP);
+    static const bool configured = []() {
+        sink.setLevel(levelFromEnv(LogLevel::INFO));
+        return true;
+    }();
+    (void) configured;
+    return sink;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
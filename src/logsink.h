@@ -0,0 +1,172 @@
+/**
+ * asynchronous log output
+ *
+ * messages are copied into a lock-free ring of fixed size slots (bounded
+ * multi producer queue), a long message takes several consecutive slots.
+ * a writer thread drains the ring into a large buffer and writes it with
+ * few syscalls, it sleeps while the ring is empty and is woken by the
+ * first message queued after that. producers never wait for the output
+ * device: a full ring drops the whole message (console) or waits for
+ * free slots (files, nothing may get lost), a single message can ask for
+ * BLOCK on a DROP sink. flush() waits until everything written before is
+ * handed to the device.
+ *
+ * the console sink (stdout) is used by the filter for its messages, it
+ * drops under load except for errors. the results of the tools must not
+ * get lost either, they block and are printed at every level:
+ *
+ *   PF_LOG(LogLevel::WARNING) << "event " << ev << " is not handled";
+ *   PF_RESULT << "mean dist: " << meanDist;
+ *
+ * its verbosity is set by setLevel() or the environment variable
+ * PF_LOG_LEVEL=error|warning|info|debug (default: info).
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+enum class LogLevel {
+    ERROR,
+    WARNING,
+    INFO,
+    DEBUG
+};
+
+class LogSink {
+public:
+    enum Overflow {
+        DROP, ///< drop messages if the ring is full, never blocks
+        BLOCK ///< wait for the writer thread if the ring is full
+    };
+
+    // write to an open file descriptor, which is not closed by the sink
+    LogSink(int fd, Overflow overflow, size_t slots = 4096);
+    // create/truncate the file
+    LogSink(const std::string &filename, Overflow overflow, size_t slots = 4096);
+    // flushes and stops the writer thread
+    ~LogSink();
+
+    LogSink(const LogSink &) = delete;
+    LogSink &operator=(const LogSink &) = delete;
+
+    void setLevel(LogLevel level) {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel level() const {
+        return _level.load(std::memory_order_relaxed);
+    }
+
+    bool enabled(LogLevel level) const {
+        return level <= this->level();
+    }
+
+    // queue the message (no newline is added), false if it was dropped.
+    // messages of one write are never mixed with others, except for
+    // messages longer than the whole ring with BLOCK
+    bool write(std::string_view msg);
+    // same with another overflow handling for this message
+    bool write(std::string_view msg, Overflow overflow);
+
+    // wait until all messages written before are handed to the device
+    void flush();
+
+    // false if the file could not be opened or a write failed
+    bool good() const {
+        return _fd >= 0 && !_error.load(std::memory_order_relaxed);
+    }
+
+    // number of dropped messages (DROP only)
+    uint64_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const size_t SLOT_PAYLOAD = 240;
+
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        uint32_t length;
+        char data[SLOT_PAYLOAD];
+    };
+
+    int _fd;
+    bool _ownsFd;
+    Overflow _overflow;
+    std::atomic<LogLevel> _level;
+    std::atomic<bool> _error;
+    std::atomic<uint64_t> _dropped;
+
+    std::unique_ptr<Slot[]> _slots;
+    uint64_t _mask;
+    alignas(64) std::atomic<uint64_t> _head; // next slot to fill
+    alignas(64) std::atomic<uint64_t> _written; // slots written to the device
+
+    // writer thread
+    uint64_t _tail; // next slot to drain
+    std::string _buffer;
+    std::atomic<bool> _stop;
+    std::atomic<bool> _sleeping; // the writer waits for _wakeup
+    std::atomic<uint64_t> _flushTarget;
+    std::mutex _mutex;
+    std::condition_variable _wakeup, _flushed;
+    std::thread _thread;
+
+    void init(size_t slots);
+    bool push(const char *data, size_t length, Overflow overflow);
+    void notifyWriter();
+    bool available() const;
+    bool pop();
+    void writeBuffer();
+    void run();
+};
+
+// stdout sink used by the filter and the test programs
+LogSink &consoleLog();
+
+// collects one message and queues it (with newline) when destroyed
+class LogLine {
+public:
+    explicit LogLine(LogSink &sink) : _sink(sink), _block(false) {}
+    // block: never dropped, see LogSink::BLOCK
+    LogLine(LogSink &sink, bool block) : _sink(sink), _block(block) {}
+    ~LogLine() {
+        _stream << '\n';
+        if (_block) {
+            _sink.write(_stream.str(), LogSink::BLOCK);
+        } else {
+            _sink.write(_stream.str());
+        }
+    }
+
+    template<typename T>
+    LogLine &operator<<(const T &value) {
+        _stream << value;
+        return *this;
+    }
+
+private:
+    LogSink &_sink;
+    bool _block;
+    std::ostringstream _stream;
+};
+
+// message to the console sink, the arguments are only evaluated if enabled.
+// errors are never dropped
+#define PF_LOG(level) \
+    if (!consoleLog().enabled(level)) {} else LogLine(consoleLog(), (level) == LogLevel::ERROR)
+
+// result output of a tool to the console sink, at every level, never dropped
+#define PF_RESULT LogLine(consoleLog(), true)
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
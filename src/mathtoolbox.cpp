@@ -1,52 +1,28 @@
 #include <mathtoolbox.h>
+#include <logsink.h>
 
-#include <iostream>
 #include <vector>
 float lineToPointDist(const std::vector<float> &point,
                       const std::vector<float> &line) {
-    return (point[0] * line[0] + point[1] * line[1] + line[2]) /
-           ((fabsf(line[2]) / -line[2]) * hypotf(line[0], line[1]));
+    return Line2f(Vec3f(line)).pointDist(Vec3f(point));
 }
 
 std::vector<float> vectorCrossProduct(const std::vector<float> &a,
                                       const std::vector<float> &b) {
-
-    return normVector(vectorCrossProductUnNormed(a, b));
+    return Vec3f(a).cross(Vec3f(b)).normed().toVector();
 }
 
 std::vector<float> vectorCrossProductUnNormed(const std::vector<float> &a,
         const std::vector<float> &b) {
-    return std::vector<float> {  a[1] *b[2] - a[2] *b[1],
-                                 a[2] *b[0] - a[0] *b[2],
-                                 a[0] *b[1] - a[1] *b[0]
-                              };
+    return Vec3f(a).cross(Vec3f(b)).toVector();
 }
 
-std::vector<float> getHesseNormalFormOfLine(const std::vector<float> &lineIn) {
-    std::vector<float> line(lineIn);
-
-    float sign = (fabsf(line[2]) / line[2]);
-    if (std::isnan(sign)) {
-        sign = 1.0f;
-    }
-    float hnf = sign * hypotf(line[0], line[1]);
-    line[0] /= hnf;
-    line[1] /= hnf;
-    line[2] /= hnf;
-    return line;
+std::vector<float> getHesseNormalFormOfLine(const std::vector<float> &line) {
+    return Line2f(Vec3f(line)).hesseNormalForm().toVector();
 }
 
-std::vector<float> normVector(const std::vector<float> &vecIn) {
-    std::vector<float> vec(vecIn);
-    // jsassert(3 == vec.size());
-    if (0.0f < fabsf(vec[2])) {
-        vec[0] /= vec[2];
-        vec[1] /= vec[2];
-        vec[2] /= vec[2];
-        return vec;
-    } else {
-        return vec;
-    }
+std::vector<float> normVector(const std::vector<float> &vec) {
+    return Vec3f(vec).normed().toVector();
 }
 
 Measurement1D::Measurement1D()
@@ -133,7 +109,7 @@ Coord intersection(const line_t &m, const line_t &n) {
     auto cr = (x1 - x2) * (y3 - y4) - (y1 - y2) * (x3 - x4);
 
     if (cr == 0) {
-        std::cerr << "Mathtoolbox intersection: Lines parallel." << std::endl;
+        PF_LOG(LogLevel::WARNING) << "Mathtoolbox intersection: Lines parallel.";
     }
 
     return {nx / cr, ny / cr};
@@ -13,6 +13,106 @@ constexpr float operator "" _deg(long double value) {
 }
 
 
+// sqrt usable in constant expressions (newton iteration in double precision)
+constexpr double constSqrt(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    double r = x < 1.0 ? 1.0 : x;
+    for (int i = 0; i < 64; ++i) {
+        const double next = 0.5 * (r + x / r);
+        if (next == r) {
+            break;
+        }
+        r = next;
+    }
+    return r;
+}
+
+
+/**
+* 2d homogenius vector, a point (x, y, 1) or a line (a, b, c)
+* plain value type without heap allocation, use these instead of the
+* std::vector<float> functions below (kept as adapters)
+*/
+struct Vec3f {
+    float v[3];
+
+    constexpr Vec3f() : v{0.f, 0.f, 0.f} {}
+    constexpr Vec3f(float a, float b, float c) : v{a, b, c} {}
+    explicit Vec3f(const std::vector<float> &vec) : v{vec[0], vec[1], vec[2]} {}
+
+    // homogenius point
+    static constexpr Vec3f point(float x, float y) {
+        return {x, y, 1.f};
+    }
+
+    constexpr float &operator[](size_t i) {
+        return v[i];
+    }
+    constexpr const float &operator[](size_t i) const {
+        return v[i];
+    }
+
+    constexpr float dot(const Vec3f &o) const {
+        return v[0] * o.v[0] + v[1] * o.v[1] + v[2] * o.v[2];
+    }
+
+    // see vectorCrossProductUnNormed
+    constexpr Vec3f cross(const Vec3f &o) const {
+        return {v[1] * o.v[2] - v[2] * o.v[1],
+                v[2] * o.v[0] - v[0] * o.v[2],
+                v[0] * o.v[1] - v[1] * o.v[0]};
+    }
+
+    // scaled so that the 3rd component is 1, unchanged if it is 0 (see normVector)
+    constexpr Vec3f normed() const {
+        if (v[2] != 0.f) {
+            return {v[0] / v[2], v[1] / v[2], 1.f};
+        }
+        return *this;
+    }
+
+    std::vector<float> toVector() const {
+        return {v[0], v[1], v[2]};
+    }
+};
+
+/**
+* line (a, b, c) of the line equation a*x+b*y+c=0
+*/
+struct Line2f : Vec3f {
+    constexpr Line2f() : Vec3f() {}
+    constexpr Line2f(float a, float b, float c) : Vec3f(a, b, c) {}
+    constexpr explicit Line2f(const Vec3f &abc) : Vec3f(abc) {}
+
+    // line through two homogenius points
+    static constexpr Line2f through(const Vec3f &p, const Vec3f &q) {
+        return Line2f(p.cross(q));
+    }
+
+    /**
+    * hesse normal form: (a, b) is a unit vector and c >= 0,
+    * point-like lines (a = b = 0) give all zeros
+    */
+    constexpr Line2f hesseNormalForm() const {
+        const float sign = (v[2] < 0.f) ? -1.f : 1.f;
+        const float norm = static_cast<float>(constSqrt(
+                static_cast<double>(v[0]) * v[0] + static_cast<double>(v[1]) * v[1]));
+        if (norm > 0.f) {
+            return {v[0] / (sign * norm), v[1] / (sign * norm), v[2] / (sign * norm)};
+        }
+        return {};
+    }
+
+    // signed distance of a homogenius point (see lineToPointDist)
+    float pointDist(const Vec3f &p) const {
+        const float sign = (v[2] < 0.f) ? 1.f : -1.f;
+        return (p[0] * v[0] + p[1] * v[1] + v[2]) / (sign * hypotf(v[0], v[1]));
+    }
+};
+
+
 /**
 * calculates the distance from a point to a line
 * all in homogenius coordinates
@@ -5,44 +5,202 @@
  */
 
 #include <array>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 #include <iostream>
 #include <stdlib.h>
 #include <constants.h>
+#include <logsink.h>
 #include <algorithm>
 
-#include "particlefilter.h"
+#include "particlefilterimpl.h"
 
 using namespace std;
 
 Particle::Particle(const DirectedCoord &data, const float &w)
-    : weight(w), pose(data) {}
+    : weight(w), pose(data), cosTheta(std::cos(data.angle.rad)),
+      sinTheta(std::sin(data.angle.rad)) {}
 
 
 void Particle::setParticle(const DirectedCoord &data, const float &w) {
-    pose = data;
+    setPose(data);
     weight = w;
 }
 
+void Particle::setPose(const DirectedCoord &data) {
+    pose = data;
+    cosTheta = std::cos(data.angle.rad);
+    sinTheta = std::sin(data.angle.rad);
+}
+
 Feature::Feature(){};
 
 Feature::Feature(const int type, const float dist, const float angle,
-                 const float orientation = 0.0f, const int id = 0)
+                 const float orientation, const int id)
     : type(type), dist(dist), angle(angle), orientation(orientation),id(id){}
 
+namespace {
+
+// settings file keys of Settings::featureNoise
+const pair<VisionClass, const char *> FEATURE_NOISE_KEYS[] = {
+    {JSVISION_LINE, "lineDeviation"}, {JSVISION_LCROSS, "lcrossDeviation"},
+    {JSVISION_TCROSS, "tcrossDeviation"}, {JSVISION_XCROSS, "xcrossDeviation"},
+    {JSVISION_CIRCLE, "circleDeviation"}, {JSVISION_PENALTY, "penaltyDeviation"},
+    {JSVISION_GOAL, "goalDeviation"}
+};
+
+}
+
 // get my default initial parameters
-ParticleFilter::Settings::Settings(PlayingField *pf) :
+ParticleFilterBase::Settings::Settings(PlayingField *pf) :
     pf(pf),numParticles(80),
     odoStdev(DirectedCoord(0.01f, 0.01f, 0.005f)),
-    robot_id(1), has_kickoff(1), role(RobotRole::STRIKER)
+    robot_id(1), has_kickoff(1), role(RobotRole::STRIKER),
+    compactParticles(false),
+    probDeviation(0.8f), featureNoise(),
+    replacementShare(0.02f), replacementShareMulti(0.05f),
+    adjustmentDist(1.5f), pruneShare(0.0f), refineShare(0.0f), coarseObservations(1),
+    globalGridStep(0.5f), globalGridAngles(16), globalCells(8), globalThreads(0),
+    globalFit(0.5f), globalFrames(3),
+    seed(std::default_random_engine::default_seed)
      {}
 
+FeatureNoise ParticleFilterBase::Settings::noiseOf(VisionClass type) const {
+    FeatureNoise n = featureNoise.at(type);
+    for (float *v: {&n.dist, &n.angle, &n.orientation}) {
+        if (*v == 0.0f) {
+            *v = probDeviation;
+        }
+    }
+    return n;
+}
 
-ParticleFilter::ParticleFilter(const Settings &config):
+bool ParticleFilterBase::Settings::load(const std::string &filename) {
+    ifstream in(filename);
+    if (!in) {
+        PF_LOG(LogLevel::ERROR) << "can not read settings file " << filename;
+        return false;
+    }
+    bool ok = true;
+    int lineNumber = 0;
+    for (string line; getline(in, line);) {
+        ++lineNumber;
+        size_t eq = line.find('=');
+        if (line.empty() || line[0] == '#' || eq == string::npos) {
+            continue;
+        }
+        string key = line.substr(0, eq);
+        key.erase(key.find_last_not_of(" \t") + 1);
+        istringstream value(line.substr(eq + 1));
+        int role_ = 0;
+        FeatureNoise *noise = nullptr;
+        for (const auto &k: FEATURE_NOISE_KEYS) {
+            if (key == k.second) {
+                noise = &featureNoise[k.first];
+            }
+        }
+        if (noise) {
+            value >> noise->dist >> noise->angle >> noise->orientation;
+        } else if (key == "numParticles") {
+            value >> numParticles;
+        } else if (key == "odoStdev") {
+            value >> odoStdev.coord.x >> odoStdev.coord.y >> odoStdev.angle.rad;
+        } else if (key == "robot_id") {
+            value >> robot_id;
+        } else if (key == "has_kickoff") {
+            value >> has_kickoff;
+        } else if (key == "role" && value >> role_) {
+            role = static_cast<RobotRole>(role_);
+        } else if (key == "compactParticles") {
+            value >> compactParticles;
+        } else if (key == "probDeviation") {
+            value >> probDeviation;
+        } else if (key == "replacementShare") {
+            value >> replacementShare;
+        } else if (key == "replacementShareMulti") {
+            value >> replacementShareMulti;
+        } else if (key == "adjustmentDist") {
+            value >> adjustmentDist;
+        } else if (key == "pruneShare") {
+            value >> pruneShare;
+        } else if (key == "refineShare") {
+            value >> refineShare;
+        } else if (key == "coarseObservations") {
+            value >> coarseObservations;
+        } else if (key == "globalGridStep") {
+            value >> globalGridStep;
+        } else if (key == "globalGridAngles") {
+            value >> globalGridAngles;
+        } else if (key == "globalCells") {
+            value >> globalCells;
+        } else if (key == "globalThreads") {
+            value >> globalThreads;
+        } else if (key == "globalFit") {
+            value >> globalFit;
+        } else if (key == "globalFrames") {
+            value >> globalFrames;
+        } else if (key == "seed") {
+            value >> seed;
+        } else {
+            PF_LOG(LogLevel::WARNING) << filename << ":" << lineNumber
+                                      << ": unknown setting " << key;
+            ok = false;
+            continue;
+        }
+        if (value.fail()) {
+            PF_LOG(LogLevel::WARNING) << filename << ":" << lineNumber
+                                      << ": invalid value for " << key;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool ParticleFilterBase::Settings::save(const std::string &filename) const {
+    ofstream out(filename);
+    out << setprecision(9);
+    out << "# particle filter settings\n"
+        << "numParticles = " << numParticles << "\n"
+        << "odoStdev = " << odoStdev.coord.x << " " << odoStdev.coord.y << " "
+        << odoStdev.angle.rad << "\n"
+        << "robot_id = " << robot_id << "\n"
+        << "has_kickoff = " << has_kickoff << "\n"
+        << "role = " << static_cast<int>(role) << "\n"
+        << "compactParticles = " << compactParticles << "\n"
+        << "probDeviation = " << probDeviation << "\n";
+    for (const auto &k: FEATURE_NOISE_KEYS) {
+        const FeatureNoise &n = featureNoise[k.first];
+        out << k.second << " = " << n.dist << " " << n.angle << " " << n.orientation << "\n";
+    }
+    out << "replacementShare = " << replacementShare << "\n"
+        << "replacementShareMulti = " << replacementShareMulti << "\n"
+        << "adjustmentDist = " << adjustmentDist << "\n"
+        << "pruneShare = " << pruneShare << "\n"
+        << "refineShare = " << refineShare << "\n"
+        << "coarseObservations = " << coarseObservations << "\n"
+        << "globalGridStep = " << globalGridStep << "\n"
+        << "globalGridAngles = " << globalGridAngles << "\n"
+        << "globalCells = " << globalCells << "\n"
+        << "globalThreads = " << globalThreads << "\n"
+        << "globalFit = " << globalFit << "\n"
+        << "globalFrames = " << globalFrames << "\n"
+        << "seed = " << seed << "\n";
+    return static_cast<bool>(out);
+}
+
+
+ParticleFilterBase::ParticleFilterBase(const Settings &config):
     conf(config),pos(DirectedCoord(0.0f, 0.0f, 0.0f)),confidence (0.0f),
+    generator(config.seed),
     lastMcsPosition(config.startMcsPosition), 
     isFallenRobot(false), isReplaced(false),isPenalized(false),
-    penalizedGamestate(GameState::INITIAL),gamestate(GameState::INITIAL){    
+    penalizedGamestate(GameState::INITIAL),gamestate(GameState::INITIAL),
+    measurementFit(1.0f), collapsedFrames(0), globalRequested(false){    
     
+    initPointTables();
+    initLineTable();
     //initialize particels
     for (uint i = 0; i < conf.numParticles; ++i) {
         particles.push_back(Particle(conf.startPosition, 1.0f/conf.numParticles));
@@ -51,43 +209,53 @@ ParticleFilter::ParticleFilter(const Settings &config):
     initHandler();
     //State events
     handle_event(EV_STATE_INITIAL, function<void()>(
-                     bind(&ParticleFilter::initHandler, this)));
+                     bind(&ParticleFilterBase::initHandler, this)));
     handle_event(EV_STATE_READY, function<void()>(
-                     bind(&ParticleFilter::readyHandler, this)));
+                     bind(&ParticleFilterBase::readyHandler, this)));
     handle_event(EV_STATE_SET, function<void()>(
-                     bind(&ParticleFilter::setHandler, this)));
+                     bind(&ParticleFilterBase::setHandler, this)));
     handle_event(EV_STATE_PLAYING, function<void()>(
-                     bind(&ParticleFilter::playHandler, this)));
+                     bind(&ParticleFilterBase::playHandler, this)));
     handle_event(EV_PENALIZED, function<void()>(
-                     bind(&ParticleFilter::penalizedHandler, this)));
+                     bind(&ParticleFilterBase::penalizedHandler, this)));
     handle_event(EV_UNPENALIZED, function<void()>(
-                     bind(&ParticleFilter::unpenalizedHandler, this)));
+                     bind(&ParticleFilterBase::unpenalizedHandler, this)));
     //lost ground event
     handle_event(EV_FALLEN,[&](){isFallenRobot = true;});
     //back on ground event
     handle_event(EV_BACK_UP, function<void()>(
-                     bind(&ParticleFilter::standUpHandler, this)));
+                     bind(&ParticleFilterBase::standUpHandler, this)));
+    if (conf.compactParticles) {
+        storeCompactParticles();
+    }
 }
-ParticleFilter::~ParticleFilter() {}
+ParticleFilterBase::~ParticleFilterBase() {}
 
-void ParticleFilter::handle_event(const tLocalizationEvent &ev,
+void ParticleFilterBase::handle_event(const tLocalizationEvent &ev,
                                 std::function<void()> handler) {
     ev_callbacks[ev] = handler;
 }
 
-void ParticleFilter::emit_event(const tLocalizationEvent &ev) {
+void ParticleFilterBase::emit_event(const tLocalizationEvent &ev) {
     if (conf.pf == NULL) {
         return;
     }
     if (ev_callbacks.find(ev) != ev_callbacks.end()) {
+        // the handlers work on the float particles
+        if (conf.compactParticles) {
+            loadCompactParticles();
+        }
         ev_callbacks.at(ev)();
+        if (conf.compactParticles) {
+            storeCompactParticles();
+        }
     } else {
-        cout << "Localization event: " << (int) ev << " is not handled!";
+        PF_LOG(LogLevel::WARNING) << "Localization event: " << (int) ev << " is not handled!";
     }
 }
 
 //spread particles around initial position of the robot
-void ParticleFilter::initHandler() {
+void ParticleFilterBase::initHandler() {
     gamestate = GameState::INITIAL;
     vector<DirectedCoord> inits = {conf.pf->getInitialPose().at(conf.robot_id)};
     float deviation = conf.pf->_lengthInsideBounds/50.0f;   
@@ -96,29 +264,29 @@ void ParticleFilter::initHandler() {
 }
 
 
-void ParticleFilter::playHandler() {
+void ParticleFilterBase::playHandler() {
     gamestate = GameState::PLAYING;
 }
 
-void ParticleFilter::readyHandler() {
+void ParticleFilterBase::readyHandler() {
     if (gamestate == GameState:: INITIAL) {
         initHandler();
     }
     gamestate = GameState::READY;
 }
-void ParticleFilter::setHandler() {
+void ParticleFilterBase::setHandler() {
     penaltyKickHandler();   // robots for penalty kick are placed in set state
     gamestate = GameState::SET;
 }
 
 //spread particles on both sides at the boundary in our half
-void ParticleFilter::penalizedHandler() {
+void ParticleFilterBase::penalizedHandler() {
     penalizedGamestate = gamestate;
     isPenalized = true;
 }
 
 //spread particles on both sides at the boundary in our half
-void ParticleFilter::unpenalizedHandler() {
+void ParticleFilterBase::unpenalizedHandler() {
     isPenalized = false;
 
     // in unpenalized the both possible positions(on the both sidelines the rbot could be placed after
@@ -142,7 +310,7 @@ void ParticleFilter::unpenalizedHandler() {
 }
 
 //spread particles equaly on position with given deviation
-void ParticleFilter::setParticlesToPosition(vector<DirectedCoord> positions, 
+void ParticleFilterBase::setParticlesToPosition(vector<DirectedCoord> positions, 
                                                     float deviationX , float deviationY,
                                                     float deviationAlpha, float amount) {
     normal_distribution <float> distributionX(0.0f, deviationX);
@@ -151,14 +319,14 @@ void ParticleFilter::setParticlesToPosition(vector<DirectedCoord> positions,
     amount = max(amount*conf.numParticles, 1.f);
     for (uint i_particle = 0 ; i_particle < amount; i_particle++){
         int i_pos = i_particle % positions.size();
-        particles.at(i_particle).pose = DirectedCoord(positions.at(i_pos).coord.x + distributionX(generator),
+        particles.at(i_particle).setPose(DirectedCoord(positions.at(i_pos).coord.x + distributionX(generator),
                               positions.at(i_pos).coord.y + distributionY(generator),
-                              positions.at(i_pos).angle.rad + distributionAlpha(generator));
+                              positions.at(i_pos).angle.rad + distributionAlpha(generator)));
         particles.at(i_particle).weight = 1.0f/conf.numParticles;
     }
 }
 
-void ParticleFilter::standUpHandler() {
+void ParticleFilterBase::standUpHandler() {
     isFallenRobot = false;
     if (gamestate == GameState::INITIAL){
         initHandler();
@@ -169,7 +337,7 @@ void ParticleFilter::standUpHandler() {
 }
 
 //spread particles at possible positions wihle manual placement
-void ParticleFilter::manualPlacementHandler() {
+void ParticleFilterBase::manualPlacementHandler() {
     if (!isPenalized){
         isReplaced = true;
         
@@ -187,7 +355,7 @@ void ParticleFilter::manualPlacementHandler() {
 
 // calculate particle positions for general penalty kick challenge
 // does nothing if role is neither PENALTYKICKER nor PENALTYGOALIE
-void ParticleFilter::penaltyKickHandler() {
+void ParticleFilterBase::penaltyKickHandler() {
     if (conf.role == RobotRole::PENALTYKICKER) {
 
         constexpr auto errorX{0.2f}, errorY{0.2f}, errorA{0.2f};
@@ -211,209 +379,9 @@ void ParticleFilter::penaltyKickHandler() {
 }
 
 
-//function gets mcs state and move particles
-void ParticleFilter::moveParticles(const DirectedCoord &currMcsPosition) {
-    //cout << isReplaced<< (gamestate == GameState:: INITIAL) <<isPenalized<<isFallenRobot<<endl;
-    if ((isReplaced) or (gamestate == GameState:: INITIAL) or (isPenalized)) {
-        // if robot has been replaced ignore odometry
-        lastMcsPosition = currMcsPosition;
-        isReplaced = false;
-        return;
-    }
-    if (isFallenRobot) {
-        return;
-    }
-    //caculate odometry: difference between the last MCS_Position and the actual MCS_ Position
-    //use the toRCS function to get the differenc in RCS Coordinate System
-    DirectedCoord odometry = (currMcsPosition - lastMcsPosition);
-    odometry.coord = Coord(currMcsPosition.toRCS(lastMcsPosition).coord);
-    lastMcsPosition = DirectedCoord(currMcsPosition);
-
-    //assume error of odometry is normal distributed
-    normal_distribution<double> erroralpha(0.0f, conf.odoStdev.coord.x);
-    normal_distribution<double> errorx(0.0f, conf.odoStdev.coord.y);
-    normal_distribution<double> errory(0.0f, conf.odoStdev.angle.rad);
-
-    //if robot has moved, move particles
-    if ((odometry.coord.x != 0.0f) or (odometry.coord.y != 0.0f)
-            or (abs(odometry.angle.rad)> 0.0001f)) {
-        // particle 0 is moved according to the odometry without error
-        /*particles.at(0).pose = particles.at(0).pose.walk(DirectedCoord(
-                                   odometry.coord.x, odometry.coord.y, odometry.angle.rad));*/
-        for (auto &particle: particles) {
-            // the odometry is only zero, if we are'nt moving, then the error is also zero
-            float x = (odometry.coord.x != 0.0f) ? (odometry.coord.x + errorx(
-                    generator)):0.0f;
-            float y = (odometry.coord.y != 0.0f) ? (odometry.coord.y + errory(
-                    generator)):0.0f;
-            float angle =(abs(odometry.angle.rad)> 0.0001f) ? (odometry.angle.rad
-                         +erroralpha(generator)):0.0f;
-            // move particle accoring to the calculatet odometry+error
-            // use walk function to rotate Coords to the WCS Coordinate system.
-            particle.pose = particle.pose.walk(DirectedCoord(x, y, angle));
-        }
-    }
-}
-
-/*
-calculate a probability for one visionResult by comparing it with the landmarks from the same type
-*/
-std::pair<float,Feature> ParticleFilter::calculateProbabilityOfMatchingLandmark(
-    Feature visionresult, vector<Feature> pfLandmarks) {
-    // calculate probability by comparing angle and distance
-    float probability = 0.0f;
-    Feature matchedLandmark;
-    for (auto pfLandmark: pfLandmarks) {
-
-        assert(visionresult.type == pfLandmark.type);
-
-        float distance = visionresult.dist - pfLandmark.dist;
-        
-        float angle;
-        if ((pfLandmark.dist > 0.1f) and (visionresult.dist > 0.1f)) {
-            angle = fabsf(visionresult.angle - pfLandmark.angle);
-            angle = min(angle, 2.0f* M_PI_F - angle);
-        } else {
-            // if there is no distance between robot and landmark, the angle calculation will not work.
-            angle = 0.0f ;
-        }
-
-        // beside the angle from the robot to landmark, the landmark has an orientation.
-        // e.g the orientation of a TCross is the direction of the line that crosses the other line centric
-        // see in BembelbotsTeamResearchReport for Robocup 2019
-        float orientationdist;
-        if (JSVISION_LINE == visionresult.type){
-            orientationdist = Angle(visionresult.orientation).dist(pfLandmark.orientation).rad;
-            orientationdist = min(fabsf(orientationdist), fabsf(Angle(orientationdist - M_PI_F).rad)); //for lines the direction is not clear :/
-        }
-        else{
-            orientationdist = fabsf(Angle(visionresult.orientation).dist(pfLandmark.orientation).rad);
-        }
-
-        float tmpProb = prob(distance) * prob(angle)* prob(orientationdist);
-        
-        //choose the highest probability
-        if (tmpProb > probability) {
-            matchedLandmark = pfLandmark;
-            probability = tmpProb;
-        }
-    }
-    return {probability, matchedLandmark};
-
-}
-/*
-calculate new weights of particles by comparing the visionresults with the conf.pf landmarks
-returns if weighting of particles was sucsessful
-
-*/
-bool ParticleFilter::measurementModel(const vector<VisionResult> &vrs) {
-    bool isMeasurementUpdate = false;
-    if (!vrs.empty()) {
-        vector<Feature> vrsGoals;
-        vector<Feature> vrsLines;
-        vector<Feature> vrsLCrosses;
-        vector<Feature> vrsTCrosses;
-        vector<Feature> vrsXCrosses;
-        vector<Feature> vrsCircles;
-        //sort visionresults by type (line, crosses,goals)
-        //extract dist and angle of visionresults and save typedepending Features
-        for (size_t x = 0; x < vrs.size(); x++) {
-            if (vrs.at(x).type == JSVISION_LINE) {
-                //for a line, choose closest point for distance and angle calculation
-                Coord lineStart(vrs.at(x).rcs_x1, vrs.at(x).rcs_y1);
-                Coord lineEnd(vrs.at(x).rcs_x2, vrs.at(x).rcs_y2);
-                if (lineStart.dist(lineEnd) > conf.pf->_penaltyLength+0.1f) {//discard short lines
-                    float orientation = (lineEnd - lineStart).direction();
-                    Coord line = Coord(0.0f, 0.0f).closestPointOnLine(lineStart, lineEnd);
-                    vrsLines.push_back(Feature(JSVISION_LINE, line.dist(), line.angle().rad,
-                                        orientation));
-                }
-            }
-            /*if (vrs.at(x).type == JSVISION_GOAL) {
-                vrsGoals.push_back(Feature(JSVISION_GOAL, vrs.at(x).rcs_distance,
-                                           vrs.at(x).rcs_alpha));
-            }*/
-            if (vrs.at(x).type == JSVISION_LCROSS) {
-                vrsLCrosses.push_back(Feature(JSVISION_LCROSS, vrs.at(x).rcs_distance,
-                                              vrs.at(x).rcs_alpha, vrs.at(x).extra_float));
-            }
-            if (vrs.at(x).type == JSVISION_TCROSS) {
-                vrsTCrosses.push_back(Feature(JSVISION_TCROSS, vrs.at(x).rcs_distance,
-                                              vrs.at(x).rcs_alpha, vrs.at(x).extra_float));
-            }
-            if (vrs.at(x).type == JSVISION_XCROSS) {
-                vrsXCrosses.push_back(Feature(JSVISION_XCROSS, vrs.at(x).rcs_distance,
-                                              vrs.at(x).rcs_alpha, vrs.at(x).extra_float));
-            }
-            if (vrs.at(x).type == JSVISION_CIRCLE) {
-                vrsCircles.push_back(Feature(JSVISION_CIRCLE, vrs.at(x).rcs_distance,
-                                            vrs.at(x).rcs_alpha));
-            }
-        }
-
-        vector<Feature> pfLines;
-        vector<Feature> pfLCrosses;
-        vector<Feature> pfTCrosses;
-        vector<Feature> pfXCrosses;
-        vector<Feature> pfGoals;
-        vector<Feature> pfCircles;
-        for (auto &particle: particles) {
-            matchedLandmarks.clear();
-            float probability = 1.0f;
-            // for every particle compare Visionresulst with Landmarks from Playingfield
-            if (!vrsLines.empty()) {
-                pfLines = createLineFeature(particle);
-                for (auto &vrsLine: vrsLines) {
-                    auto res = calculateProbabilityOfMatchingLandmark(vrsLine, pfLines);
-                    probability *= res.first;
-                    matchedLandmarks.push_back(res.second);
-                }
-            }
-            if (!vrsLCrosses.empty()) {
-                pfLCrosses = createLCrossFeature(particle);
-                for (auto &vrsLCross: vrsLCrosses) {
-                    auto res = calculateProbabilityOfMatchingLandmark(vrsLCross, pfLCrosses);
-                    probability *= res.first;
-                    matchedLandmarks.push_back(res.second);
-                }
-            }
-            if (!vrsTCrosses.empty()) {
-                pfTCrosses = createTCrossFeature(particle);
-                for (auto &vrsTCross: vrsTCrosses) {
-                    auto res = calculateProbabilityOfMatchingLandmark(vrsTCross, pfTCrosses);
-                    probability *= res.first;
-                    matchedLandmarks.push_back(res.second);
-                }
-            }
-            if (!vrsXCrosses.empty()) {
-                pfXCrosses = createXCrossFeature(particle);
-                for (auto &vrsXCross: vrsXCrosses) {
-                    auto res = calculateProbabilityOfMatchingLandmark(vrsXCross, pfXCrosses);
-                    probability *= res.first;
-                    matchedLandmarks.push_back(res.second);
-                }
-            }
-            if (!vrsCircles.empty()) {
-                pfCircles = createCircleFeature(particle);
-                for (auto &vrsCircle: vrsCircles) {
-                    auto res = calculateProbabilityOfMatchingLandmark(vrsCircle, pfCircles);
-                    probability *= res.first;
-                    matchedLandmarks.push_back(res.second);
-                }
-            }
-            // if we see one visionresult probability is smaller then 1.0
-            if (probability != 1.0f) {
-                particle.weight = probability;
-                isMeasurementUpdate = true;
-            }
-        }
-    }
-    return isMeasurementUpdate;
-}
-
-
 //https://people.eecs.berkeley.edu/~pabbeel/cs287-fa11/slides/particle-filters++_v2.pdf
-void ParticleFilter::lowVarianzeResample() {
+void ParticleFilterBase::lowVarianzeResample() {
+    PF_PROFILE_STAGE(profiler, FilterStage::RESAMPLE);
     uniform_real_distribution<double> uniform_distribution(0.0,
             1.0f/particles.size());
     double random_number =  uniform_distribution(generator);
@@ -433,18 +401,17 @@ void ParticleFilter::lowVarianzeResample() {
                 sum_weight += particles.at(count_particle).weight) {
             count_particle++;
         }
-        tmp_particles.emplace_back(Particle(DirectedCoord(particles.at(
-                                       count_particle).pose.coord.x,
-                                   particles.at(count_particle).pose.coord.y,
-                                   particles.at(count_particle).pose.angle.rad),
-                                   1.0f/conf.numParticles));
+        // copied with its cached cos/sin
+        tmp_particles.push_back(particles.at(count_particle));
+        tmp_particles.back().weight = 1.0f/conf.numParticles;
     }
     //copy the choosen particles from temp to particles
     particles = move(tmp_particles);
 }
 
 
-void ParticleFilter::calculatePose() {
+void ParticleFilterBase::calculatePose() {
+    PF_PROFILE_STAGE(profiler, FilterStage::POSE);
     //sum up all positions and divide by particle size to get the mean position
     DirectedCoord mean(particles.at(0).pose);
     for (size_t i = 1; i<(particles.size()); i++) {
@@ -484,15 +451,16 @@ void ParticleFilter::calculatePose() {
 
 
 //returns confidence of particle position
-float ParticleFilter::adjustParticlesWithLandmarkHypos(const pair<vector<DirectedCoord>,int> &hypos){
+float ParticleFilterBase::adjustParticlesWithLandmarkHypos(const pair<vector<DirectedCoord>,int> &hypos){
+    PF_PROFILE_STAGE(profiler, FilterStage::HYPOS);
     //find closest hypo
-    float ADJUSTMENT_DIST = 1.5f;
+    const float ADJUSTMENT_DIST = conf.adjustmentDist;
     float minDist = ADJUSTMENT_DIST;
     float second_minDist = ADJUSTMENT_DIST;
     DirectedCoord minHypo;
     for (DirectedCoord h: hypos.first){
         for (auto particle :particles){
-            float tmp_dist = h.coord.dist(particle.pose.coord)+fabs(h.angle.dist(particle.pose.angle).rad);
+            float tmp_dist = h.coord.dist(particle.pose.coord)+FastAngle(h.angle).absDist(particle.pose.angle);
             if (tmp_dist < minDist){
                 second_minDist = minDist;
                 minDist = tmp_dist;
@@ -508,10 +476,10 @@ float ParticleFilter::adjustParticlesWithLandmarkHypos(const pair<vector<Directe
         float replacement_share; //higher replacement share for higher confidence
         int confidence = hypos.second;
         if (confidence == 1){ //1 landmark uses for hypothese
-            replacement_share = 0.02;
+            replacement_share = conf.replacementShare;
         }
         else{ //min 2 landmarks used
-            replacement_share = 0.05;
+            replacement_share = conf.replacementShareMulti;
         }
         vector<DirectedCoord> position(1,minHypo);
         setParticlesToPosition(position, 0.1 , 0.1, 0.1, replacement_share);
@@ -524,7 +492,7 @@ generate a random number X between 0 an 1;
 go trough particles an sum up their weights untill the sum is bigger then X
 take the last particle you look at.
 */
-void ParticleFilter::resample() {
+void ParticleFilterBase::resample() {
     uniform_real_distribution<double> uniform_distribution(0.0, 1.0f);
     vector<Particle> tmp_particles = particles;
     for (uint i = 0; i < conf.numParticles; i++) {
@@ -535,11 +503,8 @@ void ParticleFilter::resample() {
                 sum_weight += particles.at(count_particle).weight) {
             count_particle++;
         }
-        tmp_particles.at(i).setParticle(DirectedCoord(particles.at(
-                count_particle).pose.coord.x,
-                                             particles.at(count_particle).pose.coord.y,
-                                             particles.at(count_particle).pose.angle.rad),
-                                             1.0f/conf.numParticles);
+        tmp_particles.at(i) = particles.at(count_particle);
+        tmp_particles.at(i).weight = 1.0f/conf.numParticles;
     }
     //copy the choosen particles from tmp to particles
     particles = move(tmp_particles);
@@ -554,13 +519,17 @@ it controlls the general process and calls the functions
     -resample
 
 */
-void ParticleFilter::update(const vector<VisionResult> &visionresults,
+void ParticleFilterBase::update(const vector<VisionResult> &visionresults,
                                  DirectedCoord odometry, const pair<vector<DirectedCoord>,int> &hypos) {
+    PF_PROFILE_STAGE(profiler, FilterStage::UPDATE);
 
     // omit for penalty goaly (for fps gain)
     if(conf.role == RobotRole::PENALTYGOALIE){
         return;
     }
+    if (conf.compactParticles) {
+        loadCompactParticles();
+    }
     //sample particles from odometry / move particles according to odometry with spreading
     moveParticles(odometry);
 
@@ -568,26 +537,85 @@ void ParticleFilter::update(const vector<VisionResult> &visionresults,
     if (!visionresults.empty() and !isPenalized) {
         //weight particles with visionResults if particles weighted, normalize and resample
         if (measurementModel(visionresults)) {
-            normalizeParticle();
-            //take particles according to their weight
-            lowVarianzeResample();
-            //resample();
+            // the best particle explains the seen features badly for a while: kidnapped
+            collapsedFrames = (measurementFit < conf.globalFit) ? collapsedFrames + 1 : 0;
+            if (conf.globalFit > 0.0f && collapsedFrames >= conf.globalFrames) {
+                globalRequested = true;
+            }
+            if (globalRequested && globalLocalisation(visionresults)) {
+                globalRequested = false;
+                collapsedFrames = 0;
+            } else {
+                normalizeParticle();
+                //take particles according to their weight
+                lowVarianzeResample();
+                //resample();
+            }
         }
     }
     calculatePose();
     adjustParticlesWithLandmarkHypos(hypos);
+
+    if (conf.compactParticles) {
+        storeCompactParticles();
+    }
 }
 
 
-void ParticleFilter::setPosition(DirectedCoord pos) {
+vector<Particle> ParticleFilterBase::globalGridCells() const {
+    // the field inside the bounds, centered
+    const float step = conf.globalGridStep;
+    const int nx = static_cast<int>(conf.pf->_lengthInsideBounds / step) / 2;
+    const int ny = static_cast<int>(conf.pf->_widthInsideBounds / step) / 2;
+    const size_t angles = max<size_t>(1, conf.globalGridAngles);
+    vector<Particle> cells;
+    cells.reserve((2 * nx + 1) * (2 * ny + 1) * angles);
+    for (int ix = -nx; ix <= nx; ++ix) {
+        for (int iy = -ny; iy <= ny; ++iy) {
+            for (size_t ia = 0; ia < angles; ++ia) {
+                const float angle = -M_PI_F + (ia + 0.5f) * 2.0f * M_PI_F / angles;
+                cells.push_back(Particle(DirectedCoord(ix * step, iy * step, angle), 0.0f));
+            }
+        }
+    }
+    return cells;
+}
+
+void ParticleFilterBase::requestGlobalLocalisation() {
+    globalRequested = true;
+    prepareGlobalLocalisation();
+}
+
+size_t ParticleFilterBase::closestParticle(const DirectedCoord &pose) const {
+    size_t closest = 0;
+    float minDist = numeric_limits<float>::max();
+    for (size_t i = 0; i < particles.size(); ++i) {
+        const DirectedCoord &p = particles[i].pose;
+        const float d = p.coord.dist(pose.coord)
+                        + FastAngle(p.angle).absDist(FastAngle(pose.angle));
+        if (d < minDist) {
+            minDist = d;
+            closest = i;
+        }
+    }
+    return closest;
+}
+
+void ParticleFilterBase::setPosition(DirectedCoord pos) {
+    if (conf.compactParticles) {
+        loadCompactParticles();
+    }
     for (uint i = 0; i < conf.numParticles; ++i) {
         particles.at(i).setParticle(pos, 1.0f/conf.numParticles);
     }
+    if (conf.compactParticles) {
+        storeCompactParticles();
+    }
 }
 
 
 // return current position
-DirectedCoord ParticleFilter::get_position(const float &step_pos,
+DirectedCoord ParticleFilterBase::get_position(const float &step_pos,
         const float &step_rad) const {
 
     float _min_pos = (step_pos < step_bound) ? step_bound : step_pos;
@@ -598,7 +626,7 @@ DirectedCoord ParticleFilter::get_position(const float &step_pos,
 }
 
 // return current position
-float ParticleFilter::get_confidence() {
+float ParticleFilterBase::get_confidence() {
 
     if ((confidence>0.0f) and (confidence <=1.0f)) {
         return confidence;
@@ -606,8 +634,14 @@ float ParticleFilter::get_confidence() {
     return 0.0f;
 }
 
-vector<DirectedCoord> ParticleFilter::getHypothesesVector() {
+vector<DirectedCoord> ParticleFilterBase::getHypothesesVector() {
     vector<DirectedCoord> ret;
+    if (conf.compactParticles) {
+        for (const auto &particle: compactParticles) {
+            ret.push_back(compact::decodePose(particle));
+        }
+        return ret;
+    }
 
     //for (size_t i = 0; i < conf.numParticles; ++i)
     for (auto it=particles.begin(); it!=particles.end(); ++it) {
@@ -617,17 +651,29 @@ vector<DirectedCoord> ParticleFilter::getHypothesesVector() {
     return ret;
 }
 
+vector<CompactParticle> ParticleFilterBase::getCompactHypotheses() const {
+    if (conf.compactParticles) {
+        return compactParticles;
+    }
+    vector<CompactParticle> ret;
+    ret.reserve(particles.size());
+    for (const auto &particle: particles) {
+        ret.push_back(compact::encode(particle.pose, particle.weight));
+    }
+    return ret;
+}
+
 
 //------------------------------------------------------------------------------------------------------
 //HELPER FUNCTIONS:
 //------------------------------------------------------------------------------------------------------
-void ParticleFilter::sortParticle() {
+void ParticleFilterBase::sortParticle() {
     auto lambda_sort = [](const Particle& p1, const Particle& p2)
                        -> bool { return p1.weight > p2.weight; };
     sort(particles.begin(), particles.end(), lambda_sort);
 }
 
-/*vector<tHypoWithWeight> ParticleFilter::getHypothesesVectorWithWeights() {
+/*vector<tHypoWithWeight> ParticleFilterBase::getHypothesesVectorWithWeights() {
     vector<tHypoWithWeight> ret;
     for (auto it=particles.begin(); it!=particles.end(); ++it) {
 
@@ -641,7 +687,29 @@ void ParticleFilter::sortParticle() {
     return ret;
 }*/
 
-void ParticleFilter::normalizeParticle() {
+// the float particles of the compact particle set, scratch space for one update
+void ParticleFilterBase::loadCompactParticles() {
+    particles.clear();
+    particles.reserve(compactParticles.size());
+    for (const auto &particle: compactParticles) {
+        particles.push_back(Particle(compact::decodePose(particle),
+                                     compact::decodeWeight(particle)));
+    }
+}
+
+// quantize the particle set into the compact storage, between two updates
+// only the compact set is valid. the float particles keep their capacity:
+// they are the scratch space of every update, no allocation per frame
+void ParticleFilterBase::storeCompactParticles() {
+    compactParticles.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); ++i) {
+        compactParticles[i] = compact::encode(particles[i].pose, particles[i].weight);
+    }
+    particles.clear();
+}
+
+void ParticleFilterBase::normalizeParticle() {
+    PF_PROFILE_STAGE(profiler, FilterStage::NORMALIZE);
     float sum_weights = 0.0f;
     for (size_t count_particle = 0; count_particle<particles.size();
             ++count_particle) {
@@ -662,28 +730,65 @@ void ParticleFilter::normalizeParticle() {
     }
 }
 
-constexpr float ParticleFilter::fastExp(float x) const {
-     x = 1.f + x / 256.f;
-     x *= x;
-     x *= x;
-     x *= x;
-     return x;
+vector<Feature> ParticleFilterBase::createLineFeature(const Particle particle) {
+    float dist[LineMAX];
+    float bearing[LineMAX];
+    float orientation[LineMAX];
+    const DirectedCoord &pose = particle.pose;
+    segmentsToRCS(&pose.coord.x, &pose.coord.y, &pose.angle.rad, &particle.cosTheta,
+                  &particle.sinTheta, 1, lineTable.segments, SegmentMode::INFINITE_LINE,
+                  nullptr, nullptr, dist, bearing, orientation);
+    vector<Feature> features;
+    lineFeatures(dist, bearing, orientation, features);
+    return features;
 }
 
-const float ParticleFilter::prob(float x, float deviation) const {
-    /*constexpr float mean = 0.0f;
-    float inner = (x - mean) / deviation;
-    inner *= inner;
-    return 1.0f/(deviation*sqrt(2*M_PI_F))*fastExp(-0.5f*inner);*/
-    float mean = 0.0f;
-    return 1.0f/(deviation*std::sqrt(2*M_PI_F))*std::exp(-0.5f*powf(((x-mean)/deviation), 2));
+vector<Feature> ParticleFilterBase::createCircleFeature(const Particle particle) const {
+    vector<Feature> pfCircles;
+    //calculate distance and angle between particle and conf.pf landmark
+    // center.toRCS(particle.pose) with the cached cos/sin
+    const float dx = -particle.pose.coord.x;
+    const float dy = -particle.pose.coord.y;
+    Coord rcsCenter(dx * particle.cosTheta + dy * particle.sinTheta,
+                    dy * particle.cosTheta - dx * particle.sinTheta);
+    float dist = rcsCenter.dist();
+    float angle = rcsCenter.direction();
+    pfCircles.push_back(Feature(JSVISION_CIRCLE, dist, angle));
+    return pfCircles;
 }
 
+void ParticleFilterBase::initPointTables() {
+    static const int types[] = {JSVISION_LCROSS, JSVISION_TCROSS, JSVISION_XCROSS};
+    for (int degree = 2; degree <= 4; ++degree) {
+        PointTable &table = crossTables[degree - 2];
+        table.type = types[degree - 2];
+        table.oriented = true;
+        // same order as crossIndices<degree>()
+        for (const auto &cross: conf.pf->model().crosses) {
+            if (cross.degree == degree) {
+                table.points.push_back(Coord(cross.wcs_x, cross.wcs_y));
+                table.alpha.push_back(FastAngle::wrap(cross.wcs_alpha));
+            }
+        }
+    }
 
+    penaltyTable.type = JSVISION_PENALTY;
+    penaltyTable.oriented = false;
+    for (bool opponent: {true, false}) {
+        penaltyTable.points.push_back(conf.pf->getPenaltyMarkPosition(opponent));
+        penaltyTable.alpha.push_back(0.0f);
+    }
 
-vector<Feature> ParticleFilter::createLineFeature(const Particle particle) {
-    vector<Feature> pfLines;
-    for (auto &line: conf.pf->getLines()) {
+    goalTable.type = JSVISION_GOAL;
+    goalTable.oriented = false;
+    for (const auto &pole: conf.pf->model().poles) {
+        goalTable.points.push_back(Coord(pole.wcs_x, pole.wcs_y));
+        goalTable.alpha.push_back(0.0f);
+    }
+}
+
+void ParticleFilterBase::initLineTable() {
+    for (const auto &line: conf.pf->model().lines) {
         /// penaltymarks are still treaten as line in our playingfield...
         // and don't use short lines
         // penalty box back lines, seems to lead to error TODO
@@ -702,86 +807,58 @@ vector<Feature> ParticleFilter::createLineFeature(const Particle particle) {
                 ) {
             continue;
         }
-        //calculate distance and angle between particle and conf.pf landmark
-        //and save the legth of the line
-        Coord start(line.start_x, line.start_y);
-        Coord end(line.end_x, line.end_y);
-        DirectedCoord pointOnLine;
-        pointOnLine.coord = particle.pose.coord.closestPointOnLine(start, end);
-        Coord rcsline = pointOnLine.toRCS(particle.pose).coord;
-        float dist = particle.pose.coord.dist(pointOnLine.coord);
-        float angle = rcsline.angle().rad;
-        float orientation = (end-start).direction() - particle.pose.angle.rad;
+        lineTable.segments.push_back(Coord(line.start_x, line.start_y),
+                                     Coord(line.end_x, line.end_y), line.equation);
+        lineTable.names.push_back(static_cast<int>(line.name));
+    }
+}
 
-        pfLines.push_back(Feature(JSVISION_LINE, dist, angle, orientation,(int)line.name));
+// features of one particle from its row of the batched line transform
+void ParticleFilterBase::lineFeatures(const float *dist, const float *bearing,
+                                      const float *orientation, vector<Feature> &out) const {
+    out.clear();
+    for (size_t j = 0; j < lineTable.names.size(); ++j) {
+        out.push_back(Feature(JSVISION_LINE, dist[j], bearing[j], orientation[j],
+                              lineTable.names[j]));
     }
-    return pfLines;
 }
 
-vector<Feature> ParticleFilter::createGoalFeature(const Particle particle) {
-    std::vector<Feature> pfGoals;
-    for (auto &pole: conf.pf->getPoals()) {
-        //calculate distance and angle between particle and conf.pf landmark
-        float dist = particle.pose.coord.dist(Coord(pole.wcs_x, pole.wcs_y));
-        Coord rcs(pole.wcs_x-particle.pose.coord.x, pole.wcs_y-particle.pose.coord.y);
-        float angle = rcs.angle().rad;
-        pfGoals.push_back(Feature(JSVISION_GOAL, dist, angle));
+// features of one particle from its row of a batched point transform
+void ParticleFilterBase::pointFeatures(const PointTable &table, const float *dist,
+                                       const float *bearing, float theta,
+                                       vector<Feature> &out) const {
+    out.clear();
+    for (size_t j = 0; j < table.points.size(); ++j) {
+        float orientation = table.oriented ? table.alpha[j] - theta : 0.0f;
+        out.push_back(Feature(table.type, dist[j], bearing[j], orientation));
     }
-    return pfGoals;
 }
 
-vector<Feature> ParticleFilter::createCircleFeature(const Particle particle) {
-    vector<Feature> pfCircles;
-    //calculate distance and angle between particle and conf.pf landmark
-    DirectedCoord center(0.0f,0.0f,0.0f);
-    Coord rcsCenter = center.toRCS(particle.pose).coord;
-    float dist = rcsCenter.dist();
-    float angle = rcsCenter.angle().rad;
-    pfCircles.push_back(Feature(JSVISION_CIRCLE, dist, angle));
-    return pfCircles;
+vector<Feature> ParticleFilterBase::createPointFeature(const PointTable &table,
+                                                       const Particle &particle) const {
+    // no point table is larger than all crosses
+    float dist[CrossMAX];
+    float bearing[CrossMAX];
+    const DirectedCoord &pose = particle.pose;
+    transformToRCS(&pose.coord.x, &pose.coord.y, &particle.cosTheta, &particle.sinTheta, 1,
+                   table.points.x.data(), table.points.y.data(), table.points.size(), nullptr,
+                   nullptr, dist, bearing);
+    vector<Feature> features;
+    pointFeatures(table, dist, bearing, pose.angle.rad, features);
+    return features;
+}
+
+vector<Feature> ParticleFilterBase::createLCrossFeature(const Particle particle) {
+    return createPointFeature(crossTables[0], particle);
 }
 
-vector<Feature> ParticleFilter::createLCrossFeature(const Particle particle) {
-    vector<Feature> pfLCrosses;
-    for (auto &cross: conf.pf->getLCrosses()) {
-        //calculate distance and angle between particle and conf.pf landmark
-        DirectedCoord crossCoord(cross.wcs_x, cross.wcs_y, cross.wcs_alpha);
-        Coord rcsCross = crossCoord.toRCS(particle.pose).coord;
-        float dist = rcsCross.dist();
-        float angle = rcsCross.angle().rad;
-        float orientation = Angle::normalize(cross.wcs_alpha) -
-                            particle.pose.angle.rad;
-        pfLCrosses.push_back(Feature(JSVISION_LCROSS, dist, angle, orientation));
-    }
-    return pfLCrosses;
-}
-
-vector<Feature> ParticleFilter::createTCrossFeature(const Particle particle) {
-    vector<Feature> pfTCrosses;
-    for (auto &cross: conf.pf->getTCrosses()) {
-        //calculate distance and angle between particle and conf.pf landmark
-        DirectedCoord crossCoord(cross.wcs_x, cross.wcs_y, cross.wcs_alpha);
-        Coord rcsCross = crossCoord.toRCS(particle.pose).coord;
-        float dist = rcsCross.dist();
-        float angle = rcsCross.angle().rad;
-        float orientation = Angle::normalize(cross.wcs_alpha) -
-                            particle.pose.angle.rad;
-        pfTCrosses.push_back(Feature(JSVISION_TCROSS, dist, angle, orientation));
-    }
-    return pfTCrosses;
-}
-
-vector<Feature> ParticleFilter::createXCrossFeature(const Particle particle) {
-    vector<Feature> pfXCrosses;
-    for (auto &cross: conf.pf->getXCrosses()) {
-        //calculate distance and angle between particle and conf.pf landmark
-        DirectedCoord crossCoord(cross.wcs_x, cross.wcs_y, cross.wcs_alpha);
-        Coord rcsCross = crossCoord.toRCS(particle.pose).coord;
-        float dist = rcsCross.dist();
-        float angle = rcsCross.angle().rad;
-        float orientation = Angle::normalize(cross.wcs_alpha) -
-                            particle.pose.angle.rad;
-        pfXCrosses.push_back(Feature(JSVISION_XCROSS, dist, angle, orientation));
-    }
-    return pfXCrosses;
+vector<Feature> ParticleFilterBase::createTCrossFeature(const Particle particle) {
+    return createPointFeature(crossTables[1], particle);
 }
+
+vector<Feature> ParticleFilterBase::createXCrossFeature(const Particle particle) {
+    return createPointFeature(crossTables[2], particle);
+}
+
+// the default models, other combinations are instantiated by their users
+template class BasicParticleFilter<>;
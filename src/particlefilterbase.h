@@ -0,0 +1,420 @@
+/**
+ * @author Module owner: Bembelbots Frankfurt, sinaditzel
+ *
+ * model independent part of the particle filter: settings, events and
+ * their handlers, particle set, resampling and pose estimation.
+ * the observation and motion models are plugged in by BasicParticleFilter
+ * (see particlefilter.h), use that one.
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <map>
+#include <vector>
+#include "playingfield.h"
+#include <batchtransform.h>
+#include <compactparticle.h>
+#include <profiling.h>
+#include <visiondefinitions.h>
+#include <workerpool.h>
+#include <coords.h>
+#include <functional>
+#include <memory>
+#include <cassert>
+
+
+static const size_t FeatureTypeMAX = static_cast<size_t>(JSVISION_ROBOT) + 1;
+
+// standard deviations of the errors of one feature type
+struct FeatureNoise {
+    float dist; // m
+    float angle; // rad, bearing
+    float orientation; // rad
+};
+
+/**
+ * cos/sin of the heading are cached for the measurement kernels, they are
+ * only recalculated when the heading changes. change the pose with
+ * setPose/setParticle/walk (or copy whole particles) to keep them valid.
+ */
+class Particle {
+public:
+    Particle(const DirectedCoord &data, const float &w);
+    void setParticle(const DirectedCoord &data, const float &w);
+    void setPose(const DirectedCoord &data);
+
+    // same as pose = fastWalk(pose, dx, dy, turn), no trig without a turn
+    void walk(float dx, float dy, FastAngle turn) {
+        if (turn.rad != 0.0f) {
+            const FastAngle heading = FastAngle(pose.angle) + turn;
+            pose.angle = heading.toAngle();
+            cosTheta = std::cos(heading.rad);
+            sinTheta = std::sin(heading.rad);
+        }
+        pose.coord.x += cosTheta * dx - sinTheta * dy;
+        pose.coord.y += sinTheta * dx + cosTheta * dy;
+    }
+
+    float weight;
+    DirectedCoord pose;
+    float cosTheta, sinTheta; // of pose.angle.rad
+};
+
+class Feature {
+public:
+    Feature();
+    Feature(const int type, const float dist, const float angle,
+            const float orientation = 0.0f, int id = 0);
+    int type;
+    float dist;
+    float angle;
+    //only for crosses
+    float orientation;
+    int id;
+};
+
+
+class ParticleFilterBase {
+public:
+
+    class Settings {
+    public:
+        Settings(PlayingField *pf);
+        PlayingField *pf;
+
+        /*
+         * number of particles to use.
+         * more particles lead to better results,
+         * but increase the runtime of the filter.
+         */
+        size_t numParticles;
+        /*
+         * error of odometry
+         */
+        DirectedCoord odoStdev;
+        /*
+         * start position of the mcs Koordinate System(Odometry)
+         */
+        DirectedCoord startMcsPosition;
+        /*
+         *  start position of the robot (WCS)...
+         */
+        DirectedCoord startPosition;
+
+        int robot_id;
+        bool has_kickoff;
+        RobotRole role;
+
+        /*
+         * keep the particle state between two updates only in 8 byte
+         * fixed point particles (see compactparticle.h), precision is 1mm
+         * and 1/65536 turn. the float particles are decoded at the start of
+         * an update (and around event handlers) into a scratch vector that
+         * keeps its capacity, the kernels run on it. so the float set is
+         * resident during the update, the gain is the smaller state between
+         * updates (hypotheses, snapshots), not the working set.
+         */
+        bool compactParticles;
+
+        /*
+         * standard deviation of the default observation model for the
+         * distance, angle and orientation error of a matched landmark
+         * (see GaussianObservationModel)
+         */
+        float probDeviation;
+
+        /*
+         * the same per feature type (indexed by VisionClass), components
+         * which are 0 use probDeviation. settings file keys are
+         * lineDeviation, lcrossDeviation, ... = dist angle orientation
+         */
+        std::array<FeatureNoise, FeatureTypeMAX> featureNoise;
+        // featureNoise of the type with probDeviation for unset components
+        FeatureNoise noiseOf(VisionClass type) const;
+
+        /*
+         * share of particles moved to a close landmark hypothesis,
+         * for hypotheses from one landmark / from two or more landmarks
+         */
+        float replacementShare;
+        float replacementShareMulti;
+
+        /*
+         * a landmark hypothesis is only used if it is closer than this
+         * to a particle (distance in m + heading difference in rad)
+         */
+        float adjustmentDist;
+
+        /*
+         * early exit in the measurement model, 0 = off. pruneShare is the
+         * resampling granularity u: a particle is no longer evaluated once
+         * even a perfect match of its remaining observations leaves its
+         * log weight below log(best so far) - log(numParticles / u), it
+         * gets weight 0. with the full evaluation it would have got less
+         * than u resampled copies (expected).
+         */
+        float pruneShare;
+
+        /*
+         * two stage measurement model, off if not in (0, 1). all particles
+         * are scored with the coarseObservations most discriminative
+         * observations first, only the best refineShare of them get all
+         * observations. the others keep their stage one weight times the
+         * worst refine ratio (full / stage one weight) of the refined ones.
+         * takes precedence over pruneShare.
+         */
+        float refineShare;
+        size_t coarseObservations;
+
+        /*
+         * global relocalisation (see requestGlobalLocalisation): the seen
+         * features are scored over a grid of the field with globalGridStep
+         * (m) and globalGridAngles headings, the particles are reseeded
+         * around the globalCells best cells. it runs on globalThreads
+         * threads (0: one per core), kept between the calls.
+         * it is triggered automatically when the fit of the best particle
+         * (geometric mean of likelihood / best possible likelihood over the
+         * seen features) stays below globalFit for globalFrames updates,
+         * globalFit 0 = never. the default 0.5 is far below the fit of a
+         * localized filter (0.9 - 1), a replay of the synthetic log only
+         * falls below it after a kidnapping.
+         */
+        float globalGridStep;
+        size_t globalGridAngles;
+        size_t globalCells;
+        unsigned int globalThreads;
+        float globalFit;
+        size_t globalFrames;
+
+        /*
+         * seed of the random number generator,
+         * same seed + same input == same output
+         */
+        unsigned int seed;
+
+        /*
+         * read/write the parameters above (except the positions) as
+         * "key = value" lines, e.g. written by particlefilteroptimize.
+         * keys missing in the file keep their value.
+         * returns false if the file can not be read or has unknown keys.
+         */
+        bool load(const std::string &filename);
+        bool save(const std::string &filename) const;
+    };
+
+    ParticleFilterBase(const Settings &conf);
+    virtual ~ParticleFilterBase();
+
+    //EVENT HANDELING:
+    // various events a localization-realization may react to
+    typedef enum {
+        EV_INTIAL, //0
+        EV_LOST_GROUND,
+        EV_GOT_GROUND,
+        EV_BACK_UP,
+        EV_FALLEN,
+        EV_PENALIZED, //5
+        EV_UNPENALIZED,
+        EV_STATE_INITIAL,
+        EV_STATE_READY,
+        EV_STATE_SET,
+        EV_STATE_PLAYING, //10
+        EV_STATE_FINISHED
+        } tLocalizationEvent;
+
+    // handle (localization) events callback register here...
+    void emit_event(const tLocalizationEvent &ev);
+    void handle_event(const tLocalizationEvent &ev, std::function<void()> handler);
+    
+    // the event handlers
+    std::map<tLocalizationEvent, std::function<void()>> ev_callbacks;
+
+    void update(const std::vector<VisionResult> &visionresult,
+                DirectedCoord odometry,
+                const std::pair<std::vector<DirectedCoord>,int> &hypos);
+
+    DirectedCoord get_position(
+                const float &min_step_pos = 0.01f,
+                const float &min_step_rad = 0.008f) const;
+
+    float get_confidence();
+
+    std::vector<DirectedCoord> getHypothesesVector();
+
+    // particle set in compact form, e.g. to send it around
+    std::vector<CompactParticle> getCompactHypotheses() const;
+    
+    // set all particles to position "pos"
+    void setPosition(DirectedCoord pos);
+
+    // reseed the particles from a grid search of the whole field with the
+    // features seen in the next update (see Settings::globalGridStep),
+    // the grid is built here if it is not there yet
+    void requestGlobalLocalisation();
+
+    // index of the particle closest to pose (distance + heading difference)
+    size_t closestParticle(const DirectedCoord &pose) const;
+
+#ifdef PF_PROFILING
+    // latency histograms of the update stages
+    const StageProfiler &getProfiler() const { return profiler; }
+    void resetProfiler() { profiler.reset(); }
+#endif
+
+
+    //private:
+    Settings conf;
+
+    // my current position
+    DirectedCoord pos;
+
+    //confidence of position
+    float confidence;
+
+    //particles, empty (capacity kept) between two updates with conf.compactParticles
+    std::vector<Particle> particles;
+
+    //particle state between updates, only used with conf.compactParticles
+    std::vector<CompactParticle> compactParticles;
+
+    // needed to caculate random numbers
+    std::default_random_engine generator;
+
+    // last position of the mcs
+    DirectedCoord lastMcsPosition;
+    
+    //saves if robot is fallen
+    bool isFallenRobot;
+    
+    //after penalized or manual placement == true
+    bool isReplaced;
+    
+    //is robot currently penalized
+    bool isPenalized;
+
+    //what was the gamestate robot has been penalized?
+    GameState penalizedGamestate;
+    
+    //current gamestate
+    GameState gamestate;
+
+    std::vector<Feature> matchedLandmarks;
+
+    // fit of the best particle in the last measurement update, 1 = perfect
+    // (see Settings::globalFit)
+    float measurementFit;
+    // updates in a row with measurementFit < conf.globalFit
+    size_t collapsedFrames;
+    bool globalRequested;
+
+    // grid cells of globalLocalisation with their expected features and the
+    // threads that score them, built with the filter (globalFit > 0), by
+    // requestGlobalLocalisation or when the grid settings change
+    struct GlobalGrid {
+        float step = 0.0f;
+        size_t angles = 0;
+        std::unique_ptr<WorkerPool> workers;
+        std::vector<Particle> cells;
+        // by position in the feature list: the expected features of cell c
+        // are features[t][offsets[t][c] ... offsets[t][c + 1])
+        std::vector<std::vector<Feature>> features;
+        std::vector<std::vector<uint32_t>> offsets;
+    } globalGrid;
+
+    // work of the measurement model since the start
+    struct MeasurementStats {
+        uint64_t particles = 0; // evaluated particles
+        uint64_t pruned = 0; // of those stopped early (Settings::pruneShare)
+        uint64_t likelihoods = 0; // evaluated observations (all particles)
+        uint64_t skipped = 0; // observations not evaluated because of pruning
+    } measurementStats;
+
+    // point landmarks of one type in SoA form for the batched transform
+    // (crosses of one degree, penalty marks, goal poles)
+    struct PointTable {
+        int type; // JSVISION_LCROSS, ...
+        PointBatch points;
+        std::vector<float> alpha; // wcs orientation, normalized
+        bool oriented; // false: orientation is not compared (always 0)
+        RcsBatch rcs; // particles x points, filled by measurementModel
+    };
+    std::array<PointTable, 3> crossTables; // L, T, X
+    PointTable penaltyTable;
+    PointTable goalTable;
+    // field lines used for matching, same idea
+    struct LineTable {
+        SegmentBatch segments;
+        std::vector<int> names; // Line
+        RcsBatch rcs; // particles x lines, filled by measurementModel
+    };
+    LineTable lineTable;
+    PoseBatch particlePoses;
+
+#ifdef PF_PROFILING
+    // per stage timing of update()
+    StageProfiler profiler;
+#endif
+
+    // setting get_pos() granularity below this means: get the raw position values
+    const float step_bound= 0.0001f;
+
+
+    /*
+     *handel loca events 
+     */
+    void initHandler();
+    void penalizedHandler();
+    void unpenalizedHandler();
+    void playHandler();
+    void readyHandler();
+    void penaltyKickHandler();
+    void setHandler();
+    void standUpHandler();
+    void manualPlacementHandler();
+    // grid search and reseed, false if nothing usable was seen
+    virtual bool globalLocalisation(const std::vector<VisionResult> &vrs) = 0;
+    // the cells of globalGrid for the current settings, without features
+    std::vector<Particle> globalGridCells() const;
+    // builds globalGrid (and its workers) if it is missing or was built for
+    // other settings
+    virtual void prepareGlobalLocalisation() = 0;
+
+    // implemented by BasicParticleFilter with its models, called once per update
+    virtual bool measurementModel(const std::vector<VisionResult> &vrs) = 0;
+    virtual void moveParticles(const DirectedCoord &odo) = 0;
+    void lowVarianzeResample();
+    void calculatePose();
+    float adjustParticlesWithLandmarkHypos(const std::pair<std::vector<DirectedCoord>,int> &hypos);
+ 
+
+    //helper:
+    void setParticlesToPosition(std::vector<DirectedCoord> positions, float deviationX = 0.05f,
+                                float deviationY = 0.05f, float deviationAlpha = 0.05f,
+                                float amount = 1);
+    std::vector<Feature> createLineFeature(const Particle particle);
+    std::vector<Feature> createLCrossFeature(const Particle particle);
+    std::vector<Feature> createTCrossFeature(const Particle particle);
+    std::vector<Feature> createXCrossFeature(const Particle particle);
+    std::vector<Feature> createCircleFeature(const Particle particle) const;
+    void initPointTables();
+    void pointFeatures(const PointTable &table, const float *dist, const float *bearing,
+                       float theta, std::vector<Feature> &out) const;
+    std::vector<Feature> createPointFeature(const PointTable &table, const Particle &particle) const;
+    void initLineTable();
+    void lineFeatures(const float *dist, const float *bearing, const float *orientation,
+                      std::vector<Feature> &out) const;
+    void sortParticle();
+    // conf.compactParticles: particles <--> compactParticles, store empties particles
+    void loadCompactParticles();
+    void storeCompactParticles();
+    void normalizeParticle();
+
+    //unused
+    void resample();
+};
+
+
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
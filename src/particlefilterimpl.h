@@ -0,0 +1,484 @@
+/**
+ * @author Module owner: Bembelbots Frankfurt, sinaditzel
+ *
+ * member definitions of BasicParticleFilter. only needed where a
+ * BasicParticleFilter is instantiated, ParticleFilter (default models)
+ * is instantiated in particlefilter.cpp.
+ */
+#pragma once
+
+#include "particlefilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+template<class ObservationModel, class MotionModel, class Features>
+BasicParticleFilter<ObservationModel, MotionModel, Features>::BasicParticleFilter(const Settings &conf) :
+    ParticleFilterBase(conf), observation(this->conf), motion(this->conf) {
+    // the automatic relocalisation should not stall the update that needs it
+    if (this->conf.globalFit > 0.0f) {
+        prepareGlobalLocalisation();
+    }
+}
+
+//function gets mcs state and move particles
+template<class ObservationModel, class MotionModel, class Features>
+void BasicParticleFilter<ObservationModel, MotionModel, Features>::moveParticles(
+    const DirectedCoord &currMcsPosition) {
+    PF_PROFILE_STAGE(profiler, FilterStage::MOVE);
+    //cout << isReplaced<< (gamestate == GameState:: INITIAL) <<isPenalized<<isFallenRobot<<endl;
+    if ((isReplaced) or (gamestate == GameState:: INITIAL) or (isPenalized)) {
+        // if robot has been replaced ignore odometry
+        lastMcsPosition = currMcsPosition;
+        isReplaced = false;
+        return;
+    }
+    if (isFallenRobot) {
+        return;
+    }
+    //caculate odometry: difference between the last MCS_Position and the actual MCS_ Position
+    //use the toRCS function to get the differenc in RCS Coordinate System
+    DirectedCoord odometry = (currMcsPosition - lastMcsPosition);
+    odometry.coord = Coord(currMcsPosition.toRCS(lastMcsPosition).coord);
+    lastMcsPosition = DirectedCoord(currMcsPosition);
+
+    motion.move(particles, odometry, generator);
+}
+
+/*
+calculate a probability for one visionResult by comparing it with the landmarks from the same type
+*/
+template<class ObservationModel, class MotionModel, class Features>
+std::pair<float,Feature>
+BasicParticleFilter<ObservationModel, MotionModel, Features>::calculateProbabilityOfMatchingLandmark(
+    const Feature &visionresult, const std::vector<Feature> &pfLandmarks) const {
+    // calculate probability by comparing angle and distance
+    float probability = 0.0f;
+    Feature matchedLandmark;
+    for (const auto &pfLandmark: pfLandmarks) {
+        assert(visionresult.type == pfLandmark.type);
+        float tmpProb = observation.likelihood(visionresult, pfLandmark);
+        //choose the highest probability
+        if (tmpProb > probability) {
+            matchedLandmark = pfLandmark;
+            probability = tmpProb;
+        }
+    }
+    return {probability, matchedLandmark};
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::observeFeatures(
+    const std::vector<VisionResult> &vrs, SeenFeatures &seen) const {
+    //sort visionresults by type, extract dist and angle of the registered types
+    bool anySeen = false;
+    for (const auto &vr: vrs) {
+        Features::forEach([&](auto index, auto tag) {
+            using Type = typename decltype(tag)::type;
+            Feature feature;
+            if (vr.type == Type::type && Type::observe(*this, vr, feature)) {
+                seen[index].push_back(feature);
+                anySeen = true;
+            }
+        });
+    }
+    return anySeen;
+}
+
+/*
+calculate new weights of particles by comparing the visionresults with the conf.pf landmarks
+returns if weighting of particles was sucsessful
+
+*/
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::measurementModel(
+    const std::vector<VisionResult> &vrs) {
+    PF_PROFILE_STAGE(profiler, FilterStage::MEASUREMENT);
+    SeenFeatures seen;
+    if (!observeFeatures(vrs, seen)) {
+        return false;
+    }
+
+    // batched work of the seen types (distances and bearings of all particles at once)
+    particlePoses.assign(particles);
+    Features::forEach([&](auto index, auto tag) {
+        if (!seen[index].empty()) {
+            decltype(tag)::type::prepare(*this);
+        }
+    });
+    bool isMeasurementUpdate;
+    if (conf.refineShare > 0.0f && conf.refineShare < 1.0f) {
+        isMeasurementUpdate = weightTwoStage(seen);
+    } else if (conf.pruneShare > 0.0f) {
+        isMeasurementUpdate = weightPruned(seen);
+    } else {
+        isMeasurementUpdate = weightAll(seen);
+    }
+
+    // geometric mean over the seen features of how well the best particle
+    // matches them, relative to a perfect match
+    float best = 0.0f;
+    for (const auto &particle: particles) {
+        best = std::max(best, particle.weight);
+    }
+    float bound = 1.0f;
+    size_t numSeen = 0;
+    for (const auto &features: seen) {
+        for (const auto &feature: features) {
+            bound *= observation.maxLikelihood(feature);
+            ++numSeen;
+        }
+    }
+    measurementFit = (best > 0.0f && bound > 0.0f)
+                     ? std::pow(std::min(1.0f, best / bound), 1.0f / numSeen) : 0.0f;
+    return isMeasurementUpdate;
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::weightAll(
+    const SeenFeatures &seen) {
+    bool isMeasurementUpdate = false;
+    // every seen feature is matched against the features of its type
+    // as expected from the particle, the best match counts
+    std::vector<Feature> expected;
+    size_t numSeen = 0;
+    for (const auto &s: seen) {
+        numSeen += s.size();
+    }
+    measurementStats.particles += particles.size();
+    measurementStats.likelihoods += particles.size() * numSeen;
+    for (size_t i = 0; i < particles.size(); ++i) {
+        Particle &particle = particles[i];
+        matchedLandmarks.clear();
+        float probability = 1.0f;
+        // for every particle compare Visionresulst with Landmarks from Playingfield
+        Features::forEach([&](auto index, auto tag) {
+            if (seen[index].empty()) {
+                return;
+            }
+            decltype(tag)::type::expected(*this, i, expected);
+            for (const auto &feature: seen[index]) {
+                auto res = calculateProbabilityOfMatchingLandmark(feature, expected);
+                probability *= res.first;
+                matchedLandmarks.push_back(res.second);
+            }
+        });
+        // if we see one visionresult probability is smaller then 1.0
+        if (probability != 1.0f) {
+            particle.weight = probability;
+            isMeasurementUpdate = true;
+        }
+    }
+    return isMeasurementUpdate;
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+std::array<typename BasicParticleFilter<ObservationModel, MotionModel, Features>::ExpectedFn,
+           Features::size>
+BasicParticleFilter<ObservationModel, MotionModel, Features>::expectedFunctions() {
+    std::array<ExpectedFn, Features::size> expectedOf;
+    Features::forEach([&](auto index, auto tag) {
+        expectedOf[index] = &decltype(tag)::type::expected;
+    });
+    return expectedOf;
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+void BasicParticleFilter<ObservationModel, MotionModel, Features>::orderObservations(
+    const SeenFeatures &seen, size_t i, SeenFeatures &expected,
+    std::vector<Observation> &order) const {
+    // observations with few landmarks to match rule out wrong particles
+    // fastest (one center circle vs. eight L crosses), on ties the closer
+    // one is measured better
+    static const std::array<ExpectedFn, Features::size> expectedOf = expectedFunctions();
+    order.clear();
+    for (size_t t = 0; t < Features::size; ++t) {
+        if (seen[t].empty()) {
+            continue;
+        }
+        expectedOf[t](*this, i, expected[t]);
+        for (const auto &feature: seen[t]) {
+            order.push_back({t, &feature, expected[t].size(), observation.maxLikelihood(feature)});
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Observation &a, const Observation &b) {
+        if (a.candidates != b.candidates) {
+            return a.candidates < b.candidates;
+        }
+        return a.feature->dist < b.feature->dist;
+    });
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::weightPruned(
+    const SeenFeatures &seen) {
+    static const std::array<ExpectedFn, Features::size> expectedOf = expectedFunctions();
+
+    // the order is the one of the particle closest to the last estimate
+    std::vector<Observation> order;
+    SeenFeatures expected;
+    orderObservations(seen, closestParticle(pos), expected, order);
+    // bestRemaining[k]: log of the best the observations k... can give
+    std::vector<float> bestRemaining(order.size() + 1, 0.0f);
+    for (size_t k = order.size(); k-- > 0;) {
+        bestRemaining[k] = bestRemaining[k + 1] + std::log(order[k].maxLikelihood);
+    }
+
+    // the first observation is evaluated for every particle anyway, the
+    // particles are then evaluated best first: the bound is high early
+    const size_t n = particles.size();
+    std::vector<float> firstLikelihood(n, 1.0f);
+    std::vector<size_t> rank(n);
+    for (size_t i = 0; i < n; ++i) {
+        rank[i] = i;
+    }
+    if (!order.empty()) {
+        std::vector<Feature> expectedFirst;
+        for (size_t i = 0; i < n; ++i) {
+            expectedOf[order[0].type](*this, i, expectedFirst);
+            firstLikelihood[i] =
+                calculateProbabilityOfMatchingLandmark(*order[0].feature, expectedFirst).first;
+        }
+        std::stable_sort(rank.begin(), rank.end(), [&](size_t a, size_t b) {
+            return firstLikelihood[a] > firstLikelihood[b];
+        });
+    }
+
+    // resampling gives a particle N * w / sum(w) copies (expected) and
+    // sum(w) >= best: below best * u / N it gets less than u copies
+    const float logGranularity = std::log(n / conf.pruneShare);
+    float logBest = -std::numeric_limits<float>::infinity();
+    bool isMeasurementUpdate = false;
+    std::array<bool, Features::size> ready;
+    for (size_t i: rank) {
+        Particle &particle = particles[i];
+        ready.fill(false);
+        matchedLandmarks.clear();
+        const float threshold = logBest - logGranularity;
+        // the weight as in weightAll, its log for the bound (no underflow)
+        float probability = 1.0f;
+        float logw = 0.0f;
+        size_t k = 0;
+        if (!order.empty()) {
+            probability = firstLikelihood[i];
+            logw = std::log(probability);
+            k = 1;
+        }
+        for (; k < order.size() && logw + bestRemaining[k] >= threshold; ++k) {
+            const Observation &o = order[k];
+            if (!ready[o.type]) {
+                expectedOf[o.type](*this, i, expected[o.type]);
+                ready[o.type] = true;
+            }
+            auto res = calculateProbabilityOfMatchingLandmark(*o.feature, expected[o.type]);
+            probability *= res.first;
+            logw += std::log(res.first);
+            matchedLandmarks.push_back(res.second);
+        }
+        measurementStats.particles++;
+        measurementStats.likelihoods += k;
+        if (k < order.size()) {
+            measurementStats.pruned++;
+            measurementStats.skipped += order.size() - k;
+            particle.weight = 0.0f;
+            isMeasurementUpdate = true;
+        } else {
+            logBest = std::max(logBest, logw);
+            if (probability != 1.0f) {
+                particle.weight = probability;
+                isMeasurementUpdate = true;
+            }
+        }
+    }
+    return isMeasurementUpdate;
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::weightTwoStage(
+    const SeenFeatures &seen) {
+    static const std::array<ExpectedFn, Features::size> expectedOf = expectedFunctions();
+
+    // the order (and so the coarse subset) is the one of the best guess
+    std::vector<Observation> order;
+    SeenFeatures expected;
+    orderObservations(seen, closestParticle(pos), expected, order);
+    const size_t coarse = std::min<size_t>(conf.coarseObservations, order.size());
+
+    // stage one: all particles, the first observations only
+    std::vector<float> coarseWeight(particles.size());
+    std::array<bool, Features::size> ready;
+    for (size_t i = 0; i < particles.size(); ++i) {
+        ready.fill(false);
+        float probability = 1.0f;
+        for (size_t k = 0; k < coarse; ++k) {
+            const Observation &o = order[k];
+            if (!ready[o.type]) {
+                expectedOf[o.type](*this, i, expected[o.type]);
+                ready[o.type] = true;
+            }
+            probability *= calculateProbabilityOfMatchingLandmark(*o.feature,
+                                                                  expected[o.type]).first;
+        }
+        coarseWeight[i] = probability;
+    }
+
+    // stage two: the best refineShare of the particles, all observations
+    std::vector<size_t> ranked(particles.size());
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        ranked[i] = i;
+    }
+    const size_t refined = std::max<size_t>(1, std::min(ranked.size(),
+        static_cast<size_t>(std::ceil(conf.refineShare * ranked.size()))));
+    std::nth_element(ranked.begin(), ranked.begin() + (refined - 1), ranked.end(),
+                     [&](size_t a, size_t b) { return coarseWeight[a] > coarseWeight[b]; });
+    // the others ranked below every refined particle in stage one, they are
+    // assumed to match the remaining observations no better than the worst
+    // refined one
+    float remainder = 1.0f;
+    for (size_t r = 0; r < refined; ++r) {
+        const size_t i = ranked[r];
+        ready.fill(false);
+        matchedLandmarks.clear();
+        float probability = coarseWeight[i];
+        for (size_t k = coarse; k < order.size(); ++k) {
+            const Observation &o = order[k];
+            if (!ready[o.type]) {
+                expectedOf[o.type](*this, i, expected[o.type]);
+                ready[o.type] = true;
+            }
+            auto res = calculateProbabilityOfMatchingLandmark(*o.feature, expected[o.type]);
+            probability *= res.first;
+            matchedLandmarks.push_back(res.second);
+        }
+        if (coarseWeight[i] > 0.0f) {
+            remainder = std::min(remainder, probability / coarseWeight[i]);
+        }
+        particles[i].weight = probability;
+    }
+    for (size_t r = refined; r < ranked.size(); ++r) {
+        particles[ranked[r]].weight = coarseWeight[ranked[r]] * remainder;
+    }
+
+    measurementStats.particles += particles.size();
+    measurementStats.likelihoods += particles.size() * coarse + refined * (order.size() - coarse);
+    measurementStats.skipped += (particles.size() - refined) * (order.size() - coarse);
+    return true;
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+void BasicParticleFilter<ObservationModel, MotionModel, Features>::prepareGlobalLocalisation() {
+    if (globalGrid.cells.empty() || globalGrid.step != conf.globalGridStep
+            || globalGrid.angles != conf.globalGridAngles) {
+        buildGlobalGrid();
+    }
+    const size_t threads = std::min<size_t>(globalGrid.cells.size(), conf.globalThreads
+                           ? conf.globalThreads : std::max(1u, std::thread::hardware_concurrency()));
+    if (!globalGrid.workers || globalGrid.workers->size() != std::max<size_t>(1, threads)) {
+        globalGrid.workers.reset(new WorkerPool(threads > 1 ? threads - 1 : 0));
+    }
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+void BasicParticleFilter<ObservationModel, MotionModel, Features>::buildGlobalGrid() {
+    globalGrid.step = conf.globalGridStep;
+    globalGrid.angles = conf.globalGridAngles;
+    globalGrid.cells = globalGridCells();
+    globalGrid.features.assign(Features::size, std::vector<Feature>());
+    globalGrid.offsets.assign(Features::size, std::vector<uint32_t>(1, 0));
+
+    // the cells go through the batched feature path of the particles, so
+    // they are scored exactly like particles (the rcs tables are refilled
+    // by the next measurement update anyway)
+    std::swap(particles, globalGrid.cells);
+    particlePoses.assign(particles);
+    std::vector<Feature> expected;
+    Features::forEach([&](auto index, auto tag) {
+        using Type = typename decltype(tag)::type;
+        Type::prepare(*this);
+        for (size_t c = 0; c < particles.size(); ++c) {
+            Type::expected(*this, c, expected);
+            auto &features = globalGrid.features[index];
+            features.insert(features.end(), expected.begin(), expected.end());
+            globalGrid.offsets[index].push_back(static_cast<uint32_t>(features.size()));
+        }
+    });
+    std::swap(particles, globalGrid.cells);
+}
+
+template<class ObservationModel, class MotionModel, class Features>
+bool BasicParticleFilter<ObservationModel, MotionModel, Features>::globalLocalisation(
+    const std::vector<VisionResult> &vrs) {
+    PF_PROFILE_STAGE(profiler, FilterStage::GLOBAL);
+    SeenFeatures seen;
+    if (!observeFeatures(vrs, seen)) {
+        return false;
+    }
+    prepareGlobalLocalisation();
+
+    // score every cell like a particle, in parallel over contiguous ranges
+    const size_t numCells = globalGrid.cells.size();
+    std::vector<float> score(numCells);
+    auto scoreCells = [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            float probability = 1.0f;
+            for (size_t t = 0; t < Features::size; ++t) {
+                const Feature *first = globalGrid.features[t].data() + globalGrid.offsets[t][c];
+                const Feature *last = globalGrid.features[t].data() + globalGrid.offsets[t][c + 1];
+                for (const auto &feature: seen[t]) {
+                    float match = 0.0f;
+                    for (const Feature *e = first; e != last; ++e) {
+                        match = std::max(match, observation.likelihood(feature, *e));
+                    }
+                    probability *= match;
+                }
+            }
+            score[c] = probability;
+        }
+    };
+    const size_t threads = globalGrid.workers->size();
+    const size_t chunk = (numCells + threads - 1) / threads;
+    globalGrid.workers->run(threads, [&](size_t t) {
+        scoreCells(std::min(numCells, t * chunk), std::min(numCells, (t + 1) * chunk));
+    });
+
+    // the best cells, neighbours of an already chosen cell are skipped
+    std::vector<size_t> ranked(numCells);
+    for (size_t c = 0; c < numCells; ++c) {
+        ranked[c] = c;
+    }
+    std::sort(ranked.begin(), ranked.end(), [&](size_t a, size_t b) {
+        return score[a] > score[b];
+    });
+    const float angleStep = 2.0f * M_PI_F / std::max<size_t>(1, globalGrid.angles);
+    std::vector<DirectedCoord> best;
+    for (size_t c: ranked) {
+        if (best.size() >= std::max<size_t>(1, conf.globalCells) || score[c] <= 0.0f) {
+            break;
+        }
+        const DirectedCoord &cell = globalGrid.cells[c].pose;
+        bool neighbour = false;
+        for (const auto &b: best) {
+            neighbour = neighbour || (cell.coord.dist(b.coord) < 1.5f * globalGrid.step
+                        && FastAngle(cell.angle).absDist(FastAngle(b.angle)) < 1.5f * angleStep);
+        }
+        if (!neighbour) {
+            best.push_back(cell);
+        }
+    }
+    if (best.empty()) {
+        return false;
+    }
+    // spread over the cells (round robin), equal weights
+    setParticlesToPosition(best, 0.5f * globalGrid.step, 0.5f * globalGrid.step,
+                           0.5f * angleStep);
+    return true;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -48,6 +48,14 @@ microTime getMicroTime() {
 
 
 
+nanoTime getMonotonicNanoTime() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (nanoTime) ts.tv_sec * 1000000000LL + (nanoTime) ts.tv_nsec;
+}
+
+
+
 TimestampMs getTimestampMs() {
     struct timeval tv;
     static int start = 0; // dirty hack to determine framework start time
@@ -16,6 +16,9 @@ microTime getMicroTime();
 // get timestamp in milliseconds (1e-3 seconds)
 TimestampMs getTimestampMs();
 
+// get monotonic time in nanoseconds (1e-9 seconds), for measuring durations
+nanoTime getMonotonicNanoTime();
+
 // custom exit
 __attribute__((noreturn)) void _exit(const std::string &msg);
 
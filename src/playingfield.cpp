@@ -4,6 +4,7 @@
  */
 
 #include "playingfield.h"
+#include "batchtransform.h"
 #include <cmath>
 #include <constants.h>
 #include <cassert>
@@ -29,235 +30,123 @@ using namespace std;
 
 PlayingField::PlayingField(FieldSize fieldSize) {
     _size = fieldSize;
+    // the landmarks of all presets are generated at compile time (see fieldmodel.h)
+    loadModel(getFieldModel(_size));
+}
 
-    switch (_size) {
-    case FieldSize::JRL:
-        // This the JRL's permanent playingfield (defined accordning to pre 2012 SPL rules)
-        createField({
-                .fieldLength = 5.95f,
-                .fieldWidth = 3.95f,
-                .centerCircleDiameter = 1.15f,
-                .penaltyCrossDistance = 1.35f
-            });
-        break;
-    case FieldSize::HTWK:
-        // field for HTWK Leipzig event, May 2014
-        createField({
-                .fieldLength = 7.5f,
-                .fieldWidth = 5.f
-            });
-        break;
-    case FieldSize::TINY:
-        // tiny 4x1.8m field for exhibitions
-        createField({
-                .fieldLength = 4.f,
-                .fieldWidth = 1.75f,
-                .centerCircleDiameter = 0.8f,
-                .penaltyCrossDistance = 1.1f,
-                .penaltyAreaLength = 0.55f,
-                .penaltyAreaWidth = 1.f,
-                .goalWidth = 0.56f,
-                .goalPostDiameter = 0.1f,
-                .goalboxDepth = 0.3f,
-            });
-
-        break;
-    case FieldSize::SPL2020:
-        // This the JRL's permanent playingfield (defined accordning to pre 2012 SPL rules)
-        createField({
-                .fieldLength = 9.f,
-                .fieldWidth = 6.f,
-                .centerCircleDiameter = 1.5f,
-                .penaltyCrossDistance = 1.4f,
-                .penaltyAreaLength = 1.65f,
-                .penaltyAreaWidth = 4.f
-            });
-        break;
-    case FieldSize::SPL:
-    default:
-        // use function defaults defined in header for current SPL field,
-        // according to the Rules 2013 Draft, published on November 8th 2012
-        createField(FieldMeasurements());
-    }
-
-    assert(_poles.size() == PoleMAX);
-    assert(_lines.size() == LineMAX);
-    assert(_crosses.size() == CrossMAX);
+PlayingField::PlayingField(const FieldMeasurements &fm, FieldSize fieldSize) {
+    _size = fieldSize;
+    createField(fm);
 }
 
 PlayingField::~PlayingField() {
 }
 
 void PlayingField::createField(const FieldMeasurements &fm) {
-
-    // total size of field (playing area + border strips)
-    _length = fm.fieldLength + 2 * fm.borderStripWidth;
-    _width = fm.fieldWidth + 2 * fm.borderStripWidth;
-
-    // set length and width (of area inside the lines) in meters
-    _lengthInsideBounds = fm.fieldLength;
-    _widthInsideBounds = fm.fieldWidth;
-
-    _lineWidth = fm.lineWidth;
-
-    // set Goal width (distance between center of goal posts)
-    _goalWidth = fm.goalWidth + fm.goalPostDiameter;
-
-    _penaltyLength = fm.penaltyAreaLength;
-    _penaltyWidth = fm.penaltyAreaWidth;
+    _customModel = std::make_shared<const FieldModel>(makeFieldModel(fm));
+    loadModel(*_customModel);
+}
+
+void PlayingField::loadModel(const FieldModel &model) {
+    _model = &model;
+
+    _length = model.length;
+    _width = model.width;
+    _lengthInsideBounds = model.lengthInsideBounds;
+    _widthInsideBounds = model.widthInsideBounds;
+    _lineWidth = model.lineWidth;
+    _goalWidth = model.goalWidth;
+    _penaltyLength = model.penaltyLength;
+    _penaltyWidth = model.penaltyWidth;
+    _penaltyCrossDistance = model.penaltyCrossDistance;
+    _penaltyCrossSize = model.penaltyCrossSize;
+    _outerDiagonal = model.outerDiagonal;
+    _innerDiagonal = model.innerDiagonal;
 
     // center circle
     _circle.wcs_x = 0.0f;
     _circle.wcs_y = 0.0f;
     _circle.name = Line::CENTER_CIRCLE;
-    _circle.wcs_radius = fm.centerCircleDiameter / 2.f;
+    _circle.wcs_radius = model.circleRadius;
 
     _lines.clear();
-    _crosses.clear();
-
-    _penaltyCrossDistance = fm.penaltyCrossDistance;
-    _penaltyCrossSize = fm.penaltyCrossSize;
-
-    const float x = fm.fieldLength / 2.f;
-    const float y = fm.fieldWidth / 2.f;
-
-    // outer borders
-    createNewLineDefinition(0.0f * M_PI_F,     x,     y,    -x,     y, Line::LEFT);
-    createNewLineDefinition(0.0f * M_PI_F,     x,    -y,    -x,    -y,
-                            Line::RIGHT);
-    createNewLineDefinition(0.5f * M_PI_F,     x,     y,     x,    -y, Line::TOP);
-    createNewLineDefinition(0.5f * M_PI_F,    -x,     y,    -x,    -y,
-                            Line::BOTTOM);
-
-    // center line
-    createNewLineDefinition(0.5f * M_PI_F,  0.0f,     y,  0.0f,    -y,
-                            Line::MIDDLE);
-
-    const float px = x - fm.penaltyAreaLength;
-    const float py = fm.penaltyAreaWidth / 2.f;
-    const float mx = x - fm.penaltyCrossDistance;
-
-    // opponent's penalty area
-    createNewLineDefinition(0.5f * M_PI_F,  px,    py,  px,  -py,
-                            Line::OPP_PENALTY);
-    createNewLineDefinition(0.0f * M_PI_F,   x,    py,  px,   py,
-                            Line::OPP_PENALTY_LEFT);
-    createNewLineDefinition(0.0f * M_PI_F,   x,   -py,  px,  -py,
-                            Line::OPP_PENALTY_RIGHT);
-    createNewLineDefinition(0.0f * M_PI_F,  mx,  0.0f,  mx, 0.0f,
-                            Line::OPP_PENALTY_SHOOTMARK);
-
-    // our penalty area
-    createNewLineDefinition(0.5f * M_PI_F, -px,    py, -px,  -py,
-                            Line::OWN_PENALTY);
-    createNewLineDefinition(0.0f * M_PI_F,  -x,    py, -px,   py,
-                            Line::OWN_PENALTY_LEFT);
-    createNewLineDefinition(0.0f * M_PI_F,  -x,   -py, -px,  -py,
-                            Line::OWN_PENALTY_RIGHT);
-    createNewLineDefinition(0.0f * M_PI_F, -mx,  0.0f, -mx, 0.0f,
-                            Line::OWN_PENALTY_SHOOTMARK);
-
-    // goalbox
-    const float gbCorner_y = fm.goalWidth/2 + fm.goalPostDiameter/2;
-    const float frontCorner_x = fm.fieldLength/2;
-    const float gbBackCorner_x = frontCorner_x + fm.goalboxDepth;
-
-    createNewLineDefinition(0, gbBackCorner_x, gbCorner_y, gbBackCorner_x, -gbCorner_y,
-                            Line::OPP_GOALBOX_BACK);
-    createNewLineDefinition(0, frontCorner_x, gbCorner_y, gbBackCorner_x, gbCorner_y,
-                            Line::OPP_GOALBOX_LEFT);
-    createNewLineDefinition(0, frontCorner_x, -gbCorner_y, gbBackCorner_x, -gbCorner_y,
-                            Line::OPP_GOALBOX_RIGHT);
-    createNewLineDefinition(0, -gbBackCorner_x, gbCorner_y, -gbBackCorner_x, -gbCorner_y,
-                            Line::OWN_GOALBOX_BACK);
-    createNewLineDefinition(0, -frontCorner_x, gbCorner_y, -gbBackCorner_x, gbCorner_y,
-                            Line::OWN_GOALBOX_LEFT);
-    createNewLineDefinition(0, -frontCorner_x, -gbCorner_y, -gbBackCorner_x, -gbCorner_y,
-                            Line::OWN_GOALBOX_RIGHT);
-    
-
-    const float c = fm.centerCircleDiameter / 2.0f;
-
-    // these are the cross definitions
-    createNewCrossDefinition(x,    y, 1.0f * M_PI_F, 2, Cross::L_OPP_LEFT);
-    createNewCrossDefinition(0.0f,    y, 1.5f * M_PI_F, 3, Cross::T_LEFT);
-    createNewCrossDefinition(-x,    y, 1.5f * M_PI_F, 2, Cross::L_OWN_LEFT);
-    createNewCrossDefinition(x,   -y, 0.5f * M_PI_F, 2, Cross::L_OPP_RIGHT);
-    createNewCrossDefinition(0.0f,   -y, 0.5f * M_PI_F, 3, Cross::T_RIGHT);
-    createNewCrossDefinition(-x,   -y, 0.0f * M_PI_F, 2, Cross::L_OWN_RIGHT);
-    createNewCrossDefinition(0.0f,    c, 0.5f * M_PI_F, 4, Cross::X_LEFT);
-    createNewCrossDefinition(0.0f,   -c, 0.5f * M_PI_F, 4, Cross::X_RIGHT);
-    createNewCrossDefinition(x,   py, 1.0f * M_PI_F, 3,
-                             Cross::T_OPP_GOAL_LEFT);
-    createNewCrossDefinition(x,  -py, 1.0f * M_PI_F, 3,
-                             Cross::T_OPP_GOAL_RIGHT);
-    createNewCrossDefinition(px,   py, 1.5f * M_PI_F, 2,
-                             Cross::L_OPP_GOAL_LEFT);
-    createNewCrossDefinition(px,  -py, 0.0f * M_PI_F, 2,
-                             Cross::L_OPP_GOAL_RIGHT);
-
-    createNewCrossDefinition(gbBackCorner_x, gbCorner_y, M_PI_F, 2,
-                             Cross::L_OPP_GOALBOX_LEFT);
-    createNewCrossDefinition(gbBackCorner_x, -gbCorner_y, 0.5f*M_PI_F, 2,
-                             Cross::L_OPP_GOALBOX_RIGHT);
-    createNewCrossDefinition(x,  gbCorner_y, 0.0f * M_PI_F, 3,
-                             Cross::T_OPP_GOALBOX_LEFT);
-    createNewCrossDefinition(x,  -gbCorner_y, 0.0f * M_PI_F, 3,
-                             Cross::T_OPP_GOALBOX_RIGHT);
-
-
-    createNewCrossDefinition(-px,   py, 1.0f * M_PI_F, 2,
-                             Cross::L_OWN_GOAL_LEFT);
-    createNewCrossDefinition(-px,  -py, 0.5f * M_PI_F, 2,
-                             Cross::L_OWN_GOAL_RIGHT);
-
-    createNewCrossDefinition(-gbBackCorner_x, gbCorner_y, 1.5f*M_PI_F, 2,
-                             Cross::L_OWN_GOALBOX_LEFT);
-    createNewCrossDefinition(-gbBackCorner_x, -gbCorner_y, 0, 2,
-                             Cross::L_OWN_GOALBOX_RIGHT);
-
-    createNewCrossDefinition(-x,  py, 0.0f * M_PI_F, 3,
-                             Cross::T_OWN_GOAL_LEFT);
-    createNewCrossDefinition(-x,  -py, 0.0f * M_PI_F, 3,
-                             Cross::T_OWN_GOAL_RIGHT);
-
-    createNewCrossDefinition(-x,  gbCorner_y, 1.0f * M_PI_F, 3,
-                             Cross::T_OWN_GOALBOX_LEFT);
-    createNewCrossDefinition(-x,  -gbCorner_y, 1.0f * M_PI_F, 3,
-                             Cross::T_OWN_GOALBOX_RIGHT);
-
-    // poles
-    const float g = (fm.goalWidth + fm.goalPostDiameter) / 2;
-    createNewPoleDefinition(x,  g, fm.goalPostHeight, fm.goalPostDiameter, 0,
-                            Pole::OPP_LEFT);
-    createNewPoleDefinition(x, -g, fm.goalPostHeight, fm.goalPostDiameter, 0,
-                            Pole::OPP_RIGHT);
-    createNewPoleDefinition(-x,  g, fm.goalPostHeight, fm.goalPostDiameter, 0,
-                            Pole::OWN_LEFT);
-    createNewPoleDefinition(-x, -g, fm.goalPostHeight, fm.goalPostDiameter, 0,
-                            Pole::OWN_RIGHT);
+    for (const auto &l : model.lines) {
+        LandmarkLine line;
+        line.name = l.name;
+        line.start_x = l.start_x;
+        line.start_y = l.start_y;
+        line.end_x = l.end_x;
+        line.end_y = l.end_y;
+        line.equation = l.equation;
+        line.equationNormal = l.equationNormal;
+        _lines.push_back(line);
+    }
 
+    _crosses.clear();
+    for (const auto &c : model.crosses) {
+        LandmarkCross cross;
+        cross.name = c.name;
+        cross.wcs_x = c.wcs_x;
+        cross.wcs_y = c.wcs_y;
+        cross.wcs_alpha = c.wcs_alpha;
+        cross.degree = c.degree;
+        cross.equation = Vec3f::point(c.wcs_x, c.wcs_y);
+        _crosses.push_back(cross);
+    }
 
+    _poles.clear();
+    for (const auto &p : model.poles) {
+        LandmarkPole pole;
+        pole.name = p.name;
+        pole.wcs_x = p.wcs_x;
+        pole.wcs_y = p.wcs_y;
+        pole.wcs_width = p.wcs_width;
+        pole.wcs_height = p.wcs_height;
+        pole.color = p.color;
+        pole.equation = Vec3f::point(p.wcs_x, p.wcs_y);
+        _poles.push_back(pole);
+    }
 
     // goals
-    createNewGoalDefinition(_poles[static_cast<int>(Pole::OPP_LEFT)],
-                            _poles[static_cast<int>(Pole::OPP_RIGHT)],
-                            fm.goalWidth + fm.goalPostDiameter, 1);
-    createNewGoalDefinition(_poles[static_cast<int>(Pole::OWN_LEFT)],
-                            _poles[static_cast<int>(Pole::OWN_RIGHT)],
-                            fm.goalWidth + fm.goalPostDiameter, 0);
+    const float poleDistance = model.goalWidth;
+    _goals.first = {_poles[static_cast<int>(Pole::OPP_LEFT)],
+                    _poles[static_cast<int>(Pole::OPP_RIGHT)],
+                    poleDistance, _poles[static_cast<int>(Pole::OPP_LEFT)].color};
+    _goals.second = {_poles[static_cast<int>(Pole::OWN_LEFT)],
+                     _poles[static_cast<int>(Pole::OWN_RIGHT)],
+                     poleDistance, _poles[static_cast<int>(Pole::OWN_LEFT)].color};
+
+    centerpointGoaliDefenderCircle = {model.goaliDefenderCircle_x,
+                                      model.goaliDefenderCircle_y};
+    radiusGoaliDefenderCircle = model.goaliDefenderCircleRadius;
 
-    _outerDiagonal = sqrtf(_length * _length + _width * _width);
-    _innerDiagonal = sqrtf(_lengthInsideBounds * _lengthInsideBounds +
-                           _widthInsideBounds * _widthInsideBounds);
+    assert(_poles.size() == PoleMAX);
+    assert(_lines.size() == LineMAX);
+    assert(_crosses.size() == CrossMAX);
 
-    // according to Tim's transformation:
-    // folgt aus den Verhältnis, dass der Kreis durch die Torpfosten 
-    // und den mittelpunkt des Strafraums gehen soll
-    float centerpointGoaliDefenderCircle_xdiff = (_penaltyWidth/2.0f)*(_penaltyWidth/2.0f)/(_penaltyLength)
-                                    -((_penaltyLength)/4);
-    centerpointGoaliDefenderCircle = {-(_lengthInsideBounds/2+centerpointGoaliDefenderCircle_xdiff),0.0f};
-    radiusGoaliDefenderCircle = (_penaltyLength/2.0f)+ centerpointGoaliDefenderCircle_xdiff;
+    initLandmarkBatches();
+}
+
+void PlayingField::initLandmarkBatches() {
+    for (int mask = 0; mask <= LANDMARK_ALL; ++mask) {
+        LandmarkBatch &batch = _landmarkBatches[mask];
+        batch.points.clear();
+        batch.landmark.clear();
+        for (const auto &c: _crosses) {
+            // degree 2 (L) -> 0, 3 (T) -> 1, 4 (X) -> 2
+            const int landmark = c.degree - 2;
+            if (mask & (1 << landmark)) {
+                batch.points.push_back(Coord(c.wcs_x, c.wcs_y));
+                batch.landmark.push_back(landmark);
+            }
+        }
+        if (mask & LANDMARK_POLE) {
+            for (const auto &p: _poles) {
+                batch.points.push_back(Coord(p.wcs_x, p.wcs_y));
+                batch.landmark.push_back(3);
+            }
+        }
+    }
 }
 
 
@@ -510,94 +399,14 @@ float PlayingField::penaltyBoxToMiddleLineLength() const {
     return (_length / 2) - _penaltyLength;
 }
 
-// creating functions used in constructor to fill the objekt with live
-
-void PlayingField::createNewLineDefinition(const float alpha,
-        const float startX, const float startY, const float endX, const float endY,
-        const Line lineType) {
-    assert(_lines.size() == static_cast<size_t>(lineType));
-    LandmarkLine line;
-
-    line.equationNormal = vectorCrossProductUnNormed({startX, startY, 1.f}, {endX, endY, 1.f});
-    line.equation = getHesseNormalFormOfLine(line.equationNormal);
-
-    /* line.wcs_alpha = alpha; */
-
-    line.start_x = startX;
-    line.start_y = startY;
-    line.end_x = endX;
-    line.end_y = endY;
-
-    line.name = lineType;
-
-    _lines.push_back(line);
-}
-
-void PlayingField::createNewCrossDefinition(const float x, const float y,
-        const float alpha, const int degree,
-        const Cross crossType) {
-    //std::cout << _crosses.size() << ","<< static_cast<size_t>(crossType)<<std::endl;
-    assert(_crosses.size() == static_cast<size_t>(crossType));
-    LandmarkCross cross;
-
-    cross.equation = {x, y, 1.f};
-    cross.wcs_x = x;
-    cross.wcs_y = y;
-    cross.wcs_alpha = alpha;
-    cross.degree = degree;
-    cross.name = crossType;
-
-    _crosses.push_back(cross);
-}
-
-LandmarkPole PlayingField::createNewPoleDefinition(const float x,
-        const float y,
-        const float height,
-        const float width,
-        const int color,
-        const Pole poleType) {
-    assert(_poles.size() == static_cast<size_t>(poleType));
-
-    LandmarkPole pole;
-    pole.wcs_x = x;
-    pole.wcs_y = y;
-    pole.wcs_width = width;
-    pole.wcs_height = height;
-    pole.color = color;
-    pole.name = poleType;
-    pole.equation = {x, y, 1.f};
-
-    _poles.push_back(pole);
-
-    return pole;
-}
-
-void PlayingField::createNewGoalDefinition(const LandmarkPole &left,
-        const LandmarkPole &right,
-        const float poleDistance,
-        bool opponent) {
-    LandmarkGoal goal;
-    goal.left = left;
-    goal.right = right;
-    goal.wcs_pole_distance = poleDistance;
-    goal.color = left.color;
-
-    if (opponent) {
-        _goals.first = goal;
-    } else {
-        _goals.second = goal;
-    }
-}
-
-
-
-
 void PlayingField::createDistVecOfCrosses() {
     for (size_t i = 0; i < CrossMAX; i++) {
         _crosses.at(i).distances.clear();
 
         for (size_t j = 0; j <  CrossMAX; j++) {
-            float dist = Coord(_crosses.at(i).equation).dist(_crosses.at(j).equation);
+            const Vec3f &a = _crosses.at(i).equation;
+            const Vec3f &b = _crosses.at(j).equation;
+            float dist = Coord(a[0], a[1]).dist(Coord(b[0], b[1]));
             _crosses.at(i).distances.push_back(dist);
         }
         assert(_crosses.at(i).distances.size() == CrossMAX);
@@ -668,54 +477,41 @@ std::vector<LandmarkPole> PlayingField::getPoals() const {
 }
 
 vector<LandmarkOrientation> PlayingField::getDistsAndAngles(
-    const DirectedCoord &from, int type) {
-
-    vector<DirectedCoord> landmark_positions;
+    const DirectedCoord &from, int type) const {
 
     // len(L)     = 8, type 0
     // len(T)     = 6, type 1
     // len(X)     = 2, type 2
     // len(poles) = 4, type 3
-
-    vector<LandmarkOrientation> ret;
-
-    // Crosses
-    for (const auto &c: _crosses) {
-        LandmarkOrientation lo;
-        memset(&lo, 0, sizeof(lo));
-        if (c.degree == 3) {
-            lo.landmark = 1;
-        } else if (c.degree == 4) {
-            lo.landmark = 2;
-        } else {
-            lo.landmark = 0;
-        }
-
-        landmark_positions.emplace_back(c.wcs_x, c.wcs_y, 0.0f);
-        ret.push_back(lo);
-    }
-
-    // Poles
-    LandmarkOrientation lo;
-    memset(&lo, 0, sizeof(lo));
-    lo.landmark = 3;
-    for (const auto &p: _poles) {
-        landmark_positions.emplace_back(p.wcs_x, p.wcs_y, 0.0f);
-        ret.push_back(lo);
-    }
-
-    auto rt = ret.begin();
-    for (const auto &lp: landmark_positions) {
-        // translate this target wcs position to rcs, according to the
-        // own position in the wcs
-        DirectedCoord guess = lp.toRCS(from);
-        rt->rcs_dist = guess.coord.dist();
-        rt->rcs_angle = guess.coord.angle().rad;
+    const LandmarkBatch &batch = landmarkBatch(type < 0 ? LANDMARK_ALL : 1 << type);
+    const size_t n = batch.points.size();
+
+    // translate the target wcs positions to rcs, according to the
+    // own position in the wcs
+    float dist[CrossMAX + PoleMAX], bearing[CrossMAX + PoleMAX];
+    const float c = cosf(from.angle.rad);
+    const float s = sinf(from.angle.rad);
+    transformToRCS(&from.coord.x, &from.coord.y, &c, &s, 1, batch.points.x.data(),
+                   batch.points.y.data(), n, nullptr, nullptr, dist, bearing);
+
+    vector<LandmarkOrientation> ret(n);
+    for (size_t i = 0; i < n; ++i) {
+        ret[i].rcs_dist = dist[i];
+        ret[i].rcs_angle = bearing[i];
+        ret[i].landmark = batch.landmark[i];
     }
-
     return ret;
 }
 
+size_t PlayingField::getDistsAndAngles(const PoseBatch &poses, int mask, float *dist,
+                                       float *bearing) const {
+    const PointBatch &points = landmarkBatch(mask).points;
+    transformToRCS(poses.x.data(), poses.y.data(), poses.cosTheta.data(), poses.sinTheta.data(),
+                   poses.size(), points.x.data(), points.y.data(), points.size(), nullptr,
+                   nullptr, dist, bearing);
+    return points.size();
+}
+
 DirectedCoord PlayingField::kick_off_position(bool has_kickoff){
         if (!has_kickoff){
             return DirectedCoord((-1.7f * _circle.wcs_radius), 0.0f, 0.0f);
@@ -9,92 +9,13 @@
 
 #include <types.h>
 #include <mathtoolbox.h>
+#include <fieldmodel.h>
+#include <batchtransform.h>
+#include <array>
 #include <vector>
+#include <memory>
 #include <cstring>
 
-/* This enums are used in jslinematching, so do not change them, if do not know what you do! */
-enum class Line {
-    LEFT,
-    RIGHT,
-    TOP,
-    BOTTOM,
-    MIDDLE,
-    OPP_PENALTY,
-    OPP_PENALTY_LEFT,
-    OPP_PENALTY_RIGHT,
-    OPP_PENALTY_SHOOTMARK,
-    OWN_PENALTY,
-    OWN_PENALTY_LEFT,
-    OWN_PENALTY_RIGHT,
-    OWN_PENALTY_SHOOTMARK,
-    OPP_GOALBOX_BACK,
-    OPP_GOALBOX_LEFT,
-    OPP_GOALBOX_RIGHT,
-    OWN_GOALBOX_BACK,
-    OWN_GOALBOX_LEFT,
-    OWN_GOALBOX_RIGHT,
-    CENTER_CIRCLE,
-    UNKNOWN
-};
-static const size_t LineMAX = static_cast<size_t>(Line::CENTER_CIRCLE);
-
-
-/* This are the Crose names, do not change, theire are used in jslinemathing */
-/* TODO: take names that are intuitive ... like it has been done with the lines */
-/* The Crosses are seen from the center point of the field, facing the enemy goal*/
-/*
- *      -x    Left        x
- * |------------------------|
- * |           |            | y
- * |--         |          --|
- * |  |        |         |  |
- * |  |        x-->      |  | Top
- * |  |        |         |  |
- * |--         |          --| -y
- * |           |            |
- * |------------------------|
- *  own half  Right   opposite
- */
-
-
-enum class Cross {
-    L_OPP_LEFT,
-    T_LEFT,
-    L_OWN_LEFT,
-    L_OPP_RIGHT,
-    T_RIGHT,
-    L_OWN_RIGHT,
-    X_LEFT,
-    X_RIGHT,
-    T_OPP_GOAL_LEFT,
-    T_OPP_GOAL_RIGHT,
-    L_OPP_GOAL_LEFT,
-    L_OPP_GOAL_RIGHT,
-    L_OPP_GOALBOX_LEFT,
-    L_OPP_GOALBOX_RIGHT,
-    T_OPP_GOALBOX_LEFT,
-    T_OPP_GOALBOX_RIGHT,
-    L_OWN_GOAL_LEFT,
-    L_OWN_GOAL_RIGHT,
-    L_OWN_GOALBOX_LEFT,
-    L_OWN_GOALBOX_RIGHT,
-    T_OWN_GOAL_LEFT,
-    T_OWN_GOAL_RIGHT,
-    T_OWN_GOALBOX_LEFT,
-    T_OWN_GOALBOX_RIGHT
-};
-static const size_t CrossMAX = static_cast<size_t>(Cross::T_OWN_GOALBOX_RIGHT) +
-                               1;
-
-
-/* also used in linemathing */
-enum class Pole {
-    OPP_LEFT,
-    OPP_RIGHT,
-    OWN_LEFT,
-    OWN_RIGHT
-};
-static const size_t PoleMAX = static_cast<size_t>(Pole::OWN_RIGHT) + 1;
 
 /* given a wcs position, this calculates
  * a distance, angle and type to a Landmark,
@@ -113,12 +34,28 @@ struct LandmarkOrientation {
     int landmark;
 };
 
+// bits of the type mask of the batched getDistsAndAngles,
+// bit n selects LandmarkOrientation::landmark == n
+enum LandmarkMask {
+    LANDMARK_LCROSS = 1 << 0,
+    LANDMARK_TCROSS = 1 << 1,
+    LANDMARK_XCROSS = 1 << 2,
+    LANDMARK_POLE = 1 << 3,
+    LANDMARK_ALL = LANDMARK_LCROSS | LANDMARK_TCROSS | LANDMARK_XCROSS | LANDMARK_POLE
+};
+
+// the landmarks of one type mask in SoA form, crosses first, then poles
+struct LandmarkBatch {
+    PointBatch points;
+    std::vector<int> landmark; // LandmarkOrientation::landmark of every point
+};
+
 struct LandmarkCross {
     Cross name; // enum "NAME" of the cross
     float wcs_x; // wcs pose in m
     float wcs_y;
     float wcs_alpha; // wcs angle in rad
-    std::vector<float> equation; // wcs pose in homogenus vector form (x,y,1)
+    Vec3f equation; // wcs pose in homogenus vector form (x,y,1)
     int degree; /// 2=L,3=T,4=X
     std::vector<float>
     distances; // in this vector all distances to other crosses are stored, the index of the vector is equal to the enum name
@@ -131,10 +68,8 @@ struct LandmarkLine {
     float end_x; // endpoint
     float end_y;
     /* float wcs_alpha; // rad */
-    std::vector<float>
-    equation; /// line equation as vector of (a,b,c) from the lineequation a*x+b*y+c=0 in hnf!
-    std::vector<float>
-    equationNormal; /// line equation as vector of (a,b,c) from the lineequation a*x+b*y+c=0
+    Line2f equation; /// line equation (a,b,c) of a*x+b*y+c=0 in hnf!
+    Line2f equationNormal; /// line equation (a,b,c) of a*x+b*y+c=0
 };
 
 
@@ -144,7 +79,7 @@ struct LandmarkPole {
     float wcs_y;
     float wcs_width; // m
     float wcs_height;
-    std::vector<float> equation; // wcs pose in homogenius vector form (x,y,1)
+    Vec3f equation; // wcs pose in homogenius vector form (x,y,1)
     int color; // should be same enum as from jsvision ...
 };
 
@@ -164,9 +99,16 @@ struct LandmarkCenterCircle {
 
 class PlayingField {
 public:
+    // use the compile time generated landmark table of a built-in field
     PlayingField(FieldSize fieldSize);
+    // generate the landmarks at runtime from custom measurements,
+    // fieldSize only selects the set of positions (see getManualSetPose)
+    PlayingField(const FieldMeasurements &fm, FieldSize fieldSize = FieldSize::SPL);
     ~PlayingField();
 
+    // plain landmark tables, use these in per particle loops
+    inline const FieldModel &model() const { return *_model; }
+
     std::vector<LandmarkCross> getCrosses(const int &degree) const;
     LandmarkCross getCross(const Cross name) const;
     std::vector<LandmarkLine> getLines() const;
@@ -275,7 +217,23 @@ public:
      * 3: poles (4x)
      */
     std::vector<LandmarkOrientation> getDistsAndAngles(const DirectedCoord &from,
-            int type=-1);
+            int type=-1) const;
+
+    /**
+     * batched getDistsAndAngles for many poses (e.g. all particles), no
+     * allocation. the landmarks of the types in mask (LandmarkMask) are
+     * the columns, in the order of landmarkBatch(mask). dist and bearing
+     * (may be nullptr) get poses.size() x landmarkBatch(mask).points.size()
+     * floats, row major [pose][landmark].
+     * returns the number of landmarks per pose.
+     */
+    size_t getDistsAndAngles(const PoseBatch &poses, int mask, float *dist,
+                             float *bearing) const;
+
+    // the landmarks of a type mask, built once with the field
+    inline const LandmarkBatch &landmarkBatch(int mask) const {
+        return _landmarkBatches[mask & LANDMARK_ALL];
+    }
 
 
     DirectedCoord kick_off_position(bool has_kickoff);
@@ -303,89 +261,20 @@ public:
     inline float getAbsoluteLength() const { return _length; }
 
 private:
-    /** struct for field measurements used by createField()
-     * all dimensions are in meter, default values correspond
-     * to current SPL rules
-     */
-    struct FieldMeasurements {
-        float fieldLength{9.f};
-        float fieldWidth{6.f};
-        float centerCircleDiameter{1.5f};
-        float penaltyCrossDistance{1.3f};
-        float penaltyAreaLength{0.6f};
-        float penaltyAreaWidth{2.2f};
-        float goalWidth{1.5f};
-        float goalPostDiameter{0.1f};
-        float goalboxDepth{0.5f};
-        float goalPostHeight{0.8f};
-        float borderStripWidth{0.7f};
-        float penaltyCrossSize{0.1f};
-        float lineWidth{0.05f};
-    };
-
+    // points to a constexpr preset table or to _customModel
+    const FieldModel *_model;
+    std::shared_ptr<const FieldModel> _customModel;
+    std::array<LandmarkBatch, LANDMARK_ALL + 1> _landmarkBatches; // by mask
 
     /**
-     * create playingfield lines, crosses, etc.
+     * create playingfield lines, crosses, etc. for custom measurements
      */
     void createField(const FieldMeasurements &fm);
 
-    /** creates line equations all in wcs coords (m)
-     * @param angle of line rad
-     * @param starX startpoint x
-     * @param startY || y
-     * @param endX endpoint x
-     * @param end Y || y
-     * @param lineType name of line from enum Line
-     */
-    void createNewLineDefinition(
-        const float alpha,
-        const float startX,
-        const float startY,
-        const float endX,
-        const float endY,
-        const Line lineType);
-
-
-
-    /** creates Corner/Crosses of wcs in m
-     * @param x coord
-     * @param y coord
-     * @param alpha rad
-     * @param degree type 2,3,4 (L,T,X)
-     * @param crossType name enum Cross
-     */
-    void createNewCrossDefinition(const float x,
-                                  const float y,
-                                  const float alpha,
-                                  const int degree,
-                                  const Cross crossType);
-
-    /** creates Poles in WCS (m)
-     * @param x coord
-     * @param y cooed
-     * @param height of pole
-     * @param width of pole
-     * @param color enum from vision
-     * @param poleType enum Pole
+    /**
+     * set the landmark table and fill the members above from it
      */
-    LandmarkPole createNewPoleDefinition(const float x,
-                                         const float y,
-                                         const float height,
-                                         const float width,
-                                         const int color,
-                                         const Pole poleType);
-
-    /** creates Goals in WCS (m)
-     * @param left Pole
-     * @param right Pole
-     * @param poleDistance (m)
-     * @param opponent 0=own;1=opponent
-     * */
-    void createNewGoalDefinition(const LandmarkPole &left,
-                                 const LandmarkPole &right,
-                                 const float poleDistance,
-                                 const bool opponent);
-
+    void loadModel(const FieldModel &model);
 
     /**
      * creates a vector for all crosses where all distances to all crosses are included (also the own, which schould be 0)
@@ -393,6 +282,11 @@ private:
      */
     void createDistVecOfCrosses();
 
+    /**
+     * fill _landmarkBatches from _crosses and _poles
+     */
+    void initLandmarkBatches();
+
 };
 
 // vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,121 @@
+#include "profiling.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+const char *stageName(FilterStage stage) {
+    switch (stage) {
+    case FilterStage::UPDATE:
+        return "update";
+    case FilterStage::MOVE:
+        return "moveParticles";
+    case FilterStage::MEASUREMENT:
+        return "measurementModel";
+    case FilterStage::NORMALIZE:
+        return "normalize";
+    case FilterStage::RESAMPLE:
+        return "resample";
+    case FilterStage::POSE:
+        return "calculatePose";
+    case FilterStage::HYPOS:
+        return "adjustWithHypos";
+    case FilterStage::GLOBAL:
+        return "globalLocalisation";
+    default:
+        return "unknown";
+    }
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::reset() {
+    _buckets.fill(0);
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+}
+
+// values below SUB_BUCKETS get their own bucket,
+// above that: exponent * SUB_BUCKETS + the next SUB_BITS bits of the mantissa
+int LatencyHistogram::bucketOf(uint64_t ns) {
+    if (ns < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<int>(ns);
+    }
+    const int msb = 63 - __builtin_clzll(ns);
+    const int sub = static_cast<int>((ns >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+    const int bucket = (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    return std::min(bucket, BUCKETS - 1);
+}
+
+nanoTime LatencyHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const int msb = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    const int sub = bucket % SUB_BUCKETS;
+    const uint64_t lower = (static_cast<uint64_t>(SUB_BUCKETS + sub)) << (msb - SUB_BITS);
+    return static_cast<nanoTime>(lower + (1ULL << (msb - SUB_BITS)) - 1);
+}
+
+void LatencyHistogram::add(nanoTime ns) {
+    if (ns < 0) {
+        ns = 0;
+    }
+    ++_buckets[bucketOf(static_cast<uint64_t>(ns))];
+    ++_count;
+    _sum += ns;
+    _max = std::max(_max, ns);
+}
+
+nanoTime LatencyHistogram::mean() const {
+    return (_count > 0) ? _sum / static_cast<nanoTime>(_count) : 0;
+}
+
+nanoTime LatencyHistogram::percentile(float p) const {
+    if (_count == 0) {
+        return 0;
+    }
+    p = std::max(0.0f, std::min(1.0f, p));
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<float>(_count));
+    rank = std::max<uint64_t>(1, std::min(rank, _count));
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), _max);
+        }
+    }
+    return _max;
+}
+
+StageStats StageProfiler::stats(FilterStage stage) const {
+    const LatencyHistogram &h = histogram(stage);
+    return {h.count(), h.percentile(0.5f), h.percentile(0.99f), h.max(), h.mean()};
+}
+
+void StageProfiler::reset() {
+    for (auto &h: _stages) {
+        h.reset();
+    }
+}
+
+std::ostream &operator<<(std::ostream &s, const StageProfiler &p) {
+    s << std::left << std::setw(18) << "stage" << std::right
+      << std::setw(8) << "count" << std::setw(10) << "p50(us)"
+      << std::setw(10) << "p99(us)" << std::setw(10) << "max(us)" << "\n";
+    for (size_t i = 0; i < FilterStageMAX; ++i) {
+        const FilterStage stage = static_cast<FilterStage>(i);
+        const StageStats st = p.stats(stage);
+        s << std::left << std::setw(18) << stageName(stage) << std::right
+          << std::setw(8) << st.count << std::fixed << std::setprecision(1)
+          << std::setw(10) << st.p50 / 1000.0 << std::setw(10) << st.p99 / 1000.0
+          << std::setw(10) << st.max / 1000.0 << "\n";
+        s.unsetf(std::ios_base::floatfield);
+    }
+    return s;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,118 @@
+/**
+ * low overhead per stage timing of the particle filter
+ *
+ * every stage of ParticleFilter::update is measured with the monotonic
+ * clock and sorted into a fixed size latency histogram (no allocation,
+ * ~12% bucket resolution), p50/p99/max can be read at any time.
+ * the timers are only compiled in with PF_PROFILING defined, otherwise
+ * PF_PROFILE_STAGE expands to nothing and the filter has no profiler.
+ */
+#pragma once
+
+#include <types.h>
+#include <platform.h>
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+
+enum class FilterStage {
+    UPDATE, // complete update() call
+    MOVE, // moveParticles
+    MEASUREMENT, // measurementModel
+    NORMALIZE, // normalizeParticle
+    RESAMPLE, // lowVarianzeResample
+    POSE, // calculatePose
+    HYPOS, // adjustParticlesWithLandmarkHypos
+    GLOBAL, // globalLocalisation
+    COUNT
+};
+
+static const size_t FilterStageMAX = static_cast<size_t>(FilterStage::COUNT);
+
+const char *stageName(FilterStage stage);
+
+/** log-linear histogram of durations (ns)
+ *  8 sub buckets per power of two, covers 1ns ... 2^46ns (~19h),
+ *  longer durations are counted in the last bucket
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void add(nanoTime ns);
+    void reset();
+
+    uint64_t count() const { return _count; }
+    nanoTime max() const { return _max; }
+    nanoTime mean() const;
+    // upper bound of the bucket containing the p-th percentile, p = [0 ... 1]
+    nanoTime percentile(float p) const;
+
+private:
+    static const int SUB_BITS = 3;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int BUCKETS = 44 * SUB_BUCKETS;
+
+    static int bucketOf(uint64_t ns);
+    static nanoTime bucketUpperBound(int bucket);
+
+    std::array<uint32_t, BUCKETS> _buckets;
+    uint64_t _count;
+    nanoTime _sum;
+    nanoTime _max;
+};
+
+struct StageStats {
+    uint64_t count;
+    nanoTime p50;
+    nanoTime p99;
+    nanoTime max;
+    nanoTime mean;
+};
+
+class StageProfiler {
+public:
+    inline void record(FilterStage stage, nanoTime ns) {
+        _stages[static_cast<size_t>(stage)].add(ns);
+    }
+
+    StageStats stats(FilterStage stage) const;
+    const LatencyHistogram &histogram(FilterStage stage) const {
+        return _stages[static_cast<size_t>(stage)];
+    }
+    void reset();
+
+private:
+    std::array<LatencyHistogram, FilterStageMAX> _stages;
+};
+
+// prints one line per stage: name count p50 p99 max (in us)
+std::ostream &operator<<(std::ostream &s, const StageProfiler &p);
+
+// measures the lifetime of the object and records it for 'stage'
+class ScopedStageTimer {
+public:
+    inline ScopedStageTimer(StageProfiler &profiler, FilterStage stage)
+        : _profiler(profiler), _stage(stage), _start(getMonotonicNanoTime()) {}
+    inline ~ScopedStageTimer() {
+        _profiler.record(_stage, getMonotonicNanoTime() - _start);
+    }
+
+private:
+    StageProfiler &_profiler;
+    FilterStage _stage;
+    nanoTime _start;
+};
+
+#define PF_PROFILE_CONCAT_(a, b) a##b
+#define PF_PROFILE_CONCAT(a, b) PF_PROFILE_CONCAT_(a, b)
+
+#ifdef PF_PROFILING
+#define PF_PROFILE_STAGE(profiler, stage) \
+    ScopedStageTimer PF_PROFILE_CONCAT(_pf_stage_timer_, __LINE__)(profiler, stage)
+#else
+#define PF_PROFILE_STAGE(profiler, stage)
+#endif
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,84 @@
+#include "simd.h"
+
+#include <cstdlib>
+#include <string_view>
+
+#include "logsink.h"
+
+namespace {
+
+const SimdLevel LEVELS[] = {SimdLevel::GENERIC, SimdLevel::SSE4, SimdLevel::AVX2,
+                            SimdLevel::AVX512};
+
+SimdLevel bestSupported() {
+    SimdLevel best = SimdLevel::GENERIC;
+    for (SimdLevel level: LEVELS) {
+        if (simdSupported(level)) {
+            best = level;
+        }
+    }
+    return best;
+}
+
+SimdLevel selectLevel() {
+    const SimdLevel best = bestSupported();
+    const char *env = getenv("PF_SIMD_LEVEL");
+    if (!env) {
+        return best;
+    }
+    for (SimdLevel level: LEVELS) {
+        if (std::string_view(env) == simdLevelName(level)) {
+            if (simdSupported(level)) {
+                return level;
+            }
+            PF_LOG(LogLevel::WARNING) << "PF_SIMD_LEVEL=" << env
+                                      << " is not supported by this cpu, using "
+                                      << simdLevelName(best);
+            return best;
+        }
+    }
+    PF_LOG(LogLevel::WARNING) << "unknown PF_SIMD_LEVEL=" << env << ", using "
+                              << simdLevelName(best);
+    return best;
+}
+
+}
+
+bool simdSupported(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::GENERIC:
+        return true;
+#ifdef PF_SIMD_X86
+    case SimdLevel::SSE4:
+        return __builtin_cpu_supports("sse4.2");
+    case SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SimdLevel::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+               && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw");
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdLevel simdLevel() {
+    static const SimdLevel level = selectLevel();
+    return level;
+}
+
+const char *simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::GENERIC:
+        return "generic";
+    case SimdLevel::SSE4:
+        return "sse4";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
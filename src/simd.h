@@ -0,0 +1,52 @@
+/**
+ * runtime selection of the instruction set for the vectorized kernels
+ *
+ * the robots and the evaluation servers have different cpus, one build
+ * runs on both: a hot kernel is compiled once per level (PF_TARGET_*
+ * attributes) and the version of the active level is picked from a table
+ * on first use:
+ *
+ *   PF_TARGET_AVX2 void kernelAvx2(...) { kernelBody(...); }
+ *   static const Kernel table[] = {kernelGeneric, kernelSse4, kernelAvx2, ...};
+ *   simdSelect(table)(...);
+ *
+ * the active level is the best one the cpu supports, the environment
+ * variable PF_SIMD_LEVEL=generic|sse4|avx2|avx512 forces a lower one
+ * (benchmarks). generic is the portable code of the build target, it is
+ * always there and the only level on non x86 targets.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+enum class SimdLevel {
+    GENERIC,
+    SSE4,
+    AVX2,
+    AVX512
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PF_SIMD_X86 1
+#define PF_TARGET_SSE4 __attribute__((target("sse4.2")))
+#define PF_TARGET_AVX2 __attribute__((target("avx2")))
+#define PF_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw")))
+#endif
+
+// true if the cpu (and os) can run code of this level
+bool simdSupported(SimdLevel level);
+
+// the active level, selected once
+SimdLevel simdLevel();
+
+const char *simdLevelName(SimdLevel level);
+
+// the entry of the active level in a table indexed by SimdLevel, tables
+// which end early use their last entry for the levels above
+template<typename T, size_t N>
+const T &simdSelect(const T (&table)[N]) {
+    return table[std::min(static_cast<size_t>(simdLevel()), N - 1)];
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <charconv>
+#include <ostream>
+#include <string_view>
+#include <system_error>
+
+/**
+ * result of the text record parsers (VisionResult::parse, Robot::parse).
+ * on error 'field' names the field which could not be read and
+ * 'position' is its offset in the input.
+ */
+struct ParseResult {
+    enum Code {
+        OK,
+        MISSING_FIELD, ///< separator or key not found
+        INVALID_NUMBER ///< field is not a number or out of range
+    };
+
+    Code code = OK;
+    const char *field = "";
+    size_t position = 0;
+
+    explicit operator bool() const {
+        return code == OK;
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &s, const ParseResult &r) {
+    static const char *names[] = {"ok", "missing field", "invalid number"};
+    s << names[r.code];
+    if (r.code != ParseResult::OK) {
+        s << " '" << r.field << "' at " << r.position;
+    }
+    return s;
+}
+
+namespace textparse {
+
+/**
+ * reads a text record from left to right without copying. after the first
+ * error all further calls are ignored and result() reports that error:
+ *
+ *   Scanner in(s);
+ *   in.after("x=", "x").read("x", x).expect(";", "y").read("y", y);
+ *   if (!in.result()) ...
+ */
+class Scanner {
+public:
+    explicit Scanner(std::string_view s) : begin(s.data()), rest(s) {}
+
+    // skips everything up to and including the next 'token'
+    Scanner &after(std::string_view token, const char *field) {
+        if (ok()) {
+            size_t p = rest.find(token);
+            if (p == std::string_view::npos) {
+                return fail(ParseResult::MISSING_FIELD, field);
+            }
+            rest.remove_prefix(p + token.size());
+        }
+        return *this;
+    }
+
+    // 'token' must follow directly
+    Scanner &expect(std::string_view token, const char *field) {
+        if (ok()) {
+            if (rest.substr(0, token.size()) != token) {
+                return fail(ParseResult::MISSING_FIELD, field);
+            }
+            rest.remove_prefix(token.size());
+        }
+        return *this;
+    }
+
+    // int or float, same syntax as printed by operator<<
+    template<typename T>
+    Scanner &read(const char *field, T &value) {
+        if (ok()) {
+            T v;
+            auto r = std::from_chars(rest.data(), rest.data() + rest.size(), v);
+            if (r.ec != std::errc()) {
+                return fail(ParseResult::INVALID_NUMBER, field);
+            }
+            value = v;
+            rest.remove_prefix(r.ptr - rest.data());
+        }
+        return *this;
+    }
+
+    // true if 'token' follows directly (without consuming it)
+    bool next(std::string_view token) const {
+        return ok() && rest.substr(0, token.size()) == token;
+    }
+
+    bool ok() const {
+        return status.code == ParseResult::OK;
+    }
+
+    const ParseResult &result() const {
+        return status;
+    }
+
+private:
+    const char *begin;
+    std::string_view rest;
+    ParseResult status;
+
+    Scanner &fail(ParseResult::Code code, const char *field) {
+        status.code = code;
+        status.field = field;
+        status.position = static_cast<size_t>(rest.data() - begin);
+        return *this;
+    }
+};
+
+} // namespace textparse
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstdint>
 
 
 // type to keep unix stamp in microseconds
@@ -8,6 +9,9 @@ typedef int64_t microTime;
 // type to keep unix stamp in milliseconds
 typedef int32_t TimestampMs;
 
+// type to keep monotonic clock stamps/durations in nanoseconds
+typedef int64_t nanoTime;
+
 
 enum class FieldSize {
     JRL,
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <textparse.h>
+
 #include <iosfwd>
+#include <string>
+#include <string_view>
 
 #undef ENUM_NAME
 #undef ENUM_LIST
@@ -54,9 +58,16 @@ public:
 
     /**
      * create jsvisionresult from string.
+     * fields which can not be parsed keep their default value, see parse().
      */
     explicit VisionResult(const std::string &vals);
 
+    /**
+     * parse the ';' separated fields written by operator<<.
+     * fields are stored until the first error, which is returned.
+     */
+    static ParseResult parse(std::string_view vals, VisionResult &r);
+
     VisionClass type; ///< type of vision result
     int timestamp; ///< Timestamp for this vision result
 
@@ -0,0 +1,62 @@
+#include "workerpool.h"
+
+WorkerPool::WorkerPool(size_t threads) :
+    _stop(false), _generation(0), _busy(0), _task(nullptr), _tasks(0), _next(0) {
+    for (size_t t = 0; t < threads; ++t) {
+        _threads.emplace_back(&WorkerPool::loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+    for (auto &thread: _threads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(size_t tasks, const std::function<void(size_t)> &task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _tasks = tasks;
+        _next.store(0, std::memory_order_relaxed);
+        _busy = _threads.size();
+        ++_generation;
+    }
+    _start.notify_all();
+    work();
+    // the workers may still run the last tasks (and read 'task')
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busy == 0; });
+    _task = nullptr;
+}
+
+void WorkerPool::work() {
+    for (size_t t = _next.fetch_add(1); t < _tasks; t = _next.fetch_add(1)) {
+        (*_task)(t);
+    }
+}
+
+void WorkerPool::loop() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _start.wait(lock, [&] { return _stop || _generation != seen; });
+        if (_stop) {
+            return;
+        }
+        seen = _generation;
+        lock.unlock();
+        work();
+        lock.lock();
+        if (--_busy == 0) {
+            _done.notify_one();
+        }
+    }
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
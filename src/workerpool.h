@@ -0,0 +1,57 @@
+/**
+ * fixed set of threads for data parallel loops in the filter
+ *
+ * the threads are started once and sleep between the calls of run(), so
+ * a parallel loop costs a wakeup instead of a thread start:
+ *
+ *   WorkerPool pool(3); // 3 threads + the caller
+ *   pool.run(chunks, [&](size_t chunk) { ... });
+ *
+ * run() is not reentrant, one thread calls it at a time.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    // 'threads' workers besides the calling thread, 0 runs everything in run()
+    explicit WorkerPool(size_t threads);
+    // stops and joins the workers
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // threads that take part in run(), the caller included
+    size_t size() const {
+        return _threads.size() + 1;
+    }
+
+    // task(0) ... task(tasks - 1) on the workers and the calling thread,
+    // returns when all are done
+    void run(size_t tasks, const std::function<void(size_t)> &task);
+
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _start, _done;
+    bool _stop;
+    uint64_t _generation; // counts the calls of run()
+    size_t _busy; // workers still in the current run
+    const std::function<void(size_t)> *_task;
+    size_t _tasks;
+    std::atomic<size_t> _next; // next task to take
+
+    void work();
+    void loop();
+};
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
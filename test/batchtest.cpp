@@ -0,0 +1,336 @@
+/**
+ * randomized check of the batched kernels against the scalar code they
+ * replace, on the active SimdLevel (set PF_SIMD_LEVEL to check another).
+ *
+ * usage: particlefilterbatchtest [--seed 1]
+ *
+ * with PF_SIMD_LEVEL set to a level this cpu can not run, the check is
+ * skipped (exit code 77).
+ *
+ * the point and pose counts cover the vector tails and more than one
+ * scratch row, the buffers start at unaligned offsets.
+ */
+#include <batchtransform.h>
+#include <coords.h>
+#include <playingfield.h>
+#include <simd.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// collects the mismatches of all checks, prints the first few
+class Checker {
+public:
+    void expectNear(float actual, float expected, float tolerance, const string &what) {
+        ++checked;
+        if (fabsf(actual - expected) <= tolerance) {
+            return;
+        }
+        fail(what, actual, expected);
+    }
+
+    void expectEqual(long actual, long expected, const string &what) {
+        ++checked;
+        if (actual == expected) {
+            return;
+        }
+        fail(what, actual, expected);
+    }
+
+    // angles in rad, compared modulo 2 pi
+    void expectNearAngle(float actual, float expected, float tolerance, const string &what) {
+        ++checked;
+        if (fabsf(Angle(actual - expected).rad) <= tolerance) {
+            return;
+        }
+        fail(what, actual, expected);
+    }
+
+    size_t checked = 0;
+    size_t failed = 0;
+
+private:
+    void fail(const string &what, float actual, float expected) {
+        if (++failed <= 10) {
+            cout << "mismatch " << what << ": " << actual << " expected " << expected << "\n";
+        }
+    }
+};
+
+// the kernels work in float, the scalar code uses hypotf/atan2f/cosf
+const float POSITION_TOLERANCE = 2e-5f; // m, coordinates up to ~10 m
+const float ANGLE_TOLERANCE = 2e-6f; // rad
+
+const size_t COUNTS[] = {1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 33, 63, 64, 65, 130};
+
+float uniform(mt19937 &rng, float lo, float hi) {
+    return uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+DirectedCoord randomPose(mt19937 &rng) {
+    return DirectedCoord(uniform(rng, -5.0f, 5.0f), uniform(rng, -3.5f, 3.5f),
+                         uniform(rng, -M_PI_F, M_PI_F));
+}
+
+// SoA copies starting 'offset' floats into their buffers
+struct Poses {
+    Poses(const vector<DirectedCoord> &poses, size_t offset) : offset(offset) {
+        for (auto *v: {&x, &y, &theta, &c, &s}) {
+            v->assign(offset, 0.0f);
+        }
+        for (const auto &p: poses) {
+            x.push_back(p.coord.x);
+            y.push_back(p.coord.y);
+            theta.push_back(p.angle.rad);
+            c.push_back(cosf(p.angle.rad));
+            s.push_back(sinf(p.angle.rad));
+        }
+    }
+
+    size_t offset;
+    vector<float> x, y, theta, c, s;
+};
+
+// transformToRCS against DirectedCoord::toRCS, Coord::dist and Coord::direction
+void checkTransform(mt19937 &rng, Checker &check) {
+    for (size_t numPoses: {1, 3, 5}) {
+        for (size_t numPoints: COUNTS) {
+            const size_t offset = numPoints % 4;
+            vector<DirectedCoord> poses;
+            for (size_t i = 0; i < numPoses; ++i) {
+                poses.push_back(randomPose(rng));
+            }
+            vector<float> pointX(offset), pointY(offset);
+            for (size_t j = 0; j < numPoints; ++j) {
+                pointX.push_back(uniform(rng, -5.0f, 5.0f));
+                pointY.push_back(uniform(rng, -3.5f, 3.5f));
+            }
+            const Poses p(poses, offset);
+            const size_t n = numPoses * numPoints;
+            vector<float> rcsX(n + offset), rcsY(n + offset), dist(n + offset),
+                          bearing(n + offset), dist2(n + offset), bearing2(n + offset);
+            transformToRCS(p.x.data() + offset, p.y.data() + offset, p.c.data() + offset,
+                           p.s.data() + offset, numPoses, pointX.data() + offset,
+                           pointY.data() + offset, numPoints, rcsX.data() + offset,
+                           rcsY.data() + offset, dist.data() + offset, bearing.data() + offset);
+            // without x/y outputs (scratch rows)
+            transformToRCS(p.x.data() + offset, p.y.data() + offset, p.c.data() + offset,
+                           p.s.data() + offset, numPoses, pointX.data() + offset,
+                           pointY.data() + offset, numPoints, nullptr, nullptr,
+                           dist2.data() + offset, bearing2.data() + offset);
+
+            const string what = "transformToRCS " + to_string(numPoses) + "x"
+                                + to_string(numPoints);
+            for (size_t i = 0; i < numPoses; ++i) {
+                for (size_t j = 0; j < numPoints; ++j) {
+                    const size_t k = offset + i * numPoints + j;
+                    const Coord point(pointX[offset + j], pointY[offset + j]);
+                    const Coord rcs = DirectedCoord(point, Angle(0.0f)).toRCS(poses[i]).coord;
+                    check.expectNear(rcsX[k], rcs.x, POSITION_TOLERANCE, what + " x");
+                    check.expectNear(rcsY[k], rcs.y, POSITION_TOLERANCE, what + " y");
+                    check.expectNear(dist[k], rcs.dist(), POSITION_TOLERANCE, what + " dist");
+                    check.expectNear(dist2[k], dist[k], 0.0f, what + " dist without xy");
+                    if (rcs.dist() > 1e-3f) {
+                        check.expectNearAngle(bearing[k], rcs.direction(), ANGLE_TOLERANCE,
+                                              what + " bearing");
+                    }
+                    check.expectNear(bearing2[k], bearing[k], 0.0f, what + " bearing without xy");
+                }
+            }
+        }
+    }
+}
+
+// segmentsToRCS in both modes against Coord::closestPointOnLine and the
+// scalar transform, random segments (one point-like) and the field lines
+void checkSegments(mt19937 &rng, Checker &check) {
+    // segments with their end points
+    vector<pair<SegmentBatch, vector<pair<Coord, Coord>>>> sets;
+    for (size_t numSegments: COUNTS) {
+        sets.emplace_back();
+        for (size_t j = 0; j < numSegments; ++j) {
+            const Coord start(uniform(rng, -5.0f, 5.0f), uniform(rng, -3.5f, 3.5f));
+            const Coord end = (j == 1) ? start
+                              : Coord(uniform(rng, -5.0f, 5.0f), uniform(rng, -3.5f, 3.5f));
+            sets.back().first.push_back(start, end);
+            sets.back().second.push_back({start, end});
+        }
+    }
+    // with the stored hesse normal forms
+    PlayingField field(FieldSize::JRL);
+    sets.emplace_back();
+    for (const auto &l: field.model().lines) {
+        const Coord start(l.start_x, l.start_y), end(l.end_x, l.end_y);
+        sets.back().first.push_back(start, end, l.equation);
+        sets.back().second.push_back({start, end});
+    }
+
+    for (const auto &set: sets) {
+        const SegmentBatch &segments = set.first;
+        const vector<pair<Coord, Coord>> &ends = set.second;
+        const size_t numSegments = segments.size();
+        const size_t numPoses = 3;
+        vector<DirectedCoord> poses;
+        for (size_t i = 0; i < numPoses; ++i) {
+            poses.push_back(randomPose(rng));
+        }
+        const size_t offset = numSegments % 4;
+        const Poses p(poses, offset);
+        const size_t n = numPoses * numSegments;
+
+        for (SegmentMode mode: {SegmentMode::CLAMPED, SegmentMode::INFINITE_LINE}) {
+            const bool clamped = (mode == SegmentMode::CLAMPED);
+            vector<float> rcsX(n + offset), rcsY(n + offset), dist(n + offset),
+                          bearing(n + offset), orientation(n + offset);
+            segmentsToRCS(p.x.data() + offset, p.y.data() + offset, p.theta.data() + offset,
+                          p.c.data() + offset, p.s.data() + offset, numPoses, segments, mode,
+                          rcsX.data() + offset, rcsY.data() + offset, dist.data() + offset,
+                          bearing.data() + offset, orientation.data() + offset);
+
+            const string what = string("segmentsToRCS ") + (clamped ? "clamped " : "line ")
+                                + to_string(numSegments);
+            for (size_t i = 0; i < numPoses; ++i) {
+                for (size_t j = 0; j < numSegments; ++j) {
+                    const size_t k = offset + i * numSegments + j;
+                    const Coord &start = ends[j].first;
+                    const Coord &end = ends[j].second;
+                    const Coord closest = poses[i].coord.closestPointOnLine(start, end, clamped);
+                    const Coord rcs = DirectedCoord(closest, Angle(0.0f)).toRCS(poses[i]).coord;
+                    check.expectNear(rcsX[k], rcs.x, POSITION_TOLERANCE, what + " x");
+                    check.expectNear(rcsY[k], rcs.y, POSITION_TOLERANCE, what + " y");
+                    check.expectNear(dist[k], rcs.dist(), POSITION_TOLERANCE, what + " dist");
+                    if (rcs.dist() > 1e-2f) {
+                        check.expectNearAngle(bearing[k], rcs.direction(), 1e-4f,
+                                              what + " bearing");
+                    }
+                    check.expectNear(orientation[k], (end - start).direction() - poses[i].angle.rad,
+                                     ANGLE_TOLERANCE, what + " orientation");
+                }
+            }
+        }
+    }
+}
+
+// PlayingField::getDistsAndAngles: the single pose call against the
+// scalar transform of the field model landmarks (per type and all), the
+// batched call for every LandmarkMask against the single pose call
+void checkLandmarks(mt19937 &rng, Checker &check) {
+    for (FieldSize size: {FieldSize::JRL, FieldSize::SPL}) {
+        PlayingField field(size);
+        // the landmarks in the documented order: crosses, then poles
+        vector<pair<int, Coord>> landmarks;
+        for (const auto &c: field.model().crosses) {
+            landmarks.push_back({c.degree - 2, Coord(c.wcs_x, c.wcs_y)});
+        }
+        for (const auto &p: field.model().poles) {
+            landmarks.push_back({3, Coord(p.wcs_x, p.wcs_y)});
+        }
+
+        const size_t numPoses = 5;
+        vector<DirectedCoord> poses;
+        PoseBatch batch;
+        for (size_t i = 0; i < numPoses; ++i) {
+            poses.push_back(randomPose(rng));
+            batch.push_back(poses.back());
+        }
+
+        for (size_t i = 0; i < numPoses; ++i) {
+            for (int type = -1; type <= 3; ++type) {
+                const string what = "getDistsAndAngles type " + to_string(type);
+                const vector<LandmarkOrientation> single = field.getDistsAndAngles(poses[i], type);
+                size_t k = 0;
+                for (const auto &l: landmarks) {
+                    if (type >= 0 && l.first != type) {
+                        continue;
+                    }
+                    if (k >= single.size() || single[k].landmark != l.first) {
+                        check.expectEqual(k < single.size() ? single[k].landmark : -1, l.first,
+                                          what + " landmark");
+                        break;
+                    }
+                    const Coord rcs = DirectedCoord(l.second, Angle(0.0f)).toRCS(poses[i]).coord;
+                    check.expectNear(single[k].rcs_dist, rcs.dist(), POSITION_TOLERANCE,
+                                     what + " dist");
+                    if (rcs.dist() > 1e-3f) {
+                        check.expectNearAngle(single[k].rcs_angle, rcs.direction(),
+                                              ANGLE_TOLERANCE, what + " bearing");
+                    }
+                    ++k;
+                }
+                check.expectEqual(single.size(), k, what + " count");
+            }
+        }
+
+        for (int mask = 1; mask <= LANDMARK_ALL; ++mask) {
+            const string what = "batched getDistsAndAngles mask " + to_string(mask);
+            const size_t n = field.landmarkBatch(mask).points.size();
+            vector<float> dist(numPoses * n), bearing(numPoses * n);
+            const size_t columns = field.getDistsAndAngles(batch, mask, dist.data(),
+                                                           bearing.data());
+            check.expectEqual(columns, n, what + " count");
+            for (size_t i = 0; i < numPoses; ++i) {
+                size_t j = 0;
+                for (const auto &l: field.getDistsAndAngles(poses[i])) {
+                    if (!(mask & (1 << l.landmark))) {
+                        continue;
+                    }
+                    if (j >= n || field.landmarkBatch(mask).landmark[j] != l.landmark) {
+                        check.expectEqual(j < n ? field.landmarkBatch(mask).landmark[j] : -1,
+                                          l.landmark, what + " landmark");
+                        break;
+                    }
+                    check.expectNear(dist[i * n + j], l.rcs_dist, 1e-6f, what + " dist");
+                    check.expectNearAngle(bearing[i * n + j], l.rcs_angle, 1e-6f,
+                                          what + " bearing");
+                    ++j;
+                }
+                check.expectEqual(j, n, what + " columns");
+            }
+        }
+    }
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    unsigned int seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned int>(atoi(argv[++i]));
+        } else {
+            cerr << "unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+    const char *forcedLevel = getenv("PF_SIMD_LEVEL");
+    if (forcedLevel && string(forcedLevel) != simdLevelName(simdLevel())) {
+        cout << "SKIP: PF_SIMD_LEVEL=" << forcedLevel << " is not supported here" << "\n";
+        return 77;
+    }
+    mt19937 rng(seed);
+    Checker check;
+    checkTransform(rng, check);
+    checkSegments(rng, check);
+    checkLandmarks(rng, check);
+
+    cout << "simd level:         " << simdLevelName(simdLevel()) << "\n";
+    cout << "checked:            " << check.checked << " values, " << check.failed
+         << " mismatches" << "\n";
+    if (check.failed > 0) {
+        cout << "FAIL" << "\n";
+        return 1;
+    }
+    cout << "PASS" << "\n";
+    return 0;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
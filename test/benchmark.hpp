@@ -0,0 +1,187 @@
+/**
+ * minimal self contained micro benchmark harness
+ *
+ * - benchmarks are registered with a name and a parameter pair
+ *   (particles, observations), the body runs 'iterations' times
+ * - the iteration count is raised until a run takes at least minTime,
+ *   the result is the median ns/op of several repetitions
+ * - results are written as json and can be compared against a json
+ *   baseline written by an earlier run
+ */
+#pragma once
+
+#include <platform.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// keep the compiler from optimizing away a result
+template <typename T>
+inline void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Params {
+    size_t particles;
+    size_t observations;
+};
+
+struct Result {
+    std::string name;
+    Params params;
+    uint64_t iterations;
+    double nsPerOp;
+};
+
+// body gets the number of iterations to run
+typedef std::function<void(uint64_t)> Body;
+// setup is called once per benchmark and parameter set, returns the body
+typedef std::function<Body(const Params &)> Setup;
+
+class Runner {
+public:
+    nanoTime minTime = 50 * 1000 * 1000; // ns per repetition
+    int repetitions = 5;
+    std::string filter;
+
+    void add(const std::string &name, const std::vector<Params> &params, Setup setup) {
+        for (const auto &p: params) {
+            entries.push_back({name, p, setup});
+        }
+    }
+
+    std::vector<Result> run() {
+        std::vector<Result> results;
+        for (auto &e: entries) {
+            if (!filter.empty() && e.name.find(filter) == std::string::npos) {
+                continue;
+            }
+            Body body = e.setup(e.params);
+            // warm up and find the iteration count
+            uint64_t iterations = 1;
+            for (;;) {
+                nanoTime t = timeIt(body, iterations);
+                if (t >= minTime || iterations >= (1ULL << 40)) {
+                    break;
+                }
+                uint64_t factor = (t > 0) ? std::min<uint64_t>(100, 1 + (minTime * 12 / 10) / t) : 100;
+                iterations *= std::max<uint64_t>(2, factor);
+            }
+            std::vector<double> perOp;
+            for (int r = 0; r < repetitions; ++r) {
+                perOp.push_back(static_cast<double>(timeIt(body, iterations)) / iterations);
+            }
+            std::sort(perOp.begin(), perOp.end());
+            Result res{e.name, e.params, iterations, perOp[perOp.size() / 2]};
+            std::cout << std::left << std::setw(44) << label(res) << std::right
+                      << std::setw(14) << std::fixed << std::setprecision(1)
+                      << res.nsPerOp << " ns/op" << std::endl;
+            results.push_back(res);
+        }
+        return results;
+    }
+
+    static std::string label(const Result &r) {
+        std::ostringstream s;
+        s << r.name << "/p" << r.params.particles << "/o" << r.params.observations;
+        return s.str();
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        Params params;
+        Setup setup;
+    };
+    std::vector<Entry> entries;
+
+    static nanoTime timeIt(Body &body, uint64_t iterations) {
+        nanoTime start = getMonotonicNanoTime();
+        body(iterations);
+        return getMonotonicNanoTime() - start;
+    }
+};
+
+inline void writeJson(std::ostream &out, const std::vector<Result> &results,
+                      const std::map<std::string, std::string> &context) {
+    out << "{\n  \"context\": {";
+    bool first = true;
+    for (const auto &c: context) {
+        out << (first ? "" : ",") << "\n    \"" << c.first << "\": \"" << c.second << "\"";
+        first = false;
+    }
+    out << "\n  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"particles\": "
+            << r.params.particles << ", \"observations\": " << r.params.observations
+            << ", \"iterations\": " << r.iterations << ", \"ns_per_op\": "
+            << std::fixed << std::setprecision(2) << r.nsPerOp << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// reads the benchmarks of a file written by writeJson, key is Runner::label
+inline std::map<std::string, double> readJson(const std::string &fn) {
+    std::map<std::string, double> ret;
+    std::ifstream in(fn);
+    auto field = [](const std::string &line, const std::string &key) -> std::string {
+        size_t p = line.find("\"" + key + "\": ");
+        if (p == std::string::npos) {
+            return "";
+        }
+        p += key.size() + 4;
+        if (line[p] == '"') {
+            return line.substr(p + 1, line.find('"', p + 1) - p - 1);
+        }
+        return line.substr(p, line.find_first_of(",}", p) - p);
+    };
+    for (std::string line; std::getline(in, line);) {
+        std::string name = field(line, "name");
+        if (name.empty()) {
+            continue;
+        }
+        Result r{name, {std::stoul(field(line, "particles")),
+                        std::stoul(field(line, "observations"))}, 0, 0.0};
+        ret[Runner::label(r)] = std::stod(field(line, "ns_per_op"));
+    }
+    return ret;
+}
+
+// prints the ratio current/baseline, returns the number of regressions
+// slower than 'tolerance' (e.g. 0.1 = 10%)
+inline int compare(const std::vector<Result> &results,
+                   const std::map<std::string, double> &baseline, double tolerance) {
+    int regressions = 0;
+    std::cout << std::left << std::setw(44) << "benchmark" << std::right
+              << std::setw(14) << "baseline" << std::setw(14) << "current"
+              << std::setw(10) << "ratio" << std::endl;
+    for (const auto &r: results) {
+        auto it = baseline.find(Runner::label(r));
+        if (it == baseline.end() || it->second <= 0.0) {
+            continue;
+        }
+        double ratio = r.nsPerOp / it->second;
+        bool regression = ratio > 1.0 + tolerance;
+        regressions += regression ? 1 : 0;
+        std::cout << std::left << std::setw(44) << Runner::label(r) << std::right
+                  << std::setw(14) << std::fixed << std::setprecision(1) << it->second
+                  << std::setw(14) << r.nsPerOp << std::setw(10) << std::setprecision(3)
+                  << ratio << (regression ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
+
+} // namespace bench
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,484 @@
+/**
+ * versioned binary log format, the text log (see logdataprocessor.hpp)
+ * as fixed size records which can be used directly from a memory mapping.
+ *
+ * file layout (little endian, all offsets in bytes from the file start):
+ *  - FileHeader
+ *  - per cognition step: a StepRecord followed by its sections, every
+ *    section is an array of fixed size records of one type
+ *  - step index: stepCount uint64 offsets of the StepRecords
+ *
+ * the writer streams, the header is patched when the log is closed. a
+ * file without index (stepTableOffset == 0, e.g. an aborted recording) can
+ * still be read by following StepRecord::size, up to the last step that is
+ * completely in the file.
+ */
+#pragma once
+
+#include <logdata.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "binary logs are stored in little endian byte order");
+
+namespace binlog {
+
+const char MAGIC[8] = {'P', 'F', 'L', 'O', 'G', 'B', 'I', 'N'};
+const uint32_t VERSION = 1;
+
+enum Section {
+    SEC_EVENTS,
+    SEC_ODOMETRY,
+    SEC_VISION,
+    SEC_POSE_ESTIMATES,
+    SEC_HYPOS,
+    SectionMAX
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t stepRecordSize; // sizeof(StepRecord), to detect layout changes
+    uint64_t stepCount;
+    uint64_t stepTableOffset; // 0 if the file was not closed
+};
+
+struct SectionRef {
+    uint64_t offset;
+    uint32_t count;
+    uint32_t recordSize;
+};
+
+struct EventRecord {
+    int32_t event; // ParticleFilter::tLocalizationEvent
+};
+
+struct OdometryRecord {
+    float x, y, theta;
+};
+
+// all fields of the text representation of a Robot
+struct RobotRecord {
+    int32_t id;
+    int32_t timestamp;
+    int32_t active;
+    float x, y, theta, confidence;
+    float gtX, gtY, gtTheta, gtConfidence;
+};
+
+// same order as the text representation of a VisionResult
+struct VisionRecord {
+    int32_t type;
+    int32_t timestamp;
+    int32_t ics_x1, ics_y1, ics_x2, ics_y2, ics_width, ics_height;
+    float ics_confidence;
+    float rcs_x1, rcs_y1, rcs_x2, rcs_y2, rcs_alpha, rcs_distance, rcs_confidence;
+    int32_t camera;
+    int32_t extra_int;
+    float extra_float;
+};
+
+struct StepRecord {
+    uint64_t size; // of the record and its sections, offset of the next step
+    int32_t stamp;
+    uint32_t reserved;
+    RobotRecord wcs;
+    uint32_t reserved2;
+    SectionRef sections[SectionMAX];
+};
+
+static_assert(sizeof(FileHeader) == 32, "binary log layout changed");
+static_assert(sizeof(RobotRecord) == 44, "binary log layout changed");
+static_assert(sizeof(VisionRecord) == 76, "binary log layout changed");
+static_assert(sizeof(StepRecord) == 144, "binary log layout changed");
+static_assert(std::is_trivially_copyable<StepRecord>::value, "records must be POD");
+
+// conversion between records and the log structs
+
+inline RobotRecord toRecord(const Robot &r) {
+    return {r.id, r.timestamp, r.active ? 1 : 0,
+            r.pos.coord.x, r.pos.coord.y, r.pos.angle.rad, r.confidence,
+            r.GTpos.coord.x, r.GTpos.coord.y, r.GTpos.angle.rad, r.GTconfidence};
+}
+
+inline Robot fromRecord(const RobotRecord &rec) {
+    Robot r(DirectedCoord(rec.x, rec.y, rec.theta),
+            DirectedCoord(rec.gtX, rec.gtY, rec.gtTheta));
+    r.id = rec.id;
+    r.timestamp = rec.timestamp;
+    r.active = (rec.active != 0);
+    r.confidence = rec.confidence;
+    r.GTconfidence = rec.gtConfidence;
+    return r;
+}
+
+inline VisionRecord toRecord(const VisionResult &v) {
+    return {static_cast<int32_t>(v.type), v.timestamp,
+            v.ics_x1, v.ics_y1, v.ics_x2, v.ics_y2, v.ics_width, v.ics_height,
+            v.ics_confidence,
+            v.rcs_x1, v.rcs_y1, v.rcs_x2, v.rcs_y2, v.rcs_alpha, v.rcs_distance,
+            v.rcs_confidence,
+            v.camera, v.extra_int, v.extra_float};
+}
+
+inline VisionResult fromRecord(const VisionRecord &rec) {
+    VisionResult v;
+    v.type = static_cast<VisionClass>(rec.type);
+    v.timestamp = rec.timestamp;
+    v.ics_x1 = rec.ics_x1;
+    v.ics_y1 = rec.ics_y1;
+    v.ics_x2 = rec.ics_x2;
+    v.ics_y2 = rec.ics_y2;
+    v.ics_width = rec.ics_width;
+    v.ics_height = rec.ics_height;
+    v.ics_confidence = rec.ics_confidence;
+    v.rcs_x1 = rec.rcs_x1;
+    v.rcs_y1 = rec.rcs_y1;
+    v.rcs_x2 = rec.rcs_x2;
+    v.rcs_y2 = rec.rcs_y2;
+    v.rcs_alpha = rec.rcs_alpha;
+    v.rcs_distance = rec.rcs_distance;
+    v.rcs_confidence = rec.rcs_confidence;
+    v.camera = rec.camera;
+    v.extra_int = rec.extra_int;
+    v.extra_float = rec.extra_float;
+    return v;
+}
+
+// array of records inside the mapping
+template<typename T>
+struct Records {
+    const T *data;
+    size_t count;
+
+    const T *begin() const { return data; }
+    const T *end() const { return data + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T &operator[](size_t i) const { return data[i]; }
+};
+
+// one cognition step, points into the mapping of the reader
+class StepView {
+public:
+    StepView(const uint8_t *base, const StepRecord *rec) : base(base), rec(rec) {}
+
+    int stamp() const { return rec->stamp; }
+    const RobotRecord &wcs() const { return rec->wcs; }
+    Records<EventRecord> events() const { return section<EventRecord>(SEC_EVENTS); }
+    Records<OdometryRecord> odometry() const { return section<OdometryRecord>(SEC_ODOMETRY); }
+    Records<VisionRecord> vision() const { return section<VisionRecord>(SEC_VISION); }
+    Records<RobotRecord> poseEstimates() const { return section<RobotRecord>(SEC_POSE_ESTIMATES); }
+    Records<RobotRecord> hypos() const { return section<RobotRecord>(SEC_HYPOS); }
+
+    LogData toLogData() const {
+        LogData ld;
+        ld.stamp = rec->stamp;
+        ld.wcs = fromRecord(rec->wcs);
+        for (const auto &e: events()) {
+            ld.event.push_back(static_cast<ParticleFilter::tLocalizationEvent>(e.event));
+        }
+        for (const auto &o: odometry()) {
+            ld.odo.emplace_back(o.x, o.y, o.theta);
+        }
+        ld.visionResults.reserve(vision().size());
+        for (const auto &v: vision()) {
+            ld.visionResults.push_back(fromRecord(v));
+        }
+        for (const auto &r: poseEstimates()) {
+            ld.poseEstimates.push_back(fromRecord(r));
+        }
+        ld.hypos.reserve(hypos().size());
+        for (const auto &r: hypos()) {
+            ld.hypos.push_back(fromRecord(r));
+        }
+        return ld;
+    }
+
+private:
+    const uint8_t *base;
+    const StepRecord *rec;
+
+    template<typename T>
+    Records<T> section(Section s) const {
+        const SectionRef &ref = rec->sections[s];
+        return {reinterpret_cast<const T *>(base + ref.offset), ref.count};
+    }
+};
+
+// true if the file starts with the binary log magic
+inline bool isBinaryLog(const std::string &fn) {
+    std::ifstream in(fn, std::ios::binary);
+    char magic[sizeof(MAGIC)] = {};
+    in.read(magic, sizeof(magic));
+    return in && (memcmp(magic, MAGIC, sizeof(MAGIC)) == 0);
+}
+
+/**
+ * read only memory mapping of a binary log. the file is validated once
+ * when opened, afterwards steps are accessed without copying.
+ */
+class Reader {
+public:
+    explicit Reader(const std::string &fn) {
+        int fd = open(fn.c_str(), O_RDONLY);
+        if (fd < 0) {
+            err = "can not open " + fn;
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            length = static_cast<size_t>(st.st_size);
+            void *m = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (m != MAP_FAILED) {
+                base = static_cast<const uint8_t *>(m);
+                madvise(m, length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if (!base) {
+            err = "can not map " + fn;
+            return;
+        }
+        validate();
+    }
+
+    ~Reader() {
+        if (base) {
+            munmap(const_cast<uint8_t *>(base), length);
+        }
+    }
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    bool valid() const {
+        return err.empty();
+    }
+
+    const std::string &error() const {
+        return err;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    StepView step(size_t i) const {
+        return StepView(base, reinterpret_cast<const StepRecord *>(base + offsets[i]));
+    }
+
+private:
+    const uint8_t *base = nullptr;
+    size_t length = 0;
+    const uint64_t *offsets = nullptr; // step index, in the mapping if possible
+    size_t count = 0;
+    std::vector<uint64_t> chain; // index of files without step index
+    std::string err;
+
+    template<typename T>
+    const T *at(uint64_t offset, uint64_t count = 1) const {
+        if (offset % alignof(T) != 0 || offset > length ||
+                count > (length - offset) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T *>(base + offset);
+    }
+
+    void validate() {
+        const FileHeader *h = at<FileHeader>(0);
+        if (!h || memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0) {
+            err = "not a binary particle filter log";
+            return;
+        }
+        if (h->version != VERSION || h->stepRecordSize != sizeof(StepRecord)) {
+            err = "unsupported binary log version " + std::to_string(h->version);
+            return;
+        }
+        if (h->stepTableOffset != 0) {
+            const uint64_t *table = at<uint64_t>(h->stepTableOffset, h->stepCount);
+            if (!table) {
+                err = "step index out of bounds";
+                return;
+            }
+            offsets = table;
+            count = h->stepCount;
+        } else {
+            // not closed, follow the chain of step records. the recording may
+            // have stopped inside the last step: the chain ends at the first
+            // step which does not fit into the file
+            uint64_t offset = sizeof(FileHeader);
+            for (const StepRecord *s; (s = at<StepRecord>(offset)) && s->size >= sizeof(StepRecord)
+                    && s->size <= length - offset && sectionsFit(*s); offset += s->size) {
+                chain.push_back(offset);
+            }
+            offsets = chain.data();
+            count = chain.size();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t offset = offsets[i];
+            const StepRecord *s = at<StepRecord>(offset);
+            if (!s) {
+                err = "step record out of bounds";
+                return;
+            }
+            if (!sectionsFit(*s)) {
+                err = "corrupt section in step at offset " + std::to_string(offset);
+                return;
+            }
+        }
+    }
+
+    // all sections of the step have the expected record size and are in the file
+    bool sectionsFit(const StepRecord &s) const {
+        static const uint32_t recordSize[SectionMAX] = {
+            sizeof(EventRecord), sizeof(OdometryRecord), sizeof(VisionRecord),
+            sizeof(RobotRecord), sizeof(RobotRecord)
+        };
+        for (int j = 0; j < SectionMAX; ++j) {
+            const SectionRef &ref = s.sections[j];
+            if (ref.recordSize != recordSize[j] ||
+                    !at<uint32_t>(ref.offset, uint64_t(ref.count) * ref.recordSize / 4)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * streaming writer, only the step index (8 bytes per step) is kept in memory.
+ * close() (or the destructor) writes the index and patches the header.
+ */
+class Writer {
+public:
+    explicit Writer(const std::string &fn) : out(fn, std::ios::binary | std::ios::trunc) {
+        FileHeader h = header();
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        pos = sizeof(h);
+    }
+
+    ~Writer() {
+        close();
+    }
+
+    bool good() const {
+        return static_cast<bool>(out);
+    }
+
+    void write(const LogData &ld) {
+        StepRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.stamp = ld.stamp;
+        rec.wcs = toRecord(ld.wcs);
+
+        events.clear();
+        for (auto e: ld.event) {
+            events.push_back({static_cast<int32_t>(e)});
+        }
+        odometry.clear();
+        for (const auto &o: ld.odo) {
+            odometry.push_back({o.coord.x, o.coord.y, o.angle.rad});
+        }
+        vision.clear();
+        for (const auto &v: ld.visionResults) {
+            vision.push_back(toRecord(v));
+        }
+        poseEstimates.clear();
+        for (const auto &r: ld.poseEstimates) {
+            poseEstimates.push_back(toRecord(r));
+        }
+        hypos.clear();
+        for (const auto &r: ld.hypos) {
+            hypos.push_back(toRecord(r));
+        }
+
+        uint64_t start = pos;
+        uint64_t offset = start + sizeof(StepRecord);
+        offset = place(rec.sections[SEC_EVENTS], events, offset);
+        offset = place(rec.sections[SEC_ODOMETRY], odometry, offset);
+        offset = place(rec.sections[SEC_VISION], vision, offset);
+        offset = place(rec.sections[SEC_POSE_ESTIMATES], poseEstimates, offset);
+        offset = place(rec.sections[SEC_HYPOS], hypos, offset);
+        offset = align8(offset);
+        rec.size = offset - start;
+
+        put(&rec, sizeof(rec));
+        put(events.data(), events.size() * sizeof(EventRecord));
+        put(odometry.data(), odometry.size() * sizeof(OdometryRecord));
+        put(vision.data(), vision.size() * sizeof(VisionRecord));
+        put(poseEstimates.data(), poseEstimates.size() * sizeof(RobotRecord));
+        put(hypos.data(), hypos.size() * sizeof(RobotRecord));
+        pad(offset);
+        index.push_back(start);
+    }
+
+    void close() {
+        if (!out.is_open()) {
+            return;
+        }
+        FileHeader h = header();
+        h.stepCount = index.size();
+        h.stepTableOffset = pos;
+        put(index.data(), index.size() * sizeof(uint64_t));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.close();
+    }
+
+private:
+    std::ofstream out;
+    uint64_t pos = 0;
+    std::vector<uint64_t> index;
+    // reused between steps
+    std::vector<EventRecord> events;
+    std::vector<OdometryRecord> odometry;
+    std::vector<VisionRecord> vision;
+    std::vector<RobotRecord> poseEstimates, hypos;
+
+    static FileHeader header() {
+        FileHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, MAGIC, sizeof(MAGIC));
+        h.version = VERSION;
+        h.stepRecordSize = sizeof(StepRecord);
+        return h;
+    }
+
+    static uint64_t align8(uint64_t v) {
+        return (v + 7) & ~uint64_t(7);
+    }
+
+    template<typename T>
+    static uint64_t place(SectionRef &ref, const std::vector<T> &records, uint64_t offset) {
+        ref.offset = offset;
+        ref.count = static_cast<uint32_t>(records.size());
+        ref.recordSize = sizeof(T);
+        return offset + records.size() * sizeof(T);
+    }
+
+    void put(const void *data, size_t bytes) {
+        out.write(static_cast<const char *>(data), bytes);
+        pos += bytes;
+    }
+
+    void pad(uint64_t to) {
+        static const char zeros[8] = {};
+        put(zeros, to - pos);
+    }
+};
+
+} // namespace binlog
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
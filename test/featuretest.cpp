@@ -0,0 +1,114 @@
+/**
+ * check of the feature types which are not in DefaultFeatures: a filter
+ * with penalty marks and goal poles registered (one FeatureList entry each)
+ * has to observe them, expect them from the particles and weight the
+ * particles with them.
+ *
+ * usage: particlefilterfeaturetest
+ */
+#include <particlefilterimpl.h>
+#include <playingfield.h>
+#include <visiondefinitions.h>
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef FeatureList<features::Lines, features::LCrosses, features::TCrosses,
+                    features::XCrosses, features::Circle, features::PenaltyMarks,
+                    features::GoalPoles> AllFeatures;
+typedef BasicParticleFilter<GaussianObservationModel, OdometryMotionModel, AllFeatures>
+    AllFeaturesFilter;
+
+// the registration is all it takes, the filter has to build with it
+template class BasicParticleFilter<GaussianObservationModel, OdometryMotionModel, AllFeatures>;
+
+namespace {
+
+const float TOLERANCE = 1e-4f;
+
+// the robot pose the vision results are generated for
+const DirectedCoord ROBOT(-1.0f, 0.4f, 2.8f);
+
+VisionResult pointResult(VisionClass type, const Coord &wcs) {
+    const Coord rcs = DirectedCoord(wcs.x, wcs.y, 0.0f).toRCS(ROBOT).coord;
+    VisionResult vr;
+    vr.type = type;
+    vr.rcs_distance = rcs.dist();
+    vr.rcs_alpha = rcs.angle().rad;
+    return vr;
+}
+
+// true if one of the features is the seen one (distance and bearing)
+bool expects(const vector<Feature> &expected, const VisionResult &vr) {
+    for (const auto &f: expected) {
+        if (fabsf(f.dist - vr.rcs_distance) < TOLERANCE
+                && fabsf(Angle(f.angle - vr.rcs_alpha).rad) < TOLERANCE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+int main() {
+    PlayingField field(FieldSize::JRL);
+    ParticleFilter::Settings conf(&field);
+    conf.numParticles = 2;
+    conf.globalFit = 0.0f;
+    AllFeaturesFilter pf(conf);
+    pf.particles[0].setParticle(ROBOT, 0.5f);
+    pf.particles[1].setParticle(ROBOT.walk(DirectedCoord(1.0f, 0.5f, 0.3f)), 0.5f);
+
+    const FieldPoleDef &pole = field.model().poles[0];
+    const vector<VisionResult> vrs = {
+        pointResult(JSVISION_PENALTY, field.getPenaltyMarkPosition(false)),
+        pointResult(JSVISION_GOAL, Coord(pole.wcs_x, pole.wcs_y))
+    };
+    const size_t penalty = AllFeatures::indexOf(JSVISION_PENALTY);
+    const size_t goal = AllFeatures::indexOf(JSVISION_GOAL);
+
+    bool ok = true;
+    auto check = [&ok](bool condition, const string &what) {
+        if (!condition) {
+            cout << "FAIL: " << what << "\n";
+            ok = false;
+        }
+    };
+
+    AllFeaturesFilter::SeenFeatures seen;
+    check(pf.observeFeatures(vrs, seen), "nothing observed");
+    check(seen[penalty].size() == 1, "penalty mark not observed");
+    check(seen[goal].size() == 1, "goal pole not observed");
+
+    pf.particlePoses.assign(pf.particles);
+    features::PenaltyMarks::prepare(pf);
+    features::GoalPoles::prepare(pf);
+    vector<Feature> expected;
+    features::PenaltyMarks::expected(pf, 0, expected);
+    check(expects(expected, vrs[0]), "penalty mark not expected from the robot pose");
+    features::GoalPoles::expected(pf, 0, expected);
+    check(expects(expected, vrs[1]), "goal pole not expected from the robot pose");
+
+    check(pf.measurementModel(vrs), "no measurement update");
+    check(pf.particles[0].weight > pf.particles[1].weight,
+          "the particle at the robot pose is not weighted higher");
+
+    // the default list ignores both types
+    ParticleFilter defaultFilter(conf);
+    ParticleFilter::SeenFeatures defaultSeen;
+    check(!defaultFilter.observeFeatures(vrs, defaultSeen), "default features observe them");
+
+    cout << "weights:            " << pf.particles[0].weight << " at the robot pose, "
+         << pf.particles[1].weight << " 1 m away" << "\n";
+    if (ok) {
+        cout << "PASS" << "\n";
+    }
+    return ok ? 0 : 1;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -2,6 +2,8 @@
 #include <particlefilter.h>
 #include <definitions.h>
 #include <logdataprocessor.hpp>
+#include <logsink.h>
+#include <metrics.hpp>
 
 using namespace std;
 
@@ -29,28 +31,33 @@ public:
     */
     FieldSize fieldSize = FieldSize::JRL;
     ParticleFilter::Settings conf;
+    float meanDist = 0.0f; // of the last run
 
     ParticleFilterTest():
-    conf(new PlayingField(fieldSize)){}
-
-    int runParticleFilter(LogDataset dataset, string outFile) {
+    conf(new PlayingField(fieldSize)){
         conf.numParticles = 50;
         conf.robot_id = 2;
+    }
+
+    // replays the log step by step, the output is written while replaying
+    int runParticleFilter(const string &logFile, string outFile) {
         ParticleFilter loca(conf);
         int cognition_step = 0; 
-        vector<Robot> positionOutputsAndTargets; //for erroranalyzis
-        cout << "run particle filter on field with length :" <<conf.pf->_lengthInsideBounds<<endl;
+        Metrics metrics; //for erroranalyzis
+        PF_LOG(LogLevel::INFO) << "run particle filter on field with length :" <<conf.pf->_lengthInsideBounds;
 
+        LogReader log(logFile);
+        LogWriter output(outFile);
         loca.emit_event(ParticleFilter::EV_INTIAL);
         DirectedCoord odometry(0.0f, 0.0f, 0.0f);
-        for (LogData &data : dataset.data) {
-            vector<VisionResult> vrs;
+        pair<vector<DirectedCoord>,int> poseEstimates={{},1};
+        vector<DirectedCoord> particles;
+        for (LogData data; log.next(data);) {
             cognition_step++;
-            dataset.output.push_back(data);
 
             //Events:
             for (auto event : data.event ) {
-                cout<< "Emit event "<< (int)(event)<<endl;;
+                PF_LOG(LogLevel::DEBUG) << "Emit event "<< (int)(event);
                 loca.emit_event(event);
             }
 
@@ -59,43 +66,65 @@ public:
                 odometry = DirectedCoord(data.odo.at(0));
             }
             else{
-                cout << "No Odometry found at timestamp: "<<cognition_step <<endl;
+                PF_LOG(LogLevel::WARNING) << "No Odometry found at timestamp: "<<cognition_step;
             }
 
             //poseEstimates:
-            pair<vector<DirectedCoord>,int> poseEstimates={{},1};
-            for (auto r: data.poseEstimates){
-                dataset.output.at(dataset.output.size() -1 ).poseEstimates.push_back(r);
+            poseEstimates.first.clear();
+            for (const auto &r: data.poseEstimates){
                 poseEstimates.first.push_back(r.pos);
             }
 
             //update Loca
+            nanoTime start = getMonotonicNanoTime();
             loca.update(data.visionResults, odometry, poseEstimates);
+            nanoTime duration = getMonotonicNanoTime() - start;
             
             //getPos:
             Robot outpos(loca.get_position(),data.wcs.GTpos);
-            positionOutputsAndTargets.push_back(outpos);
-            dataset.output.at(dataset.output.size() -1).wcs = outpos;
+            metrics.add({outpos.pos, outpos.GTpos, duration, data.event, data.stamp});
+            data.wcs = outpos;
 
             //get partikels
-            vector<DirectedCoord> particles = loca.getHypothesesVector();
-            for (auto h: particles) {
+            particles = loca.getHypothesesVector();
+            data.hypos.clear();
+            for (const auto &h: particles) {
                 Robot r;
                 r.pos = h;
                 r.confidence = 1;
-                dataset.output.at(dataset.output.size() -1).hypos.push_back(r);
+                data.hypos.push_back(r);
             }
+            output.write(data);
         }
-        cout <<  TEXT_HEADLINE << "EVALUTAION OF LOCA FILTER, mean dist: "<<
-                mean(evaluatePositionsWithGroundtruth(positionOutputsAndTargets))<<
-                TEXT_NORMAL<< endl;
-
-        cout <<"SAVE DATA IN LOGFILE"<<outFile<< endl;
-        dataset.logtoFile(outFile);
+        if (!log.error().empty()) {
+            PF_LOG(LogLevel::ERROR) << log.error();
+        }
+        if (cognition_step == 0) {
+            PF_LOG(LogLevel::ERROR) <<  TEXT_HEADLINE << "Couldn't read cognitionsteps from logfile!! :/"<<
+                TEXT_NORMAL;
+            return 1;
+        }
+        PF_LOG(LogLevel::INFO) << "read " << cognition_step << " cognition steps from logfile ";
+        meanDist = metrics.meanPosition();
+        PF_RESULT <<  TEXT_HEADLINE << "EVALUTAION OF LOCA FILTER, mean dist: "<<
+                meanDist << ", rmse: " << metrics.rmsePosition() << " m / "
+                << metrics.rmseHeading() << " rad, lost: " << 100.0 * metrics.lostFraction()
+                << "%" << TEXT_NORMAL;
+        string metricsFile = outFile.substr(0, outFile.rfind(".log")) + ".metrics.json";
+        ofstream metricsOut(metricsFile);
+        metrics.writeJson(metricsOut);
+        PF_RESULT << "SAVED METRICS IN " << metricsFile;
+#ifdef PF_PROFILING
+        PF_RESULT << loca.getProfiler();
+#endif
+
+        output.flush();
+        PF_RESULT <<"SAVED DATA IN LOGFILE"<<outFile;
         
-        cout << TEXT_HEADLINE << "end of test"<< endl;
-        cout << "---------------------------------------------------------"
-                 << TEXT_NORMAL<< endl;
+        PF_LOG(LogLevel::INFO) << TEXT_HEADLINE << "end of test";
+        PF_LOG(LogLevel::INFO) << "---------------------------------------------------------"
+                 << TEXT_NORMAL;
+        consoleLog().flush();
 
         return 0;
     }
@@ -120,7 +149,7 @@ public:
                 loca.manualPlacementHandler(); 
             }
             
-            out<< "(" << type<< ")" << " enter new cognition step: " << type << endl;
+            out<< "(" << type<< ")" << " enter new cognition step: " << type << "\n";
 
             Robot outpos(loca.get_position());
 
@@ -130,67 +159,51 @@ public:
                 Robot r;
                 r.pos = h;
                 r.confidence = 1;
-                out << "(" << type<< ") Hypo: "  << r << endl; 
+                out << "(" << type<< ") Hypo: "  << r << "\n";
             }
             // write  estimated position
-            out << "(" << type << ") WCS: " << outpos << endl; 
+            out << "(" << type << ") WCS: " << outpos << "\n";
         }
         out.close();
         return 0;
     }
-
-private:
-    float mean( vector<float> v) {
-        float sum =  accumulate(v.begin(), v.end(), 0.0);
-        float mean = sum / v.size();
-        return mean;
-    }
-
-     vector<float>  evaluatePositionsWithGroundtruth(vector<Robot> positions) {
-        vector<float> dist;
-        vector<float> angledist;
-        float stdev;
-        for (size_t i=0; i < positions.size(); i++) {
-            Coord pos = Coord(positions.at(i).pos.coord.x, positions.at(i).pos.coord.y);
-            Coord GTpos = Coord(positions.at(i).GTpos.coord.x,
-                                positions.at(i).GTpos.coord.y);
-            //distance
-            dist.push_back(pos.dist(GTpos));
-            //angle
-            float alpha = positions.at(i).pos.angle.rad;
-            float GTalpha = positions.at(i).GTpos.angle.rad;
-            if ((alpha>0 and GTalpha<0) or ((alpha < 0 and GTalpha > 0))) {
-                angledist.push_back(min(alpha+GTalpha, 2*M_PI_F-(alpha+GTalpha)));
-            } else {
-                angledist.push_back(fabsf(fabsf(alpha)- fabsf(GTalpha)));
-            }
-        }
-        return dist;
-    }
 };
 
 
 int main(int argc, const char *argv[]) {
 
-    cout<< "hi, this is the loca testbox" << TEXT_NORMAL<<endl;
+    PF_LOG(LogLevel::INFO) << "hi, this is the loca testbox" << TEXT_NORMAL;
     ParticleFilterTest test;
 
     string data_fn;
+    bool compare_compact = false;
+    for (int i = 2; i < argc; ++i) {
+        string arg(argv[i]);
+        if (arg == "--compact") {
+            compare_compact = true;
+        } else if (arg == "--settings" && i + 1 < argc) {
+            // e.g. written by particlefilteroptimize
+            if (!test.conf.load(argv[++i])) {
+                return 1;
+            }
+        }
+    }
     if (argc > 1 && argv[1] != NULL) {
         data_fn =  string(argv[1]);
-        //parse logfile
-        LogDataset log(data_fn);
-        if (log.data.size() >0){
-            return test.runParticleFilter(log, "ParticleFilterOutput.log");
-        }
-        else{
-            cout <<  TEXT_HEADLINE << "Couldn't read cognitionsteps from logfile!! :/"<<
-                TEXT_NORMAL<< endl;
-            return 1;
+        int ret = test.runParticleFilter(data_fn, "ParticleFilterOutput.log");
+        if (compare_compact && ret == 0) {
+            // same log with quantized particle storage
+            float floatDist = test.meanDist;
+            test.conf.compactParticles = true;
+            ret |= test.runParticleFilter(data_fn, "ParticleFilterOutputCompact.log");
+            PF_RESULT << TEXT_HEADLINE << "COMPACT PARTICLES, mean dist: " << test.meanDist
+                 << " (float: " << floatDist << ", delta: " << test.meanDist - floatDist
+                 << ")" << TEXT_NORMAL;
         }
+        return ret;
     } 
     else {
-        cout<< TEXT_HEADLINE <<  "no logfile provided, test initializations"<<TEXT_NORMAL<<endl;
+        PF_LOG(LogLevel::INFO) << TEXT_HEADLINE <<  "no logfile provided, test initializations"<<TEXT_NORMAL;
         return test.initFilter("ParticleFilterOutput.log");
     }
 }
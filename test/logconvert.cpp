@@ -0,0 +1,189 @@
+/**
+ * converts logs between the text format and the binary format (binarylog.hpp),
+ * the direction is given by the input: text logs are written as binary logs
+ * and binary logs as text logs.
+ *
+ * usage: particlefilterlogconvert <in> <out> [--check]
+ *   --check  read the written log back and compare it with the input. a
+ *            binary log is also checked as an aborted recording (no step
+ *            index, cut inside the last step): the complete steps have to
+ *            be readable
+ */
+#include <logdataprocessor.hpp>
+#include <platform.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// the text format has 6 significant digits
+bool near(float a, float b) {
+    return fabsf(a - b) <= 1e-5f * max(1.0f, max(fabsf(a), fabsf(b)));
+}
+
+bool near(const DirectedCoord &a, const DirectedCoord &b) {
+    return near(a.coord.x, b.coord.x) && near(a.coord.y, b.coord.y) &&
+           near(a.angle.rad, b.angle.rad);
+}
+
+bool same(const Robot &a, const Robot &b) {
+    return a.id == b.id && a.timestamp == b.timestamp && a.active == b.active &&
+           near(a.pos, b.pos) && near(a.confidence, b.confidence) &&
+           near(a.GTpos, b.GTpos) && near(a.GTconfidence, b.GTconfidence);
+}
+
+bool same(const VisionResult &a, const VisionResult &b) {
+    return a.type == b.type && a.timestamp == b.timestamp &&
+           a.ics_x1 == b.ics_x1 && a.ics_y1 == b.ics_y1 && a.ics_x2 == b.ics_x2 &&
+           a.ics_y2 == b.ics_y2 && a.ics_width == b.ics_width &&
+           a.ics_height == b.ics_height && near(a.ics_confidence, b.ics_confidence) &&
+           near(a.rcs_x1, b.rcs_x1) && near(a.rcs_y1, b.rcs_y1) &&
+           near(a.rcs_x2, b.rcs_x2) && near(a.rcs_y2, b.rcs_y2) &&
+           near(a.rcs_alpha, b.rcs_alpha) && near(a.rcs_distance, b.rcs_distance) &&
+           near(a.rcs_confidence, b.rcs_confidence) && a.camera == b.camera &&
+           a.extra_int == b.extra_int && near(a.extra_float, b.extra_float);
+}
+
+template<typename T, typename Eq>
+bool sameAll(const vector<T> &a, const vector<T> &b, Eq eq) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!eq(a[i], b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool same(const LogData &a, const LogData &b) {
+    auto robot = [](const Robot &x, const Robot &y) { return same(x, y); };
+    auto vision = [](const VisionResult &x, const VisionResult &y) { return same(x, y); };
+    auto odo = [](const DirectedCoord &x, const DirectedCoord &y) { return near(x, y); };
+    return a.stamp == b.stamp && same(a.wcs, b.wcs) && a.event == b.event &&
+           sameAll(a.odo, b.odo, odo) &&
+           sameAll(a.visionResults, b.visionResults, vision) &&
+           sameAll(a.poseEstimates, b.poseEstimates, robot) &&
+           sameAll(a.hypos, b.hypos, robot);
+}
+
+double msSince(nanoTime start) {
+    return (getMonotonicNanoTime() - start) / 1e6;
+}
+
+// the first 'count' steps of both logs are the same and 'b' has no more
+bool sameSteps(LogReader &a, LogReader &b, size_t count) {
+    LogData x, y;
+    for (size_t i = 0; i < count; ++i) {
+        if (!a.next(x) || !b.next(y) || !same(x, y)) {
+            cout << "FAIL: cognition step " << i << " differs" << endl;
+            if (!b.error().empty()) {
+                cout << b.error() << endl;
+            }
+            return false;
+        }
+    }
+    if (b.next(y)) {
+        cout << "FAIL: more cognition steps written than read" << endl;
+        return false;
+    }
+    return true;
+}
+
+// the binary log as an aborted recording: header without step index, cut
+// 'cut' bytes into the last step. all steps before it have to be read
+bool checkTruncated(const string &in, const string &binary, size_t cut) {
+    ifstream file(binary, ios::binary);
+    ostringstream content;
+    content << file.rdbuf();
+    string bytes = content.str();
+    binlog::FileHeader h;
+    memcpy(&h, bytes.data(), sizeof(h));
+    uint64_t last;
+    memcpy(&last, bytes.data() + h.stepTableOffset + (h.stepCount - 1) * sizeof(last),
+           sizeof(last));
+    h.stepTableOffset = 0;
+    bytes.resize(last + cut);
+    memcpy(&bytes[0], &h, sizeof(h));
+    const string truncated = binary + ".truncated";
+    ofstream(truncated, ios::binary | ios::trunc) << bytes;
+
+    LogReader original(in), aborted(truncated);
+    if (!sameSteps(original, aborted, h.stepCount - 1)) {
+        return false;
+    }
+    cout << "read " << h.stepCount - 1 << " of " << h.stepCount
+         << " cognition steps of the truncated log" << endl;
+    return true;
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <in> <out> [--check]" << endl;
+        return 2;
+    }
+    string in(argv[1]), out(argv[2]);
+    bool check = (argc > 3 && string(argv[3]) == "--check");
+    bool toText = binlog::isBinaryLog(in);
+
+    // stream, one cognition step at a time
+    nanoTime start = getMonotonicNanoTime();
+    LogReader reader(in);
+    size_t steps = 0;
+    if (toText) {
+        ofstream text(out);
+        for (const LogData &d: reader) {
+            writeLogStep(text, d, static_cast<int>(steps++));
+        }
+    } else {
+        binlog::Writer writer(out);
+        for (const LogData &d: reader) {
+            writer.write(d);
+            ++steps;
+        }
+        writer.close();
+        if (!writer.good()) {
+            cerr << "can not write " << out << endl;
+            return 1;
+        }
+    }
+    if (!reader.error().empty()) {
+        cerr << reader.error() << endl;
+        return 1;
+    }
+    if (steps == 0) {
+        cerr << "no cognition steps in " << in << endl;
+        return 1;
+    }
+    cout << "converted " << steps << " cognition steps to a "
+         << (toText ? "text" : "binary") << " log " << out << " in " << msSince(start)
+         << " ms" << endl;
+
+    if (check) {
+        start = getMonotonicNanoTime();
+        LogReader original(in), written(out);
+        if (!sameSteps(original, written, steps)) {
+            return 1;
+        }
+        cout << "compared " << steps << " cognition steps in " << msSince(start) << " ms" << endl;
+        // cut in the step record and in its sections
+        if (!toText && (!checkTruncated(in, out, 37)
+                        || !checkTruncated(in, out, sizeof(binlog::StepRecord) + 37))) {
+            return 1;
+        }
+        cout << "PASS" << endl;
+    }
+    return 0;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
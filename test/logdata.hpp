@@ -0,0 +1,117 @@
+/**
+ * one cognition step of a log and its text representation:
+ *
+ *   (stamp) <message>
+ *
+ * messages are "WCS: ", "Odometry: x;y;a", "Measurement: ", "Hypo: ",
+ * "VisionResult: ", "Emit event: " and "enter new cognition step: n", the
+ * latter closes the lines read before as one cognition step.
+ */
+#pragma once
+
+#include <definitions.h>
+#include <coords.h>
+#include <particlefilter.h>
+#include <visiondefinitions.h>
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct LogData {
+    // a step without WCS line has no timestamp (instead of the time of parsing)
+    LogData() : stamp(0) {
+        wcs.timestamp = 0;
+    }
+
+    int stamp;
+    std::vector<Robot> poseEstimates;
+    Robot wcs;
+    std::vector<Robot> hypos;
+    std::vector<DirectedCoord> odo;
+    std::vector<VisionResult> visionResults;
+    std::vector<std::string> s;
+    std::vector<ParticleFilter::tLocalizationEvent> event;
+};
+
+/**
+ * adds one text line to the cognition step ld.
+ * returns true if the line closes the step, the caller takes ld then
+ * and starts a new one. malformed records are stored as far as they
+ * could be parsed.
+ */
+inline bool parseLogLine(std::string_view line, LogData &ld) {
+    if (line.size() < 3 || line[0] != '(') {
+        return false;
+    }
+    size_t close = line.find(')');
+    if (close == std::string_view::npos) {
+        return false;
+    }
+
+    int stamp = 0;
+    std::from_chars(line.data() + 1, line.data() + close, stamp);
+    ld.stamp = stamp;
+
+    std::string_view s = line.substr(std::min(close + 2, line.size()));
+    auto startsWith = [&s](std::string_view prefix) {
+        return s.substr(0, prefix.size()) == prefix;
+    };
+    if (startsWith("enter new cognition step:")) {
+        return true;
+    }
+
+    if (startsWith("WCS: ")) {
+        Robot::parse(s.substr(5), ld.wcs);
+    } else if (startsWith("Odometry: ")) {
+        float x = 0.0f, y = 0.0f, a = 0.0f;
+        textparse::Scanner in(s.substr(10));
+        in.read("x", x).expect(";", "y").read("y", y).expect(";", "a").read("a", a);
+        ld.odo.push_back(DirectedCoord(x, y, a));
+    } else if (startsWith("Measurement: ")) {
+        ld.poseEstimates.emplace_back();
+        Robot::parse(s.substr(13), ld.poseEstimates.back());
+    } else if (startsWith("Hypo: ")) {
+        ld.hypos.emplace_back();
+        Robot::parse(s.substr(6), ld.hypos.back());
+    } else if (startsWith("VisionResult: ")) {
+        ld.visionResults.emplace_back();
+        VisionResult::parse(s.substr(14), ld.visionResults.back());
+    } else if (startsWith("Emit event: ")) {
+        int event = 0;
+        textparse::Scanner(s.substr(12)).read("event", event);
+        ld.event.push_back(static_cast<ParticleFilter::tLocalizationEvent>(event));
+    }
+    return false;
+}
+
+/**
+ * writes the lines of one cognition step followed by the header that
+ * closes it, parseLogLine reads the same step back.
+ */
+inline void writeLogStep(std::ostream &out, const LogData &d, int step) {
+    const std::string prefix = "(" + std::to_string(d.stamp) + ") ";
+    out << prefix << "WCS: " << d.wcs << "\n";
+    for (const auto &vr: d.visionResults) {
+        out << prefix << "VisionResult: " << vr << "\n";
+    }
+    for (const auto &meas: d.poseEstimates) {
+        out << prefix << "Measurement: " << meas << "\n";
+    }
+    for (const auto &hypo: d.hypos) {
+        out << prefix << "Hypo: " << hypo << "\n";
+    }
+    for (const auto &odo: d.odo) {
+        out << prefix << "Odometry: " << odo.coord.x << ";" << odo.coord.y << ";"
+            << odo.angle.rad << "\n";
+    }
+    for (auto event: d.event) {
+        out << prefix << "Emit event: " << static_cast<int>(event) << "\n";
+    }
+    out << prefix << "enter new cognition step: " << step + 1 << "\n";
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -1,124 +1,193 @@
+#pragma once
+
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <fstream>
-#include <definitions.h>
-#include <coords.h>
-#include <particlefilter.h>
-#include <random>
-
-struct LogData {
-    int stamp;
-    std::vector<Robot> poseEstimates;
-    Robot wcs;
-    std::vector<Robot> hypos;
-    std::vector<DirectedCoord> odo;
-    std::vector<VisionResult> visionResults;
-    std::vector<std::string> s;
-    std::vector<ParticleFilter::tLocalizationEvent> event;
-};
+#include <sstream>
+#include <logsink.h>
+#include <binarylog.hpp>
+#include <logdata.hpp>
 
-class LogDataset {
+/**
+ * streaming log reader, text or binary logs (detected by content).
+ * only one cognition step is held in memory at a time:
+ *
+ *   LogReader log(fn);
+ *   for (const LogData &d: log) { ... }
+ *
+ * the range can be iterated once, open a new reader to read again.
+ * a log which can not be read has no steps, error() tells why (printed by
+ * the tool, next to its own errors).
+ */
+class LogReader {
 public:
-    std::vector<LogData> data;
-    std::vector<LogData> output; //if multiple visualizations per output are needed
-
-    LogDataset(const std::string &fn){
-        std::ifstream input(fn);
-        LogData ld; //one cognition step in dataset
-        for (std::string line; std::getline(input, line);) {
-            if (line.size() < 3) {
-                continue;
+    explicit LogReader(const std::string &fn) {
+        if (binlog::isBinaryLog(fn)) {
+            binary.reset(new binlog::Reader(fn));
+            if (!binary->valid()) {
+                err = "can not read binary log " + fn + ": " + binary->error();
             }
-            if (line.find("(") != 0) {
-                continue;
+        } else {
+            text.open(fn);
+            if (!text) {
+                err = "can not open " + fn;
             }
+        }
+    }
 
-            int stamp = atoi(line.substr(1, line.find(")")).c_str());
-            ld.stamp = stamp;
+    // why the log can not be read, empty if it can
+    const std::string &error() const {
+        return err;
+    }
 
-            std::string s = line.substr(line.find(")") + 2);
-            if (s.find("enter new cognition step:") == 0) {                    
-                int step = atoi(s.substr(s.find(": ") + 2).c_str());
-                // add as new log data element
-                data.push_back(ld);
-                ld = LogData();
-                continue;
+    // reads the next cognition step into ld, false at the end of the log
+    bool next(LogData &ld) {
+        if (binary) {
+            if (!binary->valid() || steps >= binary->size()) {
+                return false;
             }
-
-            if (s.find("WCS: ") != std::string::npos) {
-                ld.wcs.setFromString(s.substr(5));
-                continue;
+            ld = binary->step(steps++).toLogData();
+            return true;
+        }
+        pending = LogData();
+        for (std::string line; std::getline(text, line);) {
+            if (parseLogLine(line, pending)) {
+                std::swap(ld, pending);
+                ++steps;
+                return true;
             }
+        }
+        // an unclosed last step is dropped, same as LogDataset
+        return false;
+    }
 
-            if (s.find("Odometry: ") != std::string::npos) {
-                size_t pos1 = s.find(";");
-                size_t pos2 = s.find(";", pos1 + 1);
-                float x = atof(s.substr(10, pos1 - 10).c_str());
-                float y = atof(s.substr(pos1 + 1, pos2 - pos1 - 1).c_str());
-                float a = atof(s.substr(pos2 + 1).c_str());
-                ld.odo.push_back(DirectedCoord(x, y, a));
-                continue;
-            }
+    // number of cognition steps read so far
+    size_t stepsRead() const {
+        return steps;
+    }
 
-            if (s.find("Measurement: ") != std::string::npos) {
-                Robot r;
-                r.setFromString(s.substr(13));
-                ld.poseEstimates.push_back(r);
-                continue;
-            }
-            if (s.find("VisionResult: ") != std::string::npos) {
-                VisionResult vr(s.substr(14));
-                ld.visionResults.push_back(vr);
-                continue;
-            }
-            if (s.find("Emit event: ") != std::string::npos) {
-                size_t pos = s.find(":");
-                ld.event.push_back(static_cast<ParticleFilter::tLocalizationEvent>(atoi(s.substr(pos+1).c_str())));
-                continue;
+    class iterator {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef LogData value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const LogData *pointer;
+        typedef const LogData &reference;
+
+        explicit iterator(LogReader *reader = nullptr) : reader(reader) {
+            ++*this;
+        }
+        const LogData &operator*() const {
+            return current;
+        }
+        const LogData *operator->() const {
+            return &current;
+        }
+        iterator &operator++() {
+            if (reader && !reader->next(current)) {
+                reader = nullptr;
             }
+            return *this;
         }
+        bool operator==(const iterator &other) const {
+            return reader == other.reader;
+        }
+        bool operator!=(const iterator &other) const {
+            return reader != other.reader;
+        }
+
+    private:
+        LogReader *reader;
+        LogData current;
+    };
 
-        std::cout << "read " << data.size() << " cognition steps from logfile " << std::endl;
+    iterator begin() {
+        return iterator(this);
     }
 
-    void logtoFile(const std::string  filename){
-        std::ofstream out(filename);
-        int cognition_step = 0;
-        for (auto d: output) {
-            if (cognition_step %500 == 0){
-                std::cout<<cognition_step <<std::endl;
-            }
-            //start output with new declaration of cognition step
-            out << "(" << d.stamp << ")" << " enter new cognition step: "<< cognition_step << std::endl;
-            
-            //outpus Robot position 
-            out << "(" << d.stamp << ") WCS: "<< d.wcs << std::endl;
-            
-            //output vision results
-            for (auto vr : d.visionResults){
-                out<< "(" << d.stamp << ") " << "VisionResult: " << vr << std::endl;
-            } 
-            //outpus measurement( pose estimations from landmarks)  
-            for (auto meas : d.poseEstimates){
-                out << "(" << d.stamp << ") Measurement: "<< meas << std::endl;
-            }
-            //output particle filter hypos
-            for (auto hypo : d.hypos){
-                out << "(" << d.stamp << ") Hypo: "<< hypo << std::endl;
-            }
-            //output odometry
-            for (auto odo:d.odo) {
-                out << "(" << d.stamp << ") Odometry: "<< odo.coord.x << ";" 
-                    << odo.coord.y <<  ";" << odo.angle.rad << std::endl;
-       
-            }
-            //output localizationevent
-            for (auto event : d.event){
-                out << "(" << d.stamp << ") Emit event: "<< (int) event << std::endl;
-            }
-            cognition_step ++;            
+    iterator end() {
+        return iterator();
+    }
+
+private:
+    std::unique_ptr<binlog::Reader> binary;
+    std::ifstream text;
+    LogData pending;
+    size_t steps = 0;
+    std::string err;
+};
+
+/**
+ * streaming text log writer, every step starts with its
+ * "enter new cognition step" header as expected by the LogFileVizualizer.
+ * the file is written asynchronously by a LogSink thread.
+ */
+class LogWriter {
+public:
+    explicit LogWriter(const std::string &fn) : sink(fn, LogSink::BLOCK) {}
+
+    void write(const LogData &d) {
+        out.str("");
+        const std::string prefix = "(" + std::to_string(d.stamp) + ") ";
+        //start output with new declaration of cognition step
+        out << prefix << "enter new cognition step: " << cognition_step << "\n";
+        //outpus Robot position
+        out << prefix << "WCS: " << d.wcs << "\n";
+        //output vision results
+        for (const auto &vr: d.visionResults) {
+            out << prefix << "VisionResult: " << vr << "\n";
+        }
+        //outpus measurement( pose estimations from landmarks)
+        for (const auto &meas: d.poseEstimates) {
+            out << prefix << "Measurement: " << meas << "\n";
+        }
+        //output particle filter hypos
+        for (const auto &hypo: d.hypos) {
+            out << prefix << "Hypo: " << hypo << "\n";
         }
-        out.close();
+        //output odometry
+        for (const auto &odo: d.odo) {
+            out << prefix << "Odometry: " << odo.coord.x << ";" << odo.coord.y << ";"
+                << odo.angle.rad << "\n";
+        }
+        //output localizationevent
+        for (auto event: d.event) {
+            out << prefix << "Emit event: " << static_cast<int>(event) << "\n";
+        }
+        sink.write(out.str());
+        cognition_step++;
+    }
+
+    // wait until all steps are written to the file
+    void flush() {
+        sink.flush();
+    }
+
+    bool good() const {
+        return sink.good();
     }
 
-};
\ No newline at end of file
+private:
+    LogSink sink;
+    std::ostringstream out;
+    int cognition_step = 0;
+};
+
+// whole log in memory, for tools which need random access to the steps
+class LogDataset {
+public:
+    std::vector<LogData> data;
+    // see LogReader::error
+    std::string error;
+
+    LogDataset(const std::string &fn){
+        LogReader reader(fn);
+        for (LogData ld; reader.next(ld);) {
+            data.push_back(std::move(ld));
+        }
+        error = reader.error();
+        PF_LOG(LogLevel::INFO) << "read " << data.size() << " cognition steps from logfile ";
+    }
+};
@@ -0,0 +1,310 @@
+/**
+ * streaming accuracy metrics of a replay, fed one frame at a time with
+ * constant memory (log spaced histograms instead of all samples):
+ *
+ *  - position and heading error: rmse, mean, percentiles, max
+ *  - time to converge after EV_UNPENALIZED / EV_STATE_INITIAL: frames and
+ *    ms until the error stays below the convergence thresholds
+ *  - lost frames: position error above a threshold
+ *  - mirror frames: the estimate matches the ground truth mirrored at the
+ *    field center, flips count how often the filter jumped into the mirror
+ *  - update time: percentiles, correlation with the errors, mean update
+ *    time of lost frames
+ *
+ *   Metrics m;
+ *   for (const auto &s: replayLog(log, conf)) m.add(s);
+ *   m.writeJson(out);
+ */
+#pragma once
+
+#include <replay.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+// counts values in geometrically growing bins, quantiles have a relative error < ratio - 1
+class Histogram {
+public:
+    Histogram(double min, double max, double ratio = 1.01) :
+        min(min), logRatio(std::log(ratio)),
+        bins(static_cast<size_t>(std::ceil(std::log(max / min) / logRatio)) + 2, 0) {}
+
+    void add(double v) {
+        size_t bin = 0;
+        if (v >= min) {
+            bin = std::min(bins.size() - 1, 1 + static_cast<size_t>(std::log(v / min) / logRatio));
+        }
+        ++bins[bin];
+        ++n;
+        maxValue = std::max(maxValue, v);
+    }
+
+    void merge(const Histogram &other) {
+        for (size_t i = 0; i < bins.size() && i < other.bins.size(); ++i) {
+            bins[i] += other.bins[i];
+        }
+        n += other.n;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    // p = [0 ... 1], geometric center of the bin (0 below min)
+    double quantile(double p) const {
+        if (n == 0) {
+            return 0.0;
+        }
+        size_t rank = std::min(n - 1, static_cast<size_t>(p * n));
+        size_t seen = 0;
+        for (size_t i = 0; i < bins.size(); ++i) {
+            seen += bins[i];
+            if (seen > rank) {
+                if (i == 0) {
+                    return 0.0;
+                }
+                return std::min(maxValue, min * std::exp((i - 0.5) * logRatio));
+            }
+        }
+        return maxValue;
+    }
+
+    double max() const {
+        return maxValue;
+    }
+
+private:
+    double min, logRatio;
+    std::vector<size_t> bins;
+    size_t n = 0;
+    double maxValue = 0.0;
+};
+
+struct MetricsThresholds {
+    float convergeDist = 0.3f; // m
+    float convergeHeading = 0.35f; // rad
+    int convergeFrames = 5; // consecutive frames below both
+    float lostDist = 1.0f; // m
+    float mirrorDist = 0.5f; // m, to the mirrored ground truth
+    float mirrorHeading = 0.5f; // rad
+};
+
+class Metrics {
+public:
+    typedef MetricsThresholds Thresholds;
+
+    explicit Metrics(const Thresholds &t = Thresholds()) :
+        t(t), position(1e-4, 100.0), heading(1e-5, 4.0), latency(0.1, 1e7) {}
+
+    void add(const ReplayStep &s) {
+        double pe = positionError(s);
+        double he = headingError(s);
+        double us = s.updateTime / 1000.0;
+
+        ++frames;
+        position.add(pe);
+        heading.add(he);
+        latency.add(us);
+        sum.add(pe, he, us);
+
+        bool lost = pe > t.lostDist;
+        if (lost) {
+            ++lostFrames;
+            lostLatency += us;
+        }
+
+        // ground truth seen from the other half of the field
+        DirectedCoord mirror(-s.gt.coord.x, -s.gt.coord.y, s.gt.angle.rad + M_PI_F);
+        bool mirrored = lost && s.pose.coord.dist(mirror.coord) < t.mirrorDist &&
+                        fabsf(Angle(s.pose.angle.rad - mirror.angle.rad).rad) < t.mirrorHeading;
+        if (mirrored) {
+            ++mirrorFrames;
+            if (!wasMirrored) {
+                ++flips;
+            }
+        }
+        wasMirrored = mirrored;
+
+        for (auto ev: s.events) {
+            if (ev == ParticleFilter::EV_UNPENALIZED || ev == ParticleFilter::EV_STATE_INITIAL) {
+                // a new trigger before convergence: the old one never converged
+                ++triggers;
+                converging = true;
+                triggerFrame = frames - 1;
+                triggerStamp = s.stamp;
+                goodFrames = 0;
+            }
+        }
+        if (converging) {
+            if (pe < t.convergeDist && he < t.convergeHeading) {
+                if (goodFrames++ == 0) {
+                    firstGoodFrame = frames - 1;
+                    firstGoodStamp = s.stamp;
+                }
+                if (goodFrames >= t.convergeFrames) {
+                    convergeFrames.push_back(firstGoodFrame - triggerFrame);
+                    convergeMs.push_back(firstGoodStamp - triggerStamp);
+                    converging = false;
+                }
+            } else {
+                goodFrames = 0;
+            }
+        }
+    }
+
+    // all frames of another replay, e.g. another seed or log
+    void merge(const Metrics &other) {
+        frames += other.frames;
+        position.merge(other.position);
+        heading.merge(other.heading);
+        latency.merge(other.latency);
+        sum.merge(other.sum);
+        lostFrames += other.lostFrames;
+        lostLatency += other.lostLatency;
+        mirrorFrames += other.mirrorFrames;
+        flips += other.flips;
+        triggers += other.triggers;
+        convergeFrames.insert(convergeFrames.end(), other.convergeFrames.begin(),
+                              other.convergeFrames.end());
+        convergeMs.insert(convergeMs.end(), other.convergeMs.begin(), other.convergeMs.end());
+    }
+
+    size_t size() const {
+        return frames;
+    }
+
+    double meanPosition() const {
+        return frames ? sum.pos / frames : 0.0;
+    }
+
+    double rmsePosition() const {
+        return frames ? std::sqrt(sum.posSq / frames) : 0.0;
+    }
+
+    double rmseHeading() const {
+        return frames ? std::sqrt(sum.headSq / frames) : 0.0;
+    }
+
+    double lostFraction() const {
+        return frames ? static_cast<double>(lostFrames) / frames : 0.0;
+    }
+
+    void writeJson(std::ostream &out) const {
+        double n = std::max<size_t>(1, frames);
+        std::vector<size_t> cf(convergeFrames);
+        std::vector<int> cms(convergeMs);
+        double cfSum = 0.0, cmsSum = 0.0;
+        for (size_t i = 0; i < cf.size(); ++i) {
+            cfSum += cf[i];
+            cmsSum += cms[i];
+        }
+        double converged = std::max<size_t>(1, cf.size());
+
+        out << "{\n  \"frames\": " << frames << ",\n";
+        out << "  \"position_m\": ";
+        writeError(out, position, sum.pos, sum.posSq, n);
+        out << ",\n  \"heading_rad\": ";
+        writeError(out, heading, sum.head, sum.headSq, n);
+        out << ",\n  \"convergence\": {\"triggers\": " << triggers
+            << ", \"converged\": " << cf.size()
+            << ", \"frames_mean\": " << cfSum / converged
+            << ", \"frames_p50\": " << percentile(cf, 0.5f)
+            << ", \"frames_max\": " << (cf.empty() ? 0 : *std::max_element(cf.begin(), cf.end()))
+            << ", \"ms_mean\": " << cmsSum / converged
+            << ", \"ms_p50\": " << percentile(cms, 0.5f)
+            << ", \"ms_max\": " << (cms.empty() ? 0 : *std::max_element(cms.begin(), cms.end()))
+            << "},\n";
+        out << "  \"lost\": {\"frames\": " << lostFrames << ", \"fraction\": " << lostFrames / n
+            << "},\n";
+        out << "  \"mirror\": {\"frames\": " << mirrorFrames << ", \"fraction\": "
+            << mirrorFrames / n << ", \"flips\": " << flips << "},\n";
+        out << "  \"latency_us\": {\"mean\": " << sum.time / n
+            << ", \"p50\": " << latency.quantile(0.5) << ", \"p95\": " << latency.quantile(0.95)
+            << ", \"p99\": " << latency.quantile(0.99) << ", \"max\": " << latency.max()
+            << ", \"mean_lost\": ";
+        writeNumber(out, lostFrames ? lostLatency / lostFrames : NAN);
+        out << ", \"corr_position\": ";
+        writeNumber(out, sum.correlation(sum.pos, sum.posSq, sum.timePos));
+        out << ", \"corr_heading\": ";
+        writeNumber(out, sum.correlation(sum.head, sum.headSq, sum.timeHead));
+        out << "},\n";
+        out << "  \"thresholds\": {\"converge_m\": " << t.convergeDist
+            << ", \"converge_rad\": " << t.convergeHeading
+            << ", \"converge_frames\": " << t.convergeFrames << ", \"lost_m\": " << t.lostDist
+            << ", \"mirror_m\": " << t.mirrorDist << ", \"mirror_rad\": " << t.mirrorHeading
+            << "}\n}\n";
+    }
+
+private:
+    // running sums for the means, rmse and the latency correlation
+    struct Sums {
+        double pos = 0, posSq = 0, head = 0, headSq = 0;
+        double time = 0, timeSq = 0, timePos = 0, timeHead = 0;
+        size_t n = 0;
+
+        void add(double pe, double he, double us) {
+            pos += pe;
+            posSq += pe * pe;
+            head += he;
+            headSq += he * he;
+            time += us;
+            timeSq += us * us;
+            timePos += us * pe;
+            timeHead += us * he;
+            ++n;
+        }
+
+        void merge(const Sums &o) {
+            pos += o.pos;
+            posSq += o.posSq;
+            head += o.head;
+            headSq += o.headSq;
+            time += o.time;
+            timeSq += o.timeSq;
+            timePos += o.timePos;
+            timeHead += o.timeHead;
+            n += o.n;
+        }
+
+        // pearson correlation of the update time with x, NAN if undefined
+        double correlation(double x, double xSq, double timeX) const {
+            double cov = n * timeX - time * x;
+            double var = (n * timeSq - time * time) * (n * xSq - x * x);
+            return var > 0.0 ? cov / std::sqrt(var) : NAN;
+        }
+    };
+
+    Thresholds t;
+    size_t frames = 0;
+    Histogram position, heading, latency;
+    Sums sum;
+    size_t lostFrames = 0;
+    double lostLatency = 0.0;
+    size_t mirrorFrames = 0, flips = 0;
+    bool wasMirrored = false;
+
+    size_t triggers = 0;
+    bool converging = false;
+    size_t triggerFrame = 0, firstGoodFrame = 0;
+    int triggerStamp = 0, firstGoodStamp = 0;
+    int goodFrames = 0;
+    std::vector<size_t> convergeFrames; // one per converged trigger
+    std::vector<int> convergeMs;
+
+    // json has no nan
+    static void writeNumber(std::ostream &out, double v) {
+        if (std::isfinite(v)) {
+            out << v;
+        } else {
+            out << "null";
+        }
+    }
+
+    static void writeError(std::ostream &out, const Histogram &h, double s, double sSq,
+                           double n) {
+        out << "{\"rmse\": " << std::sqrt(sSq / n) << ", \"mean\": " << s / n
+            << ", \"p50\": " << h.quantile(0.5) << ", \"p95\": " << h.quantile(0.95)
+            << ", \"p99\": " << h.quantile(0.99) << ", \"max\": " << h.max() << "}";
+    }
+};
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
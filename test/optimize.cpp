@@ -0,0 +1,421 @@
+/**
+ * parameter optimizer: tunes the filter settings with a separable CMA-ES
+ * (Ros & Hansen 2008, diagonal covariance) on ground truth logs and writes
+ * the best settings as a file the filter can load (Settings::load).
+ *
+ * every candidate is scored by replaying all logs with all seeds in
+ * parallel. the seeds are the same for every candidate, so differences in
+ * the score come from the parameters and not from the random numbers.
+ *
+ *   cost = mean position error + heading weight * mean heading error
+ *
+ * candidates with a frame time (p50, or p99 with --budget-p99) above the
+ * budget are infeasible and always rank behind every feasible one. with
+ * many threads the frame times include contention, use --threads 1 if the
+ * budget is tight.
+ *
+ * usage: particlefilteroptimize <log>... [--out pf.conf] [--init <settings>]
+ *            [--budget-us 1000] [--budget-p99] [--generations 15]
+ *            [--heading-weight 0.3] [--seeds 2] [--threads <cores>]
+ *            [--field jrl] [--robot-id 2] [--rng-seed 1]
+ */
+#include <replay.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+typedef ParticleFilter::Settings Settings;
+
+/*
+ * one tuned parameter. the optimizer works on z in [0, 1] which is mapped
+ * linearly or logarithmically onto [lo, hi].
+ */
+struct Parameter {
+    const char *name;
+    float lo, hi;
+    bool logScale;
+    float (*get)(const Settings &);
+    void (*set)(Settings &, float);
+
+    float fromUnit(float z) const {
+        z = std::clamp(z, 0.0f, 1.0f);
+        if (logScale) {
+            return lo * pow(hi / lo, z);
+        }
+        return lo + z * (hi - lo);
+    }
+
+    float toUnit(float v) const {
+        v = std::clamp(v, lo, hi);
+        if (logScale) {
+            return log(v / lo) / log(hi / lo);
+        }
+        return (v - lo) / (hi - lo);
+    }
+};
+
+// one standard deviation for the distance, bearing and orientation error
+// of a feature type (Settings::featureNoise)
+template<VisionClass TYPE>
+float getDeviation(const Settings &s) {
+    return s.noiseOf(TYPE).dist;
+}
+
+template<VisionClass TYPE>
+void setDeviation(Settings &s, float v) {
+    s.featureNoise[TYPE] = {v, v, v};
+}
+
+const Parameter PARAMETERS[] = {
+    {"numParticles", 10.0f, 400.0f, true,
+        [](const Settings &s) { return static_cast<float>(s.numParticles); },
+        [](Settings &s, float v) { s.numParticles = static_cast<size_t>(lround(v)); }},
+    {"odoStdev.x", 0.0005f, 0.2f, true,
+        [](const Settings &s) { return s.odoStdev.coord.x; },
+        [](Settings &s, float v) { s.odoStdev.coord.x = v; }},
+    {"odoStdev.y", 0.0005f, 0.2f, true,
+        [](const Settings &s) { return s.odoStdev.coord.y; },
+        [](Settings &s, float v) { s.odoStdev.coord.y = v; }},
+    {"odoStdev.angle", 0.0005f, 0.2f, true,
+        [](const Settings &s) { return s.odoStdev.angle.rad; },
+        [](Settings &s, float v) { s.odoStdev.angle.rad = v; }},
+    // per feature type of the default list instead of probDeviation
+    {"lineDeviation", 0.1f, 4.0f, true,
+        getDeviation<JSVISION_LINE>, setDeviation<JSVISION_LINE>},
+    {"lcrossDeviation", 0.1f, 4.0f, true,
+        getDeviation<JSVISION_LCROSS>, setDeviation<JSVISION_LCROSS>},
+    {"tcrossDeviation", 0.1f, 4.0f, true,
+        getDeviation<JSVISION_TCROSS>, setDeviation<JSVISION_TCROSS>},
+    {"xcrossDeviation", 0.1f, 4.0f, true,
+        getDeviation<JSVISION_XCROSS>, setDeviation<JSVISION_XCROSS>},
+    {"circleDeviation", 0.1f, 4.0f, true,
+        getDeviation<JSVISION_CIRCLE>, setDeviation<JSVISION_CIRCLE>},
+    {"replacementShare", 0.0f, 0.25f, false,
+        [](const Settings &s) { return s.replacementShare; },
+        [](Settings &s, float v) { s.replacementShare = v; }},
+    {"replacementShareMulti", 0.0f, 0.4f, false,
+        [](const Settings &s) { return s.replacementShareMulti; },
+        [](Settings &s, float v) { s.replacementShareMulti = v; }},
+    {"adjustmentDist", 0.2f, 4.0f, false,
+        [](const Settings &s) { return s.adjustmentDist; },
+        [](Settings &s, float v) { s.adjustmentDist = v; }},
+};
+
+const size_t DIM = sizeof(PARAMETERS) / sizeof(PARAMETERS[0]);
+
+typedef vector<double> Vector;
+
+struct Candidate {
+    Vector z; // unit space, inside [0, 1]
+    Vector y; // sampling step (before clamping), used for the adaptation
+    ReplayScore score;
+    bool feasible;
+    double cost;
+};
+
+Settings fromUnit(const Settings &base, const Vector &z) {
+    Settings s = base;
+    for (size_t i = 0; i < DIM; ++i) {
+        PARAMETERS[i].set(s, PARAMETERS[i].fromUnit(static_cast<float>(z[i])));
+    }
+    return s;
+}
+
+Vector toUnit(const Settings &s) {
+    Vector z(DIM);
+    for (size_t i = 0; i < DIM; ++i) {
+        z[i] = PARAMETERS[i].toUnit(PARAMETERS[i].get(s));
+    }
+    return z;
+}
+
+// feasible candidates first, then by cost
+bool better(const Candidate &a, const Candidate &b) {
+    if (a.feasible != b.feasible) {
+        return a.feasible;
+    }
+    return a.cost < b.cost;
+}
+
+class Evaluator {
+public:
+    Evaluator(const vector<LogDataset> &logs, const Settings &base, unsigned int seeds,
+              unsigned int threads, float budgetUs, bool budgetP99, float headingWeight) :
+        logs(logs), base(base), seeds(seeds), threads(threads), budgetUs(budgetUs),
+        budgetP99(budgetP99), headingWeight(headingWeight) {}
+
+    void evaluate(vector<Candidate> &candidates) const {
+        size_t tasksPerCandidate = logs.size() * seeds;
+        vector<ReplayStats> stats(candidates.size() * tasksPerCandidate);
+        parallelFor(stats.size(), threads, [&](size_t task) {
+            Settings conf = fromUnit(base, candidates[task / tasksPerCandidate].z);
+            conf.seed = 1 + task % seeds;
+            size_t log = (task % tasksPerCandidate) / seeds;
+            stats[task].add(replayLog(logs[log].data, conf));
+        });
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            ReplayStats all;
+            for (size_t t = 0; t < tasksPerCandidate; ++t) {
+                all.add(stats[i * tasksPerCandidate + t]);
+            }
+            Candidate &c = candidates[i];
+            c.score = all.score();
+            float frameTime = budgetP99 ? c.score.frameP99 : c.score.frameP50;
+            c.feasible = frameTime <= budgetUs;
+            c.cost = c.score.meanPosition + headingWeight * c.score.meanHeading;
+            if (!c.feasible) {
+                // ranks infeasible candidates among themselves
+                c.cost = frameTime / budgetUs;
+            }
+        }
+    }
+
+private:
+    const vector<LogDataset> &logs;
+    Settings base;
+    unsigned int seeds, threads;
+    float budgetUs;
+    bool budgetP99;
+    float headingWeight;
+};
+
+/*
+ * separable CMA-ES in the unit cube: mean m, step size sigma and the
+ * diagonal of the covariance matrix d. samples outside the cube are
+ * clamped for the evaluation, the adaptation uses the unclamped step.
+ */
+class SepCmaEs {
+public:
+    SepCmaEs(const Vector &start, double sigma, unsigned int rngSeed) :
+        m(start), sigma(sigma), d(DIM, 1.0), ps(DIM, 0.0), pc(DIM, 0.0), rng(rngSeed) {
+        const double n = DIM;
+        lambda = 4 + static_cast<size_t>(3.0 * log(n));
+        mu = lambda / 2;
+        double sum = 0.0;
+        for (size_t i = 0; i < mu; ++i) {
+            weights.push_back(log(mu + 0.5) - log(i + 1.0));
+            sum += weights.back();
+        }
+        double sumSq = 0.0;
+        for (auto &w: weights) {
+            w /= sum;
+            sumSq += w * w;
+        }
+        muEff = 1.0 / sumSq;
+        cs = (muEff + 2.0) / (n + muEff + 5.0);
+        ds = 1.0 + 2.0 * max(0.0, sqrt((muEff - 1.0) / (n + 1.0)) - 1.0) + cs;
+        cc = (4.0 + muEff / n) / (n + 4.0 + 2.0 * muEff / n);
+        // diagonal covariance learns (n + 2) / 3 times faster
+        c1 = (n + 2.0) / 3.0 * 2.0 / ((n + 1.3) * (n + 1.3) + muEff);
+        cmu = min(1.0 - c1, (n + 2.0) / 3.0 * 2.0 * (muEff - 2.0 + 1.0 / muEff) /
+                               ((n + 2.0) * (n + 2.0) + muEff));
+        chiN = sqrt(n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+    }
+
+    size_t populationSize() const {
+        return lambda;
+    }
+
+    double stepSize() const {
+        return sigma;
+    }
+
+    vector<Candidate> sample() {
+        normal_distribution<double> normal;
+        vector<Candidate> population(lambda);
+        for (auto &c: population) {
+            c.y.resize(DIM);
+            c.z.resize(DIM);
+            for (size_t i = 0; i < DIM; ++i) {
+                c.y[i] = sqrt(d[i]) * normal(rng);
+                c.z[i] = std::clamp(m[i] + sigma * c.y[i], 0.0, 1.0);
+            }
+        }
+        return population;
+    }
+
+    // population has to be sorted, best first
+    void update(const vector<Candidate> &population) {
+        ++generation;
+        const double n = DIM;
+        Vector yw(DIM, 0.0);
+        for (size_t k = 0; k < mu; ++k) {
+            for (size_t i = 0; i < DIM; ++i) {
+                yw[i] += weights[k] * population[k].y[i];
+            }
+        }
+        double psNorm = 0.0;
+        for (size_t i = 0; i < DIM; ++i) {
+            m[i] = std::clamp(m[i] + sigma * yw[i], 0.0, 1.0);
+            ps[i] = (1.0 - cs) * ps[i] + sqrt(cs * (2.0 - cs) * muEff) * yw[i] / sqrt(d[i]);
+            psNorm += ps[i] * ps[i];
+        }
+        psNorm = sqrt(psNorm);
+        bool hs = psNorm / sqrt(1.0 - pow(1.0 - cs, 2.0 * generation)) <
+                  (1.4 + 2.0 / (n + 1.0)) * chiN;
+        for (size_t i = 0; i < DIM; ++i) {
+            pc[i] = (1.0 - cc) * pc[i] + (hs ? sqrt(cc * (2.0 - cc) * muEff) * yw[i] : 0.0);
+            double rankMu = 0.0;
+            for (size_t k = 0; k < mu; ++k) {
+                rankMu += weights[k] * population[k].y[i] * population[k].y[i];
+            }
+            d[i] = (1.0 - c1 - cmu) * d[i] +
+                   c1 * (pc[i] * pc[i] + (hs ? 0.0 : cc * (2.0 - cc) * d[i])) + cmu * rankMu;
+        }
+        sigma *= exp(cs / ds * (psNorm / chiN - 1.0));
+        // the whole cube is at most one unit wide
+        sigma = min(sigma, 1.0);
+    }
+
+private:
+    Vector m;
+    double sigma;
+    Vector d, ps, pc;
+    default_random_engine rng;
+    size_t lambda, mu;
+    Vector weights;
+    double muEff, cs, ds, cc, c1, cmu, chiN;
+    int generation = 0;
+};
+
+void printCandidate(ostream &out, const char *label, const Candidate &c) {
+    out << label << fixed << setprecision(4) << " pos " << c.score.meanPosition
+        << " m (p95 " << c.score.p95Position << "), heading " << setprecision(2)
+        << c.score.meanHeading * 180.0f / M_PI_F << " deg, frame p50 " << setprecision(1)
+        << c.score.frameP50 << " us p99 " << c.score.frameP99 << " us"
+        << (c.feasible ? "" : " (over budget)") << "\n" << defaultfloat << setprecision(6);
+}
+
+void printSettings(ostream &out, const Settings &s) {
+    for (const auto &p: PARAMETERS) {
+        out << "  " << setw(22) << left << p.name << right << p.get(s) << "\n";
+    }
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    vector<string> logFiles;
+    string outFile = "pf.conf", initFile;
+    float budgetUs = 1000.0f;
+    bool budgetP99 = false;
+    int generations = 15;
+    float headingWeight = 0.3f;
+    unsigned int seeds = 2;
+    unsigned int threads = std::max(1u, thread::hardware_concurrency());
+    FieldSize fieldSize = FieldSize::JRL;
+    int robotId = 2;
+    unsigned int rngSeed = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg.substr(0, 2) != "--") {
+            logFiles.push_back(arg);
+        } else if (arg == "--out" && hasValue) {
+            outFile = argv[++i];
+        } else if (arg == "--init" && hasValue) {
+            initFile = argv[++i];
+        } else if (arg == "--budget-us" && hasValue) {
+            budgetUs = atof(argv[++i]);
+        } else if (arg == "--budget-p99") {
+            budgetP99 = true;
+        } else if (arg == "--generations" && hasValue) {
+            generations = atoi(argv[++i]);
+        } else if (arg == "--heading-weight" && hasValue) {
+            headingWeight = atof(argv[++i]);
+        } else if (arg == "--seeds" && hasValue) {
+            seeds = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (arg == "--field" && hasValue) {
+            if (!parseFieldSize(argv[++i], fieldSize)) {
+                cerr << "unknown field " << argv[i] << "\n";
+                return 2;
+            }
+        } else if (arg == "--robot-id" && hasValue) {
+            robotId = atoi(argv[++i]);
+        } else if (arg == "--rng-seed" && hasValue) {
+            rngSeed = static_cast<unsigned int>(atoi(argv[++i]));
+        } else {
+            cerr << "unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+    if (logFiles.empty()) {
+        cerr << "usage: " << argv[0] << " <log>... [--out pf.conf] [--init settings]"
+             << " [--budget-us 1000] [--budget-p99] [--generations 15]"
+             << " [--heading-weight 0.3] [--seeds 2] [--threads n] [--field jrl]"
+             << " [--robot-id 2] [--rng-seed 1]\n";
+        return 2;
+    }
+    consoleLog().setLevel(LogLevel::ERROR);
+
+    vector<LogDataset> logs;
+    logs.reserve(logFiles.size());
+    for (const auto &fn: logFiles) {
+        logs.emplace_back(fn);
+        if (!logs.back().error.empty()) {
+            cerr << logs.back().error << "\n";
+            return 2;
+        }
+        if (logs.back().data.empty()) {
+            cerr << "no cognition steps in " << fn << "\n";
+            return 2;
+        }
+    }
+    PlayingField field(fieldSize);
+    Settings base(&field);
+    base.robot_id = robotId;
+    if (!initFile.empty() && !base.load(initFile)) {
+        cerr << "can not load settings " << initFile << "\n";
+        return 2;
+    }
+
+    Evaluator evaluator(logs, base, seeds, threads, budgetUs, budgetP99, headingWeight);
+    SepCmaEs es(toUnit(base), 0.2, rngSeed);
+
+    vector<Candidate> start(1);
+    start[0].z = toUnit(base);
+    evaluator.evaluate(start);
+    Candidate best = start[0];
+    cout << "optimizing " << DIM << " parameters, " << es.populationSize()
+         << " candidates per generation, " << logs.size() << " logs x " << seeds
+         << " seeds on " << threads << " threads\n";
+    printCandidate(cout, "start:       ", best);
+
+    for (int g = 1; g <= generations; ++g) {
+        vector<Candidate> population = es.sample();
+        evaluator.evaluate(population);
+        sort(population.begin(), population.end(), better);
+        es.update(population);
+        if (better(population[0], best)) {
+            best = population[0];
+        }
+        ostringstream label;
+        label << "generation " << setw(2) << g << ":";
+        printCandidate(cout, label.str().c_str(), population[0]);
+        cout << "  sigma " << es.stepSize() << "\n";
+    }
+
+    Settings result = fromUnit(base, best.z);
+    printCandidate(cout, "best:        ", best);
+    printSettings(cout, result);
+    if (!result.save(outFile)) {
+        cerr << "can not write " << outFile << "\n";
+        return 1;
+    }
+    cout << "settings written to " << outFile << "\n";
+    return best.feasible ? 0 : 1;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,611 @@
+/**
+ * micro benchmarks for every stage of the particle filter
+ *
+ * usage: particlefilterbench [--filter <name>] [--min-time <ms>]
+ *                            [--out <json>] [--baseline <json>] [--tolerance <0.1>]
+ *                            [--min-skipped <share>]
+ *
+ * every benchmark runs over a grid of particle and observation counts,
+ * one op is one call of the stage (over all particles where applicable).
+ *
+ * --min-skipped fails unless the early exit of measurementModel/pruned
+ * skips at least this share of the likelihoods (1000 particles spread over
+ * the field, 12 observations) and keeps the weights of weightAll.
+ */
+#include <benchmark.hpp>
+
+#include <batchtransform.h>
+#include <coords.h>
+#include <definitions.h>
+#include <particlefilter.h>
+#include <playingfield.h>
+#include <simd.h>
+#include <visiondefinitions.h>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+const vector<size_t> PARTICLES = {50, 200, 1000};
+const vector<size_t> OBSERVATIONS = {2, 6, 12};
+
+PlayingField &field() {
+    static PlayingField pf(FieldSize::JRL);
+    return pf;
+}
+
+vector<bench::Params> particleGrid() {
+    vector<bench::Params> ret;
+    for (size_t p: PARTICLES) {
+        ret.push_back({p, 0});
+    }
+    return ret;
+}
+
+vector<bench::Params> observationGrid() {
+    vector<bench::Params> ret;
+    for (size_t o: OBSERVATIONS) {
+        ret.push_back({1, o});
+    }
+    return ret;
+}
+
+vector<bench::Params> fullGrid() {
+    vector<bench::Params> ret;
+    for (size_t p: PARTICLES) {
+        for (size_t o: OBSERVATIONS) {
+            ret.push_back({p, o});
+        }
+    }
+    return ret;
+}
+
+// all crosses and poles of the field
+PointBatch fieldLandmarks() {
+    PointBatch ret;
+    for (const auto &c: field().model().crosses) {
+        ret.push_back(Coord(c.wcs_x, c.wcs_y));
+    }
+    for (const auto &pole: field().model().poles) {
+        ret.push_back(Coord(pole.wcs_x, pole.wcs_y));
+    }
+    return ret;
+}
+
+// all field line segments
+SegmentBatch fieldSegments() {
+    SegmentBatch ret;
+    for (const auto &l: field().model().lines) {
+        ret.push_back(Coord(l.start_x, l.start_y), Coord(l.end_x, l.end_y), l.equation);
+    }
+    return ret;
+}
+
+// the robot pose the observations are generated for
+const DirectedCoord ROBOT(0.5f, 0.3f, 0.2f);
+
+// 'count' observations of lines, crosses and the circle as seen from ROBOT,
+// the types are interleaved so that every count contains a mix
+vector<VisionResult> observations(size_t count) {
+    const FieldModel &m = field().model();
+    vector<VisionResult> lines, crosses;
+    for (const auto &l: m.lines) {
+        Coord s = DirectedCoord(l.start_x, l.start_y, 0.0f).toRCS(ROBOT).coord;
+        Coord e = DirectedCoord(l.end_x, l.end_y, 0.0f).toRCS(ROBOT).coord;
+        if (s.dist(e) < 1.0f) {
+            continue;
+        }
+        VisionResult vr;
+        vr.type = JSVISION_LINE;
+        vr.rcs_x1 = s.x;
+        vr.rcs_y1 = s.y;
+        vr.rcs_x2 = e.x;
+        vr.rcs_y2 = e.y;
+        lines.push_back(vr);
+    }
+    for (const auto &c: m.crosses) {
+        Coord rcs = DirectedCoord(c.wcs_x, c.wcs_y, 0.0f).toRCS(ROBOT).coord;
+        VisionResult vr;
+        vr.type = (c.degree == 2) ? JSVISION_LCROSS :
+                  (c.degree == 3) ? JSVISION_TCROSS : JSVISION_XCROSS;
+        vr.rcs_distance = rcs.dist();
+        vr.rcs_alpha = rcs.angle().rad;
+        vr.extra_float = Angle(c.wcs_alpha - ROBOT.angle.rad).rad;
+        crosses.push_back(vr);
+    }
+    VisionResult circle;
+    circle.type = JSVISION_CIRCLE;
+    Coord center = DirectedCoord(0.0f, 0.0f, 0.0f).toRCS(ROBOT).coord;
+    circle.rcs_distance = center.dist();
+    circle.rcs_alpha = center.angle().rad;
+
+    vector<VisionResult> ret;
+    for (size_t i = 0; ret.size() < count; ++i) {
+        ret.push_back(lines[i % lines.size()]);
+        if (ret.size() < count) {
+            ret.push_back(crosses[(i * 5) % crosses.size()]);
+        }
+        if (ret.size() < count && i % 3 == 2) {
+            ret.push_back(circle);
+        }
+    }
+    return ret;
+}
+
+// filter with 'n' particles spread over the field, playing
+shared_ptr<ParticleFilter> makeFilter(size_t n, float pruneShare = 0.0f) {
+    ParticleFilter::Settings conf(&field());
+    conf.numParticles = n;
+    conf.pruneShare = pruneShare;
+    auto pf = make_shared<ParticleFilter>(conf);
+    pf->gamestate = GameState::PLAYING;
+    mt19937 rng(42);
+    uniform_real_distribution<float> x(-field()._lengthInsideBounds / 2, field()._lengthInsideBounds / 2);
+    uniform_real_distribution<float> y(-field()._widthInsideBounds / 2, field()._widthInsideBounds / 2);
+    uniform_real_distribution<float> a(-M_PI_F, M_PI_F);
+    for (auto &p: pf->particles) {
+        p.setParticle(DirectedCoord(x(rng), y(rng), a(rng)), 1.0f / n);
+    }
+    return pf;
+}
+
+void randomWeights(ParticleFilter &pf) {
+    mt19937 rng(7);
+    uniform_real_distribution<float> w(0.0f, 1.0f);
+    for (auto &p: pf.particles) {
+        p.weight = w(rng);
+    }
+    pf.normalizeParticle();
+}
+
+string visionResultString(const VisionResult &vr) {
+    ostringstream s;
+    s << vr;
+    return s.str();
+}
+
+// the share of likelihoods the early exit skips in the largest
+// measurementModel/pruned case, -1 if a kept weight differs from the
+// full evaluation or a pruned one would have got u or more copies
+double prunedShare() {
+    const size_t n = PARTICLES.back();
+    const float u = 0.01f;
+    shared_ptr<ParticleFilter> pruned = makeFilter(n, u);
+    shared_ptr<ParticleFilter> full = makeFilter(n);
+    vector<VisionResult> vrs = observations(OBSERVATIONS.back());
+    pruned->measurementModel(vrs);
+    full->measurementModel(vrs);
+    float sum = 0.0f;
+    for (const auto &p: full->particles) {
+        sum += p.weight;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        const float w = pruned->particles[i].weight, expected = full->particles[i].weight;
+        if (w == 0.0f ? expected * n >= u * sum : fabsf(w - expected) > 1e-6f * expected) {
+            cerr << "particle " << i << ": weight " << w << ", full evaluation " << expected << endl;
+            return -1.0;
+        }
+    }
+    const auto &s = pruned->measurementStats;
+    return static_cast<double>(s.skipped) / (s.likelihoods + s.skipped);
+}
+
+void registerAll(bench::Runner &r) {
+    // filter stages
+    r.add("moveParticles", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            DirectedCoord odo(0.0f, 0.0f, 0.0f);
+            for (uint64_t i = 0; i < n; ++i) {
+                // alternate forward and backward so particles stay on the field
+                odo = odo.walk(DirectedCoord((i & 1) ? -0.02f : 0.02f, 0.005f, 0.01f));
+                pf->moveParticles(odo);
+            }
+            bench::doNotOptimize(pf->particles[0].pose.coord.x);
+        };
+    });
+
+    r.add("createLineFeature", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &particle: pf->particles) {
+                    auto f = pf->createLineFeature(particle);
+                    bench::doNotOptimize(f.data());
+                }
+            }
+        };
+    });
+
+    r.add("createCrossFeatures", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &particle: pf->particles) {
+                    auto l = pf->createLCrossFeature(particle);
+                    auto t = pf->createTCrossFeature(particle);
+                    auto x = pf->createXCrossFeature(particle);
+                    auto c = pf->createCircleFeature(particle);
+                    bench::doNotOptimize(l.data());
+                    bench::doNotOptimize(t.data());
+                    bench::doNotOptimize(x.data());
+                    bench::doNotOptimize(c.data());
+                }
+            }
+        };
+    });
+
+    r.add("calculateProbabilityOfMatchingLandmark", observationGrid(),
+    [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(1);
+        pf->particles[0].setPose(ROBOT);
+        vector<Feature> landmarks = pf->createLineFeature(pf->particles[0]);
+        vector<Feature> obs;
+        for (size_t i = 0; i < p.observations; ++i) {
+            const Feature &l = landmarks[i % landmarks.size()];
+            obs.push_back(Feature(JSVISION_LINE, l.dist + 0.05f, l.angle, l.orientation, 0));
+        }
+        return [pf, obs, landmarks](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &o: obs) {
+                    auto res = pf->calculateProbabilityOfMatchingLandmark(o, landmarks);
+                    bench::doNotOptimize(res.first);
+                }
+            }
+        };
+    });
+
+    r.add("measurementModel", fullGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        vector<VisionResult> vrs = observations(p.observations);
+        return [pf, vrs](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                bench::doNotOptimize(pf->measurementModel(vrs));
+            }
+        };
+    });
+
+    // two stage, the best fifth of the particles gets all observations
+    r.add("measurementModel/twoStage", fullGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        pf->conf.refineShare = 0.2f;
+        vector<VisionResult> vrs = observations(p.observations);
+        return [pf, vrs](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                bench::doNotOptimize(pf->measurementModel(vrs));
+            }
+        };
+    });
+
+    // early exit, particles spread over the whole field
+    r.add("measurementModel/pruned", fullGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles, 0.01f);
+        vector<VisionResult> vrs = observations(p.observations);
+        return [pf, vrs](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                bench::doNotOptimize(pf->measurementModel(vrs));
+            }
+        };
+    });
+
+    // one grid search (the grid is built before), particles spread over the field
+    r.add("globalLocalisation", observationGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(50);
+        vector<VisionResult> vrs = observations(p.observations);
+        pf->globalLocalisation(vrs);
+        return [pf, vrs](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                bench::doNotOptimize(pf->globalLocalisation(vrs));
+            }
+        };
+    });
+
+    r.add("normalizeParticle", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        randomWeights(*pf);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                pf->normalizeParticle();
+            }
+            bench::doNotOptimize(pf->particles[0].weight);
+        };
+    });
+
+    r.add("lowVarianzeResample", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        randomWeights(*pf);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                pf->lowVarianzeResample();
+            }
+            bench::doNotOptimize(pf->particles[0].weight);
+        };
+    });
+
+    r.add("resample", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        randomWeights(*pf);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                pf->resample();
+            }
+            bench::doNotOptimize(pf->particles[0].weight);
+        };
+    });
+
+    r.add("calculatePose", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                pf->calculatePose();
+            }
+            bench::doNotOptimize(pf->pos.coord.x);
+        };
+    });
+
+    r.add("update", fullGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        vector<VisionResult> vrs = observations(p.observations);
+        return [pf, vrs](uint64_t n) {
+            DirectedCoord odo(0.0f, 0.0f, 0.0f);
+            for (uint64_t i = 0; i < n; ++i) {
+                odo = odo.walk(DirectedCoord((i & 1) ? -0.02f : 0.02f, 0.0f, 0.01f));
+                pf->update(vrs, odo, {{}, 1});
+            }
+            bench::doNotOptimize(pf->pos.coord.x);
+        };
+    });
+
+    // playing field queries
+    const vector<bench::Params> single = {{1, 0}};
+    r.add("PlayingField::getLines", single, [](const bench::Params &) -> bench::Body {
+        return [](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                auto l = field().getLines();
+                bench::doNotOptimize(l.data());
+            }
+        };
+    });
+
+    r.add("PlayingField::getLCrosses", single, [](const bench::Params &) -> bench::Body {
+        return [](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                auto c = field().getLCrosses();
+                bench::doNotOptimize(c.data());
+            }
+        };
+    });
+
+    r.add("PlayingField::getDistsAndAngles", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &particle: pf->particles) {
+                    auto d = field().getDistsAndAngles(particle.pose);
+                    bench::doNotOptimize(d.data());
+                }
+            }
+        };
+    });
+
+    r.add("PlayingField::getDistsAndAngles/batch", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        auto poses = make_shared<PoseBatch>();
+        poses->assign(pf->particles);
+        const size_t n = poses->size() * field().landmarkBatch(LANDMARK_ALL).points.size();
+        auto out = make_shared<vector<float>>(2 * n);
+        return [poses, out, n](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                field().getDistsAndAngles(*poses, LANDMARK_ALL, out->data(), out->data() + n);
+                bench::doNotOptimize(out->data());
+            }
+        };
+    });
+
+    // coordinate transforms, one op = one transform per particle
+    r.add("DirectedCoord::toRCS", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            const DirectedCoord landmark(1.0f, -0.5f, 0.0f);
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &particle: pf->particles) {
+                    DirectedCoord rcs = landmark.toRCS(particle.pose);
+                    bench::doNotOptimize(rcs.coord.x);
+                }
+            }
+        };
+    });
+
+    // all particles x all crosses and poles, distance and bearing.
+    // one op = the whole matrix, batched against one toRCS call per pair
+    r.add("transformToRCS", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        auto landmarks = make_shared<PointBatch>(fieldLandmarks());
+        auto out = make_shared<RcsBatch>();
+        return [pf, landmarks, out](uint64_t n) {
+            PoseBatch poses;
+            for (uint64_t i = 0; i < n; ++i) {
+                poses.assign(pf->particles);
+                transformToRCS(poses, *landmarks, *out, RcsBatch::DIST | RcsBatch::BEARING);
+                bench::doNotOptimize(out->dist.data());
+            }
+        };
+    });
+
+    r.add("DirectedCoord::toRCS/landmarks", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        auto landmarks = make_shared<PointBatch>(fieldLandmarks());
+        return [pf, landmarks](uint64_t n) {
+            vector<float> dist(pf->particles.size() * landmarks->size());
+            vector<float> bearing(dist.size());
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t k = 0;
+                for (const auto &particle: pf->particles) {
+                    for (size_t j = 0; j < landmarks->size(); ++j, ++k) {
+                        DirectedCoord lm(landmarks->x[j], landmarks->y[j], 0.0f);
+                        Coord rcs = lm.toRCS(particle.pose).coord;
+                        dist[k] = rcs.dist();
+                        bearing[k] = rcs.direction();
+                    }
+                }
+                bench::doNotOptimize(dist.data());
+            }
+        };
+    });
+
+    // all particles x all field lines, closest point distance, bearing and orientation.
+    // one op = the whole matrix, batched against closestPointOnLine per pair
+    r.add("segmentsToRCS", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        auto segments = make_shared<SegmentBatch>(fieldSegments());
+        auto out = make_shared<RcsBatch>();
+        return [pf, segments, out](uint64_t n) {
+            PoseBatch poses;
+            for (uint64_t i = 0; i < n; ++i) {
+                poses.assign(pf->particles);
+                segmentsToRCS(poses, *segments, *out, SegmentMode::CLAMPED,
+                              RcsBatch::DIST | RcsBatch::BEARING | RcsBatch::ORIENTATION);
+                bench::doNotOptimize(out->dist.data());
+            }
+        };
+    });
+
+    r.add("Coord::closestPointOnLine/lines", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            const auto &lines = field().model().lines;
+            vector<float> dist(pf->particles.size() * lines.size());
+            vector<float> bearing(dist.size()), orientation(dist.size());
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t k = 0;
+                for (const auto &particle: pf->particles) {
+                    for (const auto &l: lines) {
+                        Coord start(l.start_x, l.start_y), end(l.end_x, l.end_y);
+                        DirectedCoord closest(particle.pose.coord.closestPointOnLine(start, end, true),
+                                              Angle());
+                        Coord rcs = closest.toRCS(particle.pose).coord;
+                        dist[k] = rcs.dist();
+                        bearing[k] = rcs.direction();
+                        orientation[k++] = (end - start).direction() - particle.pose.angle.rad;
+                    }
+                }
+                bench::doNotOptimize(dist.data());
+            }
+        };
+    });
+
+    r.add("DirectedCoord::walk", particleGrid(), [](const bench::Params &p) -> bench::Body {
+        shared_ptr<ParticleFilter> pf = makeFilter(p.particles);
+        return [pf](uint64_t n) {
+            const DirectedCoord delta(0.02f, 0.01f, 0.05f);
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &particle: pf->particles) {
+                    DirectedCoord w = particle.pose.walk(delta);
+                    bench::doNotOptimize(w.coord.x);
+                }
+            }
+        };
+    });
+
+    // text parsing, one op = 'observations' records
+    r.add("VisionResult::parse", observationGrid(), [](const bench::Params &p) -> bench::Body {
+        vector<string> lines;
+        for (const auto &vr: observations(p.observations)) {
+            lines.push_back(visionResultString(vr));
+        }
+        return [lines](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &l: lines) {
+                    VisionResult vr(l);
+                    bench::doNotOptimize(vr.rcs_x1);
+                }
+            }
+        };
+    });
+
+    r.add("Robot::setFromString", observationGrid(), [](const bench::Params &p) -> bench::Body {
+        Robot robot(DirectedCoord(1.2f, -0.7f, 0.3f), DirectedCoord(1.25f, -0.65f, 0.31f));
+        ostringstream s;
+        s << robot;
+        vector<string> lines(p.observations, s.str());
+        return [lines](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i) {
+                for (const auto &l: lines) {
+                    Robot r;
+                    r.setFromString(l);
+                    bench::doNotOptimize(r.pos.coord.x);
+                }
+            }
+        };
+    });
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    bench::Runner runner;
+    string outFile, baselineFile;
+    double tolerance = 0.1, minSkipped = -1.0;
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--filter" && hasValue) {
+            runner.filter = argv[++i];
+        } else if (arg == "--min-time" && hasValue) {
+            runner.minTime = static_cast<nanoTime>(atof(argv[++i]) * 1e6);
+        } else if (arg == "--out" && hasValue) {
+            outFile = argv[++i];
+        } else if (arg == "--baseline" && hasValue) {
+            baselineFile = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else if (arg == "--min-skipped" && hasValue) {
+            minSkipped = atof(argv[++i]);
+        } else {
+            cerr << "unknown argument " << arg << endl;
+            return 2;
+        }
+    }
+
+    registerAll(runner);
+    vector<bench::Result> results = runner.run();
+
+    map<string, string> context = {{"compiler", __VERSION__},
+#ifdef NDEBUG
+        {"asserts", "off"},
+#else
+        {"asserts", "on"},
+#endif
+        {"simd", simdLevelName(simdLevel())},
+    };
+    if (!outFile.empty()) {
+        ofstream out(outFile);
+        bench::writeJson(out, results, context);
+        cout << "wrote " << results.size() << " results to " << outFile << endl;
+    } else {
+        bench::writeJson(cout, results, context);
+    }
+
+    if (minSkipped >= 0.0) {
+        const double skipped = prunedShare();
+        cout << "pruned: " << 100.0 * skipped << "% of the likelihoods skipped" << endl;
+        if (skipped < minSkipped) {
+            cout << "FAIL: early exit skips less than " << 100.0 * minSkipped << "%" << endl;
+            return 1;
+        }
+    }
+
+    if (!baselineFile.empty()) {
+        int regressions = bench::compare(results, bench::readJson(baselineFile), tolerance);
+        return (regressions > 0) ? 1 : 0;
+    }
+    return 0;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,225 @@
+/**
+ * replays a parsed log through a particle filter, the same way
+ * particlefiltertest does, and records the estimated pose, the ground truth
+ * and the update time of every cognition step.
+ */
+#pragma once
+
+#include <logdataprocessor.hpp>
+
+#include <particlefilter.h>
+#include <platform.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// field size by name: jrl, spl, htwk, tiny, spl2020
+inline bool parseFieldSize(const std::string &name, FieldSize &size) {
+    static const std::pair<const char *, FieldSize> names[] = {
+        {"jrl", FieldSize::JRL}, {"spl", FieldSize::SPL}, {"htwk", FieldSize::HTWK},
+        {"tiny", FieldSize::TINY}, {"spl2020", FieldSize::SPL2020}
+    };
+    for (const auto &n: names) {
+        if (name == n.first) {
+            size = n.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct ReplayStep {
+    DirectedCoord pose; // filter output
+    DirectedCoord gt; // ground truth of the log
+    nanoTime updateTime; // duration of ParticleFilter::update
+    std::vector<ParticleFilter::tLocalizationEvent> events;
+    int stamp; // of the cognition step
+    // measurement model work of the step (see ParticleFilter::MeasurementStats)
+    uint64_t likelihoods, skipped;
+};
+
+// LogSteps is a range of LogData, e.g. a LogReader or LogDataset::data.
+// stats (optional) gets the measurement model work of the whole replay.
+// kidnapStep > 0 moves all particles 2 m and a quarter turn away from
+// the estimate before that step (relocalisation tests), scatterStep > 0
+// spreads them uniformly over the field (no pose information at all, float
+// particles only)
+template<typename LogSteps>
+std::vector<ReplayStep> replayLog(LogSteps &&data, const ParticleFilter::Settings &conf,
+                                  ParticleFilter::MeasurementStats *stats = nullptr,
+                                  size_t kidnapStep = 0, size_t scatterStep = 0) {
+    std::vector<ReplayStep> steps;
+
+    ParticleFilter loca(conf);
+    loca.emit_event(ParticleFilter::EV_INTIAL);
+    DirectedCoord odometry(0.0f, 0.0f, 0.0f);
+
+    std::pair<std::vector<DirectedCoord>, int> poseEstimates;
+    for (const LogData &d: data) {
+        for (auto event: d.event) {
+            loca.emit_event(event);
+        }
+        if (!d.odo.empty()) {
+            odometry = d.odo.at(0);
+        }
+        poseEstimates.first.clear();
+        poseEstimates.second = 1;
+        for (const auto &r: d.poseEstimates) {
+            poseEstimates.first.push_back(r.pos);
+        }
+
+        if (kidnapStep > 0 && steps.size() == kidnapStep) {
+            const DirectedCoord p = loca.get_position();
+            const float x = (p.coord.x > 0.0f) ? p.coord.x - 2.0f : p.coord.x + 2.0f;
+            loca.setPosition(DirectedCoord(x, p.coord.y, p.angle.rad + 0.5f * M_PI_F));
+        }
+        if (scatterStep > 0 && steps.size() == scatterStep && !conf.compactParticles) {
+            std::mt19937 rng(conf.seed);
+            const float length = conf.pf->_lengthInsideBounds, width = conf.pf->_widthInsideBounds;
+            std::uniform_real_distribution<float> x(-0.5f * length, 0.5f * length);
+            std::uniform_real_distribution<float> y(-0.5f * width, 0.5f * width);
+            std::uniform_real_distribution<float> a(-M_PI_F, M_PI_F);
+            for (auto &particle: loca.particles) {
+                particle.setParticle(DirectedCoord(x(rng), y(rng), a(rng)),
+                                     1.0f / loca.particles.size());
+            }
+        }
+        const ParticleFilter::MeasurementStats before = loca.measurementStats;
+
+        nanoTime start = getMonotonicNanoTime();
+        loca.update(d.visionResults, odometry, poseEstimates);
+        nanoTime duration = getMonotonicNanoTime() - start;
+
+        steps.push_back({loca.get_position(), d.wcs.GTpos, duration, d.event, d.stamp,
+                         loca.measurementStats.likelihoods - before.likelihoods,
+                         loca.measurementStats.skipped - before.skipped});
+    }
+    if (stats) {
+        *stats = loca.measurementStats;
+    }
+    return steps;
+}
+
+// distance of estimated and ground truth position
+inline float positionError(const ReplayStep &s) {
+    return s.pose.coord.dist(s.gt.coord);
+}
+
+// absolute heading error in rad [0 ... pi]
+inline float headingError(const ReplayStep &s) {
+    return fabsf(Angle(s.pose.angle.rad - s.gt.angle.rad).rad);
+}
+
+inline float meanPositionError(const std::vector<ReplayStep> &steps) {
+    if (steps.empty()) {
+        return 0.0f;
+    }
+    double sum = 0.0;
+    for (const auto &s: steps) {
+        sum += positionError(s);
+    }
+    return static_cast<float>(sum / steps.size());
+}
+
+// p-th percentile (p = [0 ... 1]), reorders v
+template<typename T>
+T percentile(std::vector<T> &v, float p) {
+    if (v.empty()) {
+        return T();
+    }
+    size_t i = std::min(v.size() - 1, static_cast<size_t>(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+// p-th percentile (p = [0 ... 1]) of the update times
+inline nanoTime updateTimePercentile(const std::vector<ReplayStep> &steps, float p) {
+    if (steps.empty()) {
+        return 0;
+    }
+    std::vector<nanoTime> t;
+    t.reserve(steps.size());
+    for (const auto &s: steps) {
+        t.push_back(s.updateTime);
+    }
+    return percentile(t, p);
+}
+
+// accuracy and cost of one or more replays
+struct ReplayScore {
+    size_t steps = 0;
+    float meanPosition = 0.0f, p95Position = 0.0f; // m
+    float meanHeading = 0.0f, p95Heading = 0.0f; // rad
+    float frameP50 = 0.0f, frameP99 = 0.0f; // us per update
+};
+
+// collects the per step errors and update times of several replays
+class ReplayStats {
+public:
+    void add(const std::vector<ReplayStep> &steps) {
+        for (const auto &s: steps) {
+            position.push_back(positionError(s));
+            heading.push_back(headingError(s));
+            time.push_back(s.updateTime);
+        }
+    }
+
+    void add(const ReplayStats &other) {
+        position.insert(position.end(), other.position.begin(), other.position.end());
+        heading.insert(heading.end(), other.heading.begin(), other.heading.end());
+        time.insert(time.end(), other.time.begin(), other.time.end());
+    }
+
+    ReplayScore score() const {
+        ReplayScore r;
+        r.steps = position.size();
+        if (position.empty()) {
+            return r;
+        }
+        std::vector<float> pos(position), head(heading);
+        std::vector<nanoTime> t(time);
+        double posSum = 0.0, headSum = 0.0;
+        for (size_t i = 0; i < pos.size(); ++i) {
+            posSum += pos[i];
+            headSum += head[i];
+        }
+        r.meanPosition = static_cast<float>(posSum / pos.size());
+        r.meanHeading = static_cast<float>(headSum / head.size());
+        r.p95Position = percentile(pos, 0.95f);
+        r.p95Heading = percentile(head, 0.95f);
+        r.frameP50 = percentile(t, 0.5f) / 1000.0f;
+        r.frameP99 = percentile(t, 0.99f) / 1000.0f;
+        return r;
+    }
+
+private:
+    std::vector<float> position, heading;
+    std::vector<nanoTime> time;
+};
+
+// runs fn(i) for i = [0 ... n) on 'threads' threads
+template<typename Fn>
+void parallelFor(size_t n, unsigned int threads, Fn fn) {
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < n;) {
+            fn(i);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < std::max(1u, threads); ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &t: pool) {
+        t.join();
+    }
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
@@ -0,0 +1,307 @@
+/**
+ * deterministic golden replay regression test
+ *
+ * replays a log with a seeded filter and compares the pose trajectory
+ * against a stored golden trajectory:
+ *  - a frame is an outlier if position or heading deviate more than the
+ *    tolerance from the golden frame, only a small share of outliers is ok
+ *  - the mean position error against the ground truth must not get worse
+ *    than the golden one by more than the accuracy tolerance
+ * update timing is reported against the golden run, but never fails.
+ *
+ * usage: particlefilterreplay --log <log> --golden <file> [--update-golden]
+ *            [--seed 1] [--particles 50] [--compact]
+ *            [--tolerance 0.3] [--max-outliers 0.05] [--accuracy-tolerance 0.03]
+ *            [--prune <share> [--min-skipped <share>]] [--refine <share> [--coarse 1]]
+ *            [--kidnap <step> [--max-recovery <steps>]] [--global-fit <fit>]
+ *            [--scatter <step>] [--metrics <json>]
+ *
+ * --prune sets Settings::pruneShare (early exit in the measurement model),
+ * --refine/--coarse Settings::refineShare/coarseObservations (two stage
+ * measurement model). the share of evaluated likelihoods is reported
+ * next to the accuracy, --min-skipped fails if the early exit skips less
+ * (in the scattered step with --scatter, else in the whole replay).
+ * --scatter spreads the particles uniformly over the field before the
+ * given step: a converged filter has no particles to prune, a lost one
+ * has (use with a golden of the same scenario).
+ * --kidnap moves the particles away before the given step and reports
+ * the steps until the estimate is back within 0.5 m, --max-recovery fails
+ * if that takes more steps. the mean error of these steps is the kidnapping,
+ * not the filter: they are left out of the accuracy comparison.
+ * --global-fit sets Settings::globalFit (automatic global relocalisation,
+ * 0 = off).
+ * --metrics writes the accuracy metrics of the replay (see metrics.hpp).
+ * with PF_SIMD_LEVEL set to a level this cpu can not run, the replay is
+ * skipped (exit code 77) instead of silently using another level.
+ */
+#include <metrics.hpp>
+#include <replay.hpp>
+#include <simd.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+struct Golden {
+    float meanError = 0.0f;
+    float updateP50us = 0.0f;
+    vector<DirectedCoord> poses;
+};
+
+bool readGolden(const string &fn, Golden &g) {
+    ifstream in(fn);
+    if (!in) {
+        return false;
+    }
+    for (string line; getline(in, line);) {
+        if (line.empty()) {
+            continue;
+        }
+        if (line[0] == '#') {
+            size_t p = line.find("mean_error: ");
+            if (p != string::npos) {
+                g.meanError = stof(line.substr(p + 12));
+            }
+            p = line.find("update_p50_us: ");
+            if (p != string::npos) {
+                g.updateP50us = stof(line.substr(p + 15));
+            }
+            continue;
+        }
+        istringstream s(line);
+        int step;
+        float x, y, a;
+        if (s >> step >> x >> y >> a) {
+            g.poses.emplace_back(x, y, a);
+        }
+    }
+    return true;
+}
+
+void writeGolden(const string &fn, const string &log, unsigned int seed,
+                 size_t particles, const vector<ReplayStep> &steps) {
+    ofstream out(fn);
+    out << "# particlefilter golden replay v1\n";
+    out << "# log: " << log.substr(log.find_last_of('/') + 1) << " seed: " << seed
+        << " particles: " << particles << "\n";
+    out << "# mean_error: " << meanPositionError(steps) << " update_p50_us: "
+        << updateTimePercentile(steps, 0.5f) / 1000.0 << "\n";
+    out << "# step x y theta\n";
+    out << setprecision(6);
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const auto &p = steps[i].pose;
+        out << i << " " << p.coord.x << " " << p.coord.y << " " << p.angle.rad << "\n";
+    }
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    string logFile, goldenFile, metricsFile;
+    bool updateGolden = false, compactParticles = false;
+    unsigned int seed = 1;
+    size_t particles = 50;
+    float tolerance = 0.3f, maxOutliers = 0.05f, accuracyTolerance = 0.03f;
+    float pruneShare = 0.0f, refineShare = 0.0f, minSkipped = 0.0f;
+    size_t coarseObservations = 1, kidnapStep = 0, maxRecovery = 0, scatterStep = 0;
+    float globalFit = -1.0f; // < 0: Settings default
+
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg == "--update-golden") {
+            updateGolden = true;
+        } else if (arg == "--compact") {
+            compactParticles = true;
+        } else if (arg == "--log" && hasValue) {
+            logFile = argv[++i];
+        } else if (arg == "--golden" && hasValue) {
+            goldenFile = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            seed = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (arg == "--particles" && hasValue) {
+            particles = static_cast<size_t>(atoi(argv[++i]));
+        } else if (arg == "--tolerance" && hasValue) {
+            tolerance = atof(argv[++i]);
+        } else if (arg == "--max-outliers" && hasValue) {
+            maxOutliers = atof(argv[++i]);
+        } else if (arg == "--accuracy-tolerance" && hasValue) {
+            accuracyTolerance = atof(argv[++i]);
+        } else if (arg == "--prune" && hasValue) {
+            pruneShare = atof(argv[++i]);
+        } else if (arg == "--min-skipped" && hasValue) {
+            minSkipped = atof(argv[++i]);
+        } else if (arg == "--scatter" && hasValue) {
+            scatterStep = static_cast<size_t>(atoi(argv[++i]));
+        } else if (arg == "--refine" && hasValue) {
+            refineShare = atof(argv[++i]);
+        } else if (arg == "--coarse" && hasValue) {
+            coarseObservations = static_cast<size_t>(atoi(argv[++i]));
+        } else if (arg == "--kidnap" && hasValue) {
+            kidnapStep = static_cast<size_t>(atoi(argv[++i]));
+        } else if (arg == "--max-recovery" && hasValue) {
+            maxRecovery = static_cast<size_t>(atoi(argv[++i]));
+        } else if (arg == "--global-fit" && hasValue) {
+            globalFit = atof(argv[++i]);
+        } else if (arg == "--metrics" && hasValue) {
+            metricsFile = argv[++i];
+        } else {
+            cerr << "unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+    if (logFile.empty() || goldenFile.empty()) {
+        cerr << "usage: " << argv[0] << " --log <log> --golden <file> [--update-golden]"
+             << "\n";
+        return 2;
+    }
+    if (scatterStep > 0 && compactParticles) {
+        cerr << "--scatter needs float particles, not --compact" << "\n";
+        return 2;
+    }
+    const char *forcedLevel = getenv("PF_SIMD_LEVEL");
+    if (forcedLevel && string(forcedLevel) != simdLevelName(simdLevel())) {
+        cout << "SKIP: PF_SIMD_LEVEL=" << forcedLevel << " is not supported here" << "\n";
+        return 77;
+    }
+
+    PlayingField field(FieldSize::JRL);
+    ParticleFilter::Settings conf(&field);
+    conf.numParticles = particles;
+    conf.robot_id = 2;
+    conf.seed = seed;
+    conf.compactParticles = compactParticles;
+    conf.pruneShare = pruneShare;
+    conf.refineShare = refineShare;
+    conf.coarseObservations = coarseObservations;
+    if (globalFit >= 0.0f) {
+        conf.globalFit = globalFit;
+    }
+
+    ParticleFilter::MeasurementStats stats;
+    LogReader reader(logFile);
+    vector<ReplayStep> steps = replayLog(reader, conf, &stats, kidnapStep, scatterStep);
+    if (!reader.error().empty()) {
+        cerr << reader.error() << "\n";
+        return 2;
+    }
+    if (steps.empty()) {
+        cerr << "no cognition steps in " << logFile << "\n";
+        return 2;
+    }
+    if (!metricsFile.empty()) {
+        Metrics metrics;
+        for (const auto &s: steps) {
+            metrics.add(s);
+        }
+        ofstream out(metricsFile);
+        metrics.writeJson(out);
+    }
+    // with --kidnap: the steps from the kidnapping until the estimate is back
+    // within 0.5 m. they are bounded by --max-recovery, the accuracy is
+    // compared on the other steps only
+    size_t back = kidnapStep;
+    if (kidnapStep > 0) {
+        while (back < steps.size() && positionError(steps[back]) > 0.5f) {
+            ++back;
+        }
+    }
+    vector<ReplayStep> tracked(steps.begin(), steps.begin() + min(kidnapStep, steps.size()));
+    tracked.insert(tracked.end(), steps.begin() + min(back, steps.size()), steps.end());
+    float meanError = meanPositionError(tracked);
+    float p50 = updateTimePercentile(steps, 0.5f) / 1000.0f;
+
+    if (updateGolden) {
+        writeGolden(goldenFile, logFile, seed, particles, steps);
+        cout << "wrote golden trajectory with " << steps.size() << " steps, mean error "
+             << meanError << " to " << goldenFile << "\n";
+        return 0;
+    }
+
+    Golden golden;
+    if (!readGolden(goldenFile, golden)) {
+        cerr << "can not read golden file " << goldenFile << "\n";
+        return 2;
+    }
+    if (golden.poses.size() != steps.size()) {
+        cout << "FAIL: golden has " << golden.poses.size() << " steps, replay "
+             << steps.size() << "\n";
+        return 1;
+    }
+
+    size_t outliers = 0;
+    float maxDeviation = 0.0f;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        float dev = steps[i].pose.coord.dist(golden.poses[i].coord);
+        float angleDev = fabsf(Angle(steps[i].pose.angle.rad - golden.poses[i].angle.rad).rad);
+        maxDeviation = max(maxDeviation, dev);
+        if (dev > tolerance || angleDev > tolerance) {
+            ++outliers;
+        }
+    }
+    float outlierShare = static_cast<float>(outliers) / steps.size();
+    float accuracyDelta = meanError - golden.meanError;
+
+    cout << "steps:              " << steps.size() << "\n";
+    cout << "mean error:         " << meanError << " m (golden " << golden.meanError
+         << ", delta " << accuracyDelta << ")" << "\n";
+    cout << "trajectory:         " << outliers << " frames off by > " << tolerance
+         << " (" << 100.0f * outlierShare << "%), max deviation " << maxDeviation << " m"
+         << "\n";
+    cout << "update p50:         " << p50 << " us (golden " << golden.updateP50us
+         << ", delta " << p50 - golden.updateP50us << ")" << "\n";
+    size_t recovery = 0; // steps, 0 = not kidnapped or not recovered
+    if (kidnapStep > 0 && kidnapStep < steps.size()) {
+        cout << "kidnapped:          before step " << kidnapStep << ", ";
+        if (back < steps.size()) {
+            recovery = back - kidnapStep + 1;
+            cout << "back within 0.5 m after " << recovery << " steps" << "\n";
+        } else {
+            cout << "not recovered" << "\n";
+        }
+    }
+    const uint64_t likelihoods = stats.likelihoods + stats.skipped;
+    cout << "likelihoods:        " << stats.likelihoods << " of " << likelihoods << " ("
+         << (likelihoods ? 100.0f * stats.likelihoods / likelihoods : 0.0f) << "%), "
+         << stats.pruned << " of " << stats.particles << " particles pruned" << "\n";
+    float skippedShare = likelihoods ? static_cast<float>(stats.skipped) / likelihoods : 0.0f;
+    if (scatterStep > 0 && scatterStep < steps.size()) {
+        const ReplayStep &s = steps[scatterStep];
+        skippedShare = (s.likelihoods + s.skipped)
+                       ? static_cast<float>(s.skipped) / (s.likelihoods + s.skipped) : 0.0f;
+        cout << "scattered:          before step " << scatterStep << ", "
+             << 100.0f * skippedShare << "% of its likelihoods skipped" << "\n";
+    }
+
+    bool ok = true;
+    if (outlierShare > maxOutliers) {
+        cout << "FAIL: trajectory deviates from golden in too many frames" << "\n";
+        ok = false;
+    }
+    if (accuracyDelta > accuracyTolerance) {
+        cout << "FAIL: localization error got worse" << "\n";
+        ok = false;
+    }
+    if (skippedShare < minSkipped) {
+        cout << "FAIL: early exit skips less than " << 100.0f * minSkipped << "% of the likelihoods"
+             << "\n";
+        ok = false;
+    }
+    if (maxRecovery > 0 && (recovery == 0 || recovery > maxRecovery)) {
+        cout << "FAIL: not back within " << maxRecovery << " steps after the kidnapping" << "\n";
+        ok = false;
+    }
+    if (ok) {
+        cout << "PASS" << "\n";
+    }
+    return ok ? 0 : 1;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
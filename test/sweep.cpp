@@ -0,0 +1,279 @@
+/**
+ * parameter sweep: replays ground truth logs with every combination of a
+ * parameter grid in parallel and prints accuracy against cost.
+ *
+ * the logs are parsed once and shared read-only between the worker
+ * threads, every task (configuration x log x seed) runs its own filter.
+ * a configuration is on the pareto front ('*') if no other one has both
+ * a smaller mean position error and a smaller p50 frame time.
+ * with many threads the frame times include contention, use --threads 1
+ * for reliable timings.
+ *
+ * usage: particlefiltersweep <log>... [--particles 25,50,100]
+ *            [--odo-stdev 0.01] [--prob-dev 0.8] [--replacement-share 0.02]
+ *            [--seeds 1] [--threads <cores>] [--field jrl] [--robot-id 2]
+ *            [--target <m>] [--csv <file>] [--json <file>]
+ *
+ *  --odo-stdev s          odoStdev = (s, s, s/2)
+ *  --replacement-share s  replacementShare = s, replacementShareMulti = 2.5 s
+ *  --target m             print the cheapest configuration with mean error <= m
+ *  --json file            full metrics (metrics.hpp) of every configuration
+ */
+#include <metrics.hpp>
+#include <replay.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct SweepConfig {
+    size_t particles;
+    float odoStdev;
+    float probDeviation;
+    float replacementShare;
+};
+
+struct SweepResult {
+    SweepConfig config;
+    ReplayScore score;
+    bool pareto;
+    Metrics metrics;
+};
+
+vector<float> parseList(const string &s) {
+    vector<float> ret;
+    istringstream in(s);
+    for (string v; getline(in, v, ',');) {
+        ret.push_back(stof(v));
+    }
+    return ret;
+}
+
+ParticleFilter::Settings makeSettings(PlayingField *field, int robotId, const SweepConfig &c,
+                                      unsigned int seed) {
+    ParticleFilter::Settings conf(field);
+    conf.robot_id = robotId;
+    conf.numParticles = c.particles;
+    conf.odoStdev = DirectedCoord(c.odoStdev, c.odoStdev, c.odoStdev / 2.0f);
+    conf.probDeviation = c.probDeviation;
+    conf.replacementShare = c.replacementShare;
+    conf.replacementShareMulti = 2.5f * c.replacementShare;
+    conf.seed = seed;
+    return conf;
+}
+
+void markPareto(vector<SweepResult> &results) {
+    for (auto &r: results) {
+        r.pareto = true;
+        for (const auto &o: results) {
+            bool noWorse = o.score.meanPosition <= r.score.meanPosition &&
+                           o.score.frameP50 <= r.score.frameP50;
+            bool better = o.score.meanPosition < r.score.meanPosition ||
+                          o.score.frameP50 < r.score.frameP50;
+            if (noWorse && better) {
+                r.pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+void printTable(ostream &out, const vector<SweepResult> &results) {
+    out << setw(9) << "particles" << setw(10) << "odoStdev" << setw(9) << "probDev"
+        << setw(8) << "share" << setw(9) << "steps" << setw(10) << "pos mean"
+        << setw(9) << "pos p95" << setw(10) << "head mean" << setw(9) << "head p95"
+        << setw(10) << "p50 us" << setw(10) << "p99 us" << "  pareto\n";
+    out << fixed;
+    for (const auto &r: results) {
+        const auto &c = r.config;
+        const auto &s = r.score;
+        out << setw(9) << c.particles << setprecision(4) << setw(10) << c.odoStdev
+            << setprecision(2) << setw(9) << c.probDeviation << setprecision(3)
+            << setw(8) << c.replacementShare << setw(9) << s.steps
+            << setw(10) << s.meanPosition << setw(9) << s.p95Position
+            << setprecision(1) << setw(10) << s.meanHeading * 180.0f / M_PI_F
+            << setw(9) << s.p95Heading * 180.0f / M_PI_F
+            << setw(10) << s.frameP50 << setw(10) << s.frameP99
+            << (r.pareto ? "  *" : "") << "\n";
+    }
+    out << "(position error in m, heading error in deg, frame time per update)\n";
+    out << defaultfloat << setprecision(6);
+}
+
+void writeCsv(const string &fn, const vector<SweepResult> &results) {
+    ofstream out(fn);
+    out << "particles,odo_stdev,prob_dev,replacement_share,steps,pos_mean,pos_p95,"
+        << "heading_mean,heading_p95,frame_p50_us,frame_p99_us,pareto\n";
+    for (const auto &r: results) {
+        const auto &c = r.config;
+        const auto &s = r.score;
+        out << c.particles << "," << c.odoStdev << "," << c.probDeviation << ","
+            << c.replacementShare << "," << s.steps << "," << s.meanPosition << ","
+            << s.p95Position << "," << s.meanHeading << "," << s.p95Heading << ","
+            << s.frameP50 << "," << s.frameP99 << "," << (r.pareto ? 1 : 0) << "\n";
+    }
+}
+
+void writeJson(const string &fn, const vector<SweepResult> &results) {
+    ofstream out(fn);
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto &c = results[i].config;
+        out << "{\"particles\": " << c.particles << ", \"odo_stdev\": " << c.odoStdev
+            << ", \"prob_dev\": " << c.probDeviation << ", \"replacement_share\": "
+            << c.replacementShare << ", \"pareto\": " << (results[i].pareto ? "true" : "false")
+            << ",\n\"metrics\": ";
+        results[i].metrics.writeJson(out);
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+}
+
+int main(int argc, const char *argv[]) {
+    vector<string> logFiles;
+    vector<float> particles = {25, 50, 100};
+    vector<float> odoStdevs = {0.01f}, probDeviations = {0.8f}, shares = {0.02f};
+    unsigned int seeds = 1;
+    unsigned int threads = std::max(1u, thread::hardware_concurrency());
+    FieldSize fieldSize = FieldSize::JRL;
+    int robotId = 2;
+    float target = -1.0f;
+    string csvFile, jsonFile;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg(argv[i]);
+        bool hasValue = (i + 1 < argc);
+        if (arg.substr(0, 2) != "--") {
+            logFiles.push_back(arg);
+        } else if (arg == "--particles" && hasValue) {
+            particles = parseList(argv[++i]);
+        } else if (arg == "--odo-stdev" && hasValue) {
+            odoStdevs = parseList(argv[++i]);
+        } else if (arg == "--prob-dev" && hasValue) {
+            probDeviations = parseList(argv[++i]);
+        } else if (arg == "--replacement-share" && hasValue) {
+            shares = parseList(argv[++i]);
+        } else if (arg == "--seeds" && hasValue) {
+            seeds = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<unsigned int>(atoi(argv[++i]));
+        } else if (arg == "--field" && hasValue) {
+            if (!parseFieldSize(argv[++i], fieldSize)) {
+                cerr << "unknown field " << argv[i] << "\n";
+                return 2;
+            }
+        } else if (arg == "--robot-id" && hasValue) {
+            robotId = atoi(argv[++i]);
+        } else if (arg == "--target" && hasValue) {
+            target = atof(argv[++i]);
+        } else if (arg == "--csv" && hasValue) {
+            csvFile = argv[++i];
+        } else if (arg == "--json" && hasValue) {
+            jsonFile = argv[++i];
+        } else {
+            cerr << "unknown argument " << arg << "\n";
+            return 2;
+        }
+    }
+    if (logFiles.empty()) {
+        cerr << "usage: " << argv[0] << " <log>... [--particles 25,50,100] [--odo-stdev 0.01]"
+             << " [--prob-dev 0.8] [--replacement-share 0.02] [--seeds 1] [--threads n]"
+             << " [--field jrl] [--robot-id 2] [--target m] [--csv file] [--json file]\n";
+        return 2;
+    }
+    // unhandled event warnings of every task are not interesting here
+    consoleLog().setLevel(LogLevel::ERROR);
+
+    // parsed once, shared read-only by all tasks
+    vector<LogDataset> logs;
+    logs.reserve(logFiles.size());
+    for (const auto &fn: logFiles) {
+        logs.emplace_back(fn);
+        if (!logs.back().error.empty()) {
+            cerr << logs.back().error << "\n";
+            return 2;
+        }
+        if (logs.back().data.empty()) {
+            cerr << "no cognition steps in " << fn << "\n";
+            return 2;
+        }
+    }
+    PlayingField field(fieldSize);
+
+    vector<SweepConfig> configs;
+    for (float p: particles) {
+        for (float o: odoStdevs) {
+            for (float d: probDeviations) {
+                for (float s: shares) {
+                    configs.push_back({static_cast<size_t>(p), o, d, s});
+                }
+            }
+        }
+    }
+
+    // one task per configuration, log and seed
+    size_t tasksPerConfig = logs.size() * seeds;
+    vector<ReplayStats> stats(configs.size() * tasksPerConfig);
+    vector<Metrics> metrics(stats.size());
+    cout << "sweeping " << configs.size() << " configurations over " << logs.size()
+         << " logs and " << seeds << " seeds on " << threads << " threads\n" << flush;
+    parallelFor(stats.size(), threads, [&](size_t task) {
+        const SweepConfig &c = configs[task / tasksPerConfig];
+        size_t log = (task % tasksPerConfig) / seeds;
+        unsigned int seed = 1 + task % seeds;
+        auto steps = replayLog(logs[log].data, makeSettings(&field, robotId, c, seed));
+        stats[task].add(steps);
+        for (const auto &s: steps) {
+            metrics[task].add(s);
+        }
+    });
+
+    vector<SweepResult> results;
+    for (size_t i = 0; i < configs.size(); ++i) {
+        ReplayStats all;
+        Metrics allMetrics;
+        for (size_t t = 0; t < tasksPerConfig; ++t) {
+            all.add(stats[i * tasksPerConfig + t]);
+            allMetrics.merge(metrics[i * tasksPerConfig + t]);
+        }
+        results.push_back({configs[i], all.score(), false, allMetrics});
+    }
+    markPareto(results);
+    printTable(cout, results);
+    if (!csvFile.empty()) {
+        writeCsv(csvFile, results);
+    }
+    if (!jsonFile.empty()) {
+        writeJson(jsonFile, results);
+    }
+
+    if (target > 0.0f) {
+        const SweepResult *best = nullptr;
+        for (const auto &r: results) {
+            if (r.score.meanPosition <= target &&
+                    (!best || r.score.frameP50 < best->score.frameP50)) {
+                best = &r;
+            }
+        }
+        if (!best) {
+            cout << "no configuration reaches a mean error of " << target << " m\n";
+            return 1;
+        }
+        cout << "cheapest configuration with mean error <= " << target << " m: "
+             << best->config.particles << " particles, odoStdev " << best->config.odoStdev
+             << ", probDeviation " << best->config.probDeviation << ", replacementShare "
+             << best->config.replacementShare << "\n";
+    }
+    return 0;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab:
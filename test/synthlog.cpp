@@ -0,0 +1,179 @@
+/**
+ * generates a deterministic synthetic log (same text format as the robot logs)
+ * for regression tests: a robot walks a fixed path over the JRL field, gets
+ * penalized once and sees noisy lines, crosses and the center circle.
+ * the ground truth pose is stored in the WCS line of every cognition step.
+ *
+ * usage: particlefiltersynthlog <out.log> [steps = 600]
+ */
+#include <coords.h>
+#include <definitions.h>
+#include <particlefilter.h>
+#include <playingfield.h>
+#include <visiondefinitions.h>
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const float VISION_RANGE = 3.5f;
+const float FIELD_OF_VIEW = 0.9f; // half opening angle, rad
+
+bool visible(const Coord &rcs, float range) {
+    float d = rcs.dist();
+    return (d > 0.3f) && (d < range) && (fabsf(rcs.angle().rad) < FIELD_OF_VIEW);
+}
+
+// waypoints the robot walks along (wcs, m)
+const vector<Coord> waypoints = {
+    {-1.5f, -1.0f}, {-0.5f, 0.0f}, {0.8f, 0.6f}, {1.8f, -0.4f},
+    {1.0f, -1.2f}, {-0.6f, -0.8f}, {-2.0f, 0.5f}, {-1.0f, 1.2f},
+    {0.5f, 0.9f}, {2.0f, 0.2f}, {1.2f, -0.6f}, {-0.4f, 0.2f}
+};
+
+}
+
+int main(int argc, const char *argv[]) {
+    string fn = (argc > 1) ? argv[1] : "synthetic.log";
+    // longer logs repeat the walk, e.g. to check memory usage
+    const int STEPS = (argc > 2) ? atoi(argv[2]) : 600;
+    ofstream out(fn);
+
+    PlayingField pf(FieldSize::JRL);
+    const FieldModel &field = pf.model();
+
+    mt19937 rng(4711);
+    normal_distribution<float> visionNoise(0.0f, 0.05f);
+    normal_distribution<float> angleNoise(0.0f, 0.03f);
+    normal_distribution<float> odoNoise(0.0f, 0.004f);
+    uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    // robot 2 starts at its initial position at the side line
+    DirectedCoord gt = pf.getInitialPose().at(2);
+    DirectedCoord mcs(0.0f, 0.0f, 0.0f);
+    size_t target = 0;
+
+    const int penalizedAt = 320;
+    const int unpenalizedAt = 360;
+
+    for (int step = 0; step < STEPS; ++step) {
+        int stamp = step * 33;
+        string prefix = "(" + to_string(stamp) + ") ";
+        out << prefix << "enter new cognition step: " << step << endl;
+
+        vector<ParticleFilter::tLocalizationEvent> events;
+        if (step == 1) {
+            events.push_back(ParticleFilter::EV_STATE_READY);
+        } else if (step == 2) {
+            events.push_back(ParticleFilter::EV_STATE_PLAYING);
+        } else if (step == penalizedAt) {
+            events.push_back(ParticleFilter::EV_PENALIZED);
+        } else if (step == unpenalizedAt) {
+            // placed at the sideline by the referee
+            gt = pf.getUnpenalizedPose().at(0);
+            events.push_back(ParticleFilter::EV_UNPENALIZED);
+        }
+
+        // walk, unless penalized
+        bool penalized = (step >= penalizedAt) && (step < unpenalizedAt);
+        if (step > 2 && !penalized) {
+            Coord rcsTarget = DirectedCoord(waypoints[target], Angle()).toRCS(gt).coord;
+            if (rcsTarget.dist() < 0.2f) {
+                target = (target + 1) % waypoints.size();
+            }
+            float turn = clip(rcsTarget.angle().rad, -0.08f, 0.08f);
+            float forward = (fabsf(rcsTarget.angle().rad) < 0.6f) ? 0.025f : 0.005f;
+            DirectedCoord delta(forward, 0.0f, turn);
+            gt = gt.walk(delta);
+            // odometry with drift
+            mcs = mcs.walk(DirectedCoord(forward * 1.05f + odoNoise(rng),
+                                         odoNoise(rng), turn + odoNoise(rng)));
+        }
+
+        Robot wcs;
+        wcs.timestamp = stamp;
+        wcs.GTpos = gt;
+        wcs.GTconfidence = 1.0f;
+        out << prefix << "WCS: " << wcs << endl;
+
+        // lines: visible part of every long field line
+        for (const auto &line: field.lines) {
+            Coord start(line.start_x, line.start_y);
+            Coord end(line.end_x, line.end_y);
+            float length = start.dist(end);
+            if (length < 0.01f) {
+                continue;
+            }
+            bool found = false;
+            Coord first, last;
+            for (float t = 0.0f; t <= length; t += 0.05f) {
+                Coord p = start + (t / length) * (end - start);
+                Coord rcs = DirectedCoord(p, Angle()).toRCS(gt).coord;
+                if (visible(rcs, VISION_RANGE)) {
+                    if (!found) {
+                        first = rcs;
+                    }
+                    last = rcs;
+                    found = true;
+                }
+            }
+            if (!found || first.dist(last) < 0.8f || uniform(rng) < 0.2f) {
+                continue;
+            }
+            VisionResult vr;
+            vr.type = JSVISION_LINE;
+            vr.timestamp = stamp;
+            vr.rcs_x1 = first.x + visionNoise(rng);
+            vr.rcs_y1 = first.y + visionNoise(rng);
+            vr.rcs_x2 = last.x + visionNoise(rng);
+            vr.rcs_y2 = last.y + visionNoise(rng);
+            out << prefix << "VisionResult: " << vr << endl;
+        }
+
+        // crosses
+        for (const auto &cross: field.crosses) {
+            Coord rcs = DirectedCoord(cross.wcs_x, cross.wcs_y, 0.0f).toRCS(gt).coord;
+            if (!visible(rcs, VISION_RANGE) || uniform(rng) < 0.3f) {
+                continue;
+            }
+            VisionResult vr;
+            vr.type = (cross.degree == 2) ? JSVISION_LCROSS :
+                      (cross.degree == 3) ? JSVISION_TCROSS : JSVISION_XCROSS;
+            vr.timestamp = stamp;
+            vr.rcs_distance = rcs.dist() + visionNoise(rng);
+            vr.rcs_alpha = rcs.angle().rad + angleNoise(rng);
+            vr.extra_float = Angle(cross.wcs_alpha - gt.angle.rad + angleNoise(rng)).rad;
+            out << prefix << "VisionResult: " << vr << endl;
+        }
+
+        // center circle
+        Coord center = DirectedCoord(0.0f, 0.0f, 0.0f).toRCS(gt).coord;
+        if (visible(center, 2.5f) && uniform(rng) < 0.7f) {
+            VisionResult vr;
+            vr.type = JSVISION_CIRCLE;
+            vr.timestamp = stamp;
+            vr.rcs_distance = center.dist() + visionNoise(rng);
+            vr.rcs_alpha = center.angle().rad + angleNoise(rng);
+            out << prefix << "VisionResult: " << vr << endl;
+        }
+
+        out << prefix << "Odometry: " << mcs.coord.x << ";" << mcs.coord.y << ";"
+            << mcs.angle.rad << endl;
+        for (auto ev: events) {
+            out << prefix << "Emit event: " << static_cast<int>(ev) << endl;
+        }
+    }
+    // close the last cognition step
+    out << "(" << STEPS * 33 << ") enter new cognition step: " << STEPS << endl;
+
+    cout << "wrote " << STEPS << " cognition steps to " << fn << endl;
+    return 0;
+}
+
+// vim: set ts=4 sw=4 sts=4 expandtab: